@@ -6,24 +6,53 @@ CONFIG += debug
 CONFIG += sdk_no_version_check
 
 SOURCES += \
+    analysisarena.cpp \
+    bytesource.cpp \
+    corpus.cpp \
+    directorywalker.cpp \
+    invertedindex.cpp \
+    keywordcontext.cpp \
     main.cpp \
     mainwindow.cpp \
+    nearduplicates.cpp \
     page.cpp \
+    phrasecounter.cpp \
+    predictioncache.cpp \
+    segment.cpp \
+    segmentstore.cpp \
     sentiment_binding.cpp \
+    textspill.cpp \
     fastText/fasttext.cc \
     fastText/args.cc \
+    fastText/binarycorpus.cc \
     fastText/dictionary.cc \
     fastText/matrix.cc \
     fastText/model.cc \
     fastText/utils.cc \
     fastText/vector.cc \
     word.cpp \
+    wordcolumns.cpp \
     WordCloudWidget.cpp
 
 HEADERS += \
+    analysisarena.h \
+    blockingqueue.h \
+    bytesource.h \
+    corpus.h \
+    directorywalker.h \
+    invertedindex.h \
+    keywordcontext.h \
     mainwindow.h \
+    nearduplicates.h \
     page.h \
+    phrasecounter.h \
+    predictioncache.h \
+    segment.h \
+    segmentstore.h \
+    textspill.h \
+    varint.h \
     word.h \
+    wordcolumns.h \
     WordCloudWidget.h
 
 FORMS += \
@@ -39,6 +68,13 @@ TEMPLATE = app
 INCLUDEPATH += $$PWD/fastText
 LIBS += -L$$PWD/fastText/build -lfasttext
 
+# Compressed input: gzip is always available, zstd only when the library is installed
+LIBS += -lz
+packagesExist(libzstd) {
+    DEFINES += MEDIAMINER_HAVE_ZSTD
+    LIBS += -lzstd
+}
+
 # Suppress FastText warnings
 QMAKE_CXXFLAGS += -Wno-sign-compare -Wno-defaulted-function-deleted
 QMAKE_MACOSX_DEPLOYMENT_TARGET = 15.0
@@ -1,11 +1,11 @@
 #include "WordCloudWidget.h"
-#include "word.h"
 #include <QPainter>
 #include <QFont>
 #include <QColor>
 #include <QRandomGenerator>
 #include <QPen>
 #include <QBrush>
+#include <algorithm>
 #include <iostream>
 
 /**
@@ -24,17 +24,19 @@ WordCloudWidget::WordCloudWidget(QWidget *parent)
 /**
  * @brief Sets the word frequencies and triggers a repaint.
  *
- * This method stores a map of words and their frequency information,
+ * This method stores a snapshot of words and their frequencies,
  * then requests the widget to repaint with the new data.
  *
- * @param words A map from strings to Word objects containing word counts.
+ * @param words An immutable column store of words and their counts, shared rather than copied.
+ * @param phrases An immutable column store of frequent phrases and their counts, or nullptr.
  * @author Elizabeth Dorfman
  */
-void WordCloudWidget::setWordFrequencies(const std::map<std::string, Word>& words)
+void WordCloudWidget::setWordFrequencies(std::shared_ptr<const WordColumns> words, std::shared_ptr<const WordColumns> phrases)
 {
-    wordFrequencies = words;
-    for (const auto& wordPair : wordFrequencies) {
-        std::cout << "Word: " << wordPair.first << ", Count: " << wordPair.second.getCount() << std::endl;
+    wordFrequencies = std::move(words);
+    phraseFrequencies = std::move(phrases);
+    for (int id : wordFrequencies->filterByCount(1)) {
+        std::cout << "Word: " << wordFrequencies->getWord(id) << ", Count: " << wordFrequencies->getCount(id) << std::endl;
     }
     update();  // Trigger a repaint when the data is set
 }
@@ -69,23 +71,34 @@ void WordCloudWidget::paintEvent(QPaintEvent *event)
 
     int borderSize = 20;
 
-    // Find the maximum frequency to normalize font sizes
-    int maxFrequency = 0;
-    for (const auto &wordPair : wordFrequencies) {
-        int frequency = wordPair.second.getCount();
-        if (frequency > maxFrequency) {
-            maxFrequency = frequency;  // Update the maximum frequency
+    if (!wordFrequencies) {
+        return; // nothing analysed yet
+    }
+
+    // Words and phrases share one scale and are drawn most frequent first, so the large
+    // entries get placed
+    std::vector<std::pair<std::string_view, int>> entries;
+    for (int id : wordFrequencies->sortByCount(wordFrequencies->size())) {
+        entries.emplace_back(wordFrequencies->getWord(id), wordFrequencies->getCount(id));
+    }
+    if (phraseFrequencies) {
+        for (int id = 0; id < phraseFrequencies->size(); id++) {
+            entries.emplace_back(phraseFrequencies->getWord(id), phraseFrequencies->getCount(id));
         }
+        std::stable_sort(entries.begin(), entries.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
     }
 
+    // Find the maximum frequency to normalize font sizes
+    int maxFrequency = entries.empty() ? 0 : entries.front().second;
+
     // Define min and max font sizes
     int minFontSize = 10;
     int maxFontSize = 50;  // Set a reasonable max font size
 
     // Loop over words and draw them
-    for (const auto &wordPair : wordFrequencies) {
-        QString word = QString::fromStdString(wordPair.first);
-        int frequency = wordPair.second.getCount();
+    for (const auto& entry : entries) {
+        QString word = QString::fromUtf8(entry.first.data(), static_cast<int>(entry.first.size()));
+        int frequency = entry.second;
 
         // Calculate font size based on word frequency relative to max frequency
         int fontSize = minFontSize + (maxFontSize - minFontSize) * (frequency / static_cast<float>(maxFrequency));
@@ -6,7 +6,8 @@
 #include <QPainter>
 #include <QRandomGenerator>
 #include <QFont>
-#include "word.h"
+#include <memory>
+#include "wordcolumns.h"
 
 
 class WordCloudWidget : public QWidget
@@ -15,13 +16,14 @@ class WordCloudWidget : public QWidget
 
 public:
     explicit WordCloudWidget(QWidget *parent = nullptr);
-    void setWordFrequencies(const std::map<std::string, Word>& words);
+    void setWordFrequencies(std::shared_ptr<const WordColumns> words, std::shared_ptr<const WordColumns> phrases = nullptr);
 
 protected:
     void paintEvent(QPaintEvent *event) override;
 
 private:
-    std::map<std::string, Word> wordFrequencies;  // Holds word frequencies
+    std::shared_ptr<const WordColumns> wordFrequencies;  // Holds word frequencies, shared with the corpus
+    std::shared_ptr<const WordColumns> phraseFrequencies; // Most frequent phrases, drawn among the words
 };
 
 #endif // WORDCLOUDWIDGET_H
@@ -0,0 +1,131 @@
+#include "analysisarena.h"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+/// Size of the first block the arena requests from the heap; later blocks grow geometrically
+const std::size_t INITIAL_ARENA_BLOCK_SIZE = 256 * 1024;
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs a memory resource that counts the allocations it forwards to another resource.
+ *
+ * @param upstream The resource that actually provides the memory.
+ */
+CountingResource::CountingResource(std::pmr::memory_resource* upstream)
+    : upstream(upstream), allocationCount(0), allocatedBytes(0) {}
+
+/**
+ * @brief Gets the number of allocations made through this resource so far.
+ *
+ * @return The allocation count.
+ */
+std::size_t CountingResource::getAllocationCount() const
+{
+    return allocationCount;
+}
+
+/**
+ * @brief Gets the total number of bytes allocated through this resource so far.
+ *
+ * @return The byte count, including memory that has been deallocated again.
+ */
+std::size_t CountingResource::getAllocatedBytes() const
+{
+    return allocatedBytes;
+}
+
+void* CountingResource::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    allocationCount++;
+    allocatedBytes += bytes;
+    return upstream->allocate(bytes, alignment);
+}
+
+void CountingResource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment)
+{
+    upstream->deallocate(p, bytes, alignment);
+}
+
+bool CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+    return this == &other;
+}
+
+/**
+ * @brief Constructs an empty arena for the word and occurrence data of one analysis.
+ *
+ * Memory is taken from the heap in large blocks by a monotonic buffer and handed out by a pool
+ * that recycles the blocks of pages removed in watch mode. Nothing is returned to the heap until
+ * the arena is destroyed, at which point all blocks are released in one go.
+ *
+ * The arena is not thread-safe; it must only be used by the thread that owns the corpus.
+ */
+AnalysisArena::AnalysisArena()
+    : blocks(std::pmr::new_delete_resource()),
+      buffer(INITIAL_ARENA_BLOCK_SIZE, &blocks),
+      pool(&buffer),
+      requests(&pool) {}
+
+/**
+ * @brief Gets the memory resource that containers of this analysis should allocate from.
+ *
+ * @return The arena's resource, valid for the lifetime of the arena.
+ */
+std::pmr::memory_resource* AnalysisArena::resource()
+{
+    return &requests;
+}
+
+/**
+ * @brief Gets the number of allocations served by the arena.
+ *
+ * @return The allocation count.
+ */
+std::size_t AnalysisArena::getAllocationCount() const
+{
+    return requests.getAllocationCount();
+}
+
+/**
+ * @brief Gets the number of blocks the arena has requested from the heap.
+ *
+ * @return The heap allocation count.
+ */
+std::size_t AnalysisArena::getBlockCount() const
+{
+    return blocks.getAllocationCount();
+}
+
+/**
+ * @brief Gets the number of bytes the arena has requested from the heap.
+ *
+ * @return The reserved byte count.
+ */
+std::size_t AnalysisArena::getReservedBytes() const
+{
+    return blocks.getAllocatedBytes();
+}
+
+/**
+ * @brief Gets the peak resident set size of the process.
+ *
+ * @return The peak RSS in KiB, or -1 if the platform does not report it.
+ */
+long getPeakResidentSetKb()
+{
+#ifdef _WIN32
+    return -1;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return -1;
+    }
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024; // reported in bytes on macOS
+#else
+    return usage.ru_maxrss;
+#endif
+#endif
+}
@@ -0,0 +1,46 @@
+#ifndef ANALYSISARENA_H
+#define ANALYSISARENA_H
+
+#include <cstddef>
+#include <memory_resource>
+
+class CountingResource : public std::pmr::memory_resource {
+public:
+    explicit CountingResource(std::pmr::memory_resource* upstream);
+
+    std::size_t getAllocationCount() const;
+    std::size_t getAllocatedBytes() const;
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream;
+    std::size_t allocationCount;
+    std::size_t allocatedBytes;
+};
+
+class AnalysisArena {
+public:
+    AnalysisArena();
+
+    AnalysisArena(const AnalysisArena&) = delete;
+    AnalysisArena& operator=(const AnalysisArena&) = delete;
+
+    std::pmr::memory_resource* resource();
+
+    std::size_t getAllocationCount() const;
+    std::size_t getBlockCount() const;
+    std::size_t getReservedBytes() const;
+
+private:
+    CountingResource blocks;
+    std::pmr::monotonic_buffer_resource buffer;
+    std::pmr::unsynchronized_pool_resource pool;
+    CountingResource requests;
+};
+
+long getPeakResidentSetKb();
+
+#endif // ANALYSISARENA_H
@@ -0,0 +1,549 @@
+#include "bytesource.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <iostream>
+
+#ifdef MEDIAMINER_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+/// Size of the compressed-input buffer used by the decoders
+const std::size_t DECODER_BUFFER_SIZE = 64 * 1024;
+
+/// Size and number of the chunks a prefetching source decodes ahead of its reader
+const std::size_t PREFETCH_CHUNK_SIZE = 64 * 1024;
+const std::size_t PREFETCH_CHUNK_COUNT = 16;
+
+/**
+ * @brief Checks whether a string ends with the given suffix, ignoring letter case.
+ */
+bool endsWithIgnoreCase(const std::string& text, const std::string& suffix)
+{
+    if (text.size() < suffix.size()) {
+        return false;
+    }
+    return std::equal(suffix.rbegin(), suffix.rend(), text.rbegin(),
+                      [](char a, char b) { return std::tolower(a) == std::tolower(b); });
+}
+
+/**
+ * @brief Parses a non-negative decimal length, ignoring trailing blanks.
+ *
+ * @return False if the text is not a number, is negative or does not fit.
+ */
+bool parseLength(const std::string& text, std::int64_t& length)
+{
+    const char* end = text.data() + text.find_last_not_of(" \t") + 1;
+    if (text.empty() || end == text.data()) {
+        return false;
+    }
+    auto result = std::from_chars(text.data(), end, length);
+    return result.ec == std::errc() && result.ptr == end && length >= 0;
+}
+
+/**
+ * @brief Removes a trailing .gz or .zst suffix from a path.
+ */
+std::string stripCompressionSuffix(const std::string& path)
+{
+    if (endsWithIgnoreCase(path, ".gz")) {
+        return path.substr(0, path.size() - 3);
+    }
+    if (endsWithIgnoreCase(path, ".zst")) {
+        return path.substr(0, path.size() - 4);
+    }
+    return path;
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Opens a file for binary reading.
+ *
+ * @param path The path of the file.
+ */
+FileSource::FileSource(const std::string& path) : file(path, std::ios::binary) {}
+
+/**
+ * @brief Checks whether the file could be opened.
+ *
+ * @return True if the file is open.
+ */
+bool FileSource::isOpen() const
+{
+    return file.is_open();
+}
+
+/**
+ * @brief Reads the next bytes of the file.
+ *
+ * @param buffer Destination buffer.
+ * @param size Maximum number of bytes to read.
+ * @return The number of bytes read, 0 at the end of the file.
+ */
+std::size_t FileSource::read(char* buffer, std::size_t size)
+{
+    file.read(buffer, static_cast<std::streamsize>(size));
+    return static_cast<std::size_t>(file.gcount());
+}
+
+/**
+ * @brief Creates a streaming gzip/zlib decoder on top of another source.
+ *
+ * Concatenated gzip members (as used by .warc.gz files, one member per record) are decoded
+ * as a single continuous stream.
+ *
+ * @param input The compressed byte stream.
+ */
+GzipSource::GzipSource(std::unique_ptr<ByteSource> input)
+    : input(std::move(input)), inputBuffer(DECODER_BUFFER_SIZE), finished(false)
+{
+    std::memset(&stream, 0, sizeof(stream));
+    // 15 window bits + 32 lets zlib detect gzip and zlib headers automatically
+    if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+        std::cerr << "Error: Unable to initialise gzip decoder" << std::endl;
+        finished = true;
+    }
+}
+
+/**
+ * @brief Releases the decoder state.
+ */
+GzipSource::~GzipSource()
+{
+    inflateEnd(&stream);
+}
+
+/**
+ * @brief Decodes the next bytes of the compressed stream.
+ *
+ * @param buffer Destination buffer.
+ * @param size Maximum number of decoded bytes to produce.
+ * @return The number of bytes produced, 0 at the end of the stream or on a decoding error.
+ */
+std::size_t GzipSource::read(char* buffer, std::size_t size)
+{
+    stream.next_out = reinterpret_cast<Bytef*>(buffer);
+    stream.avail_out = static_cast<uInt>(size);
+
+    while (!finished && stream.avail_out > 0) {
+        if (stream.avail_in == 0) {
+            std::size_t count = input->read(inputBuffer.data(), inputBuffer.size());
+            if (count == 0) {
+                finished = true;
+                break;
+            }
+            stream.next_in = reinterpret_cast<Bytef*>(inputBuffer.data());
+            stream.avail_in = static_cast<uInt>(count);
+        }
+
+        int status = inflate(&stream, Z_NO_FLUSH);
+        if (status == Z_STREAM_END) {
+            // Continue with the next gzip member, if any
+            inflateReset(&stream);
+        } else if (status != Z_OK && status != Z_BUF_ERROR) {
+            std::cerr << "Error: Corrupt gzip data (" << (stream.msg ? stream.msg : "unknown error") << ")" << std::endl;
+            finished = true;
+        }
+    }
+    return size - stream.avail_out;
+}
+
+#ifdef MEDIAMINER_HAVE_ZSTD
+/**
+ * @brief Creates a streaming zstd decoder on top of another source.
+ *
+ * @param input The compressed byte stream.
+ */
+ZstdSource::ZstdSource(std::unique_ptr<ByteSource> input)
+    : input(std::move(input)), inputBuffer(ZSTD_DStreamInSize()), inputPos(0), inputEnd(0),
+      context(ZSTD_createDCtx()), finished(false) {}
+
+/**
+ * @brief Releases the decoder state.
+ */
+ZstdSource::~ZstdSource()
+{
+    ZSTD_freeDCtx(context);
+}
+
+/**
+ * @brief Decodes the next bytes of the compressed stream.
+ *
+ * @param buffer Destination buffer.
+ * @param size Maximum number of decoded bytes to produce.
+ * @return The number of bytes produced, 0 at the end of the stream or on a decoding error.
+ */
+std::size_t ZstdSource::read(char* buffer, std::size_t size)
+{
+    ZSTD_outBuffer output = {buffer, size, 0};
+    while (!finished && output.pos < output.size) {
+        if (inputPos == inputEnd) {
+            inputEnd = input->read(inputBuffer.data(), inputBuffer.size());
+            inputPos = 0;
+            if (inputEnd == 0) {
+                finished = true;
+                break;
+            }
+        }
+
+        ZSTD_inBuffer in = {inputBuffer.data(), inputEnd, inputPos};
+        std::size_t status = ZSTD_decompressStream(context, &output, &in);
+        inputPos = in.pos;
+        if (ZSTD_isError(status)) {
+            std::cerr << "Error: Corrupt zstd data (" << ZSTD_getErrorName(status) << ")" << std::endl;
+            finished = true;
+        }
+    }
+    return output.pos;
+}
+#endif
+
+/**
+ * @brief Decodes another source ahead of the reader on a background thread.
+ *
+ * Up to chunkCount chunks of chunkSize bytes are buffered, so memory use stays bounded while
+ * decompression of one file overlaps with the tokenization of another.
+ *
+ * @param input The source to read ahead from.
+ * @param chunkSize The size of each buffered chunk.
+ * @param chunkCount The maximum number of chunks buffered at once.
+ */
+PrefetchSource::PrefetchSource(std::unique_ptr<ByteSource> input, std::size_t chunkSize, std::size_t chunkCount)
+    : input(std::move(input)), chunkSize(chunkSize), chunks(chunkCount), currentPos(0)
+{
+    producer = std::thread(&PrefetchSource::produce, this);
+}
+
+/**
+ * @brief Stops the background thread, even if the stream has not been read to the end.
+ */
+PrefetchSource::~PrefetchSource()
+{
+    chunks.close();
+    producer.join();
+}
+
+/**
+ * @brief Copies the next prefetched bytes, waiting for the background thread if necessary.
+ *
+ * @param buffer Destination buffer.
+ * @param size Maximum number of bytes to copy.
+ * @return The number of bytes copied, 0 at the end of the stream.
+ */
+std::size_t PrefetchSource::read(char* buffer, std::size_t size)
+{
+    if (currentPos == current.size()) {
+        if (!chunks.pop(current)) {
+            return 0;
+        }
+        currentPos = 0;
+    }
+    std::size_t count = std::min(size, current.size() - currentPos);
+    std::memcpy(buffer, current.data() + currentPos, count);
+    currentPos += count;
+    return count;
+}
+
+/**
+ * @brief Background thread body: reads the input chunk by chunk into the queue.
+ */
+void PrefetchSource::produce()
+{
+    while (true) {
+        std::string chunk(chunkSize, '\0');
+        std::size_t count = input->read(&chunk[0], chunk.size());
+        if (count == 0) {
+            break;
+        }
+        chunk.resize(count);
+        if (!chunks.push(std::move(chunk))) {
+            return; // reader went away
+        }
+    }
+    chunks.close();
+}
+
+/**
+ * @brief Creates a reader for the records of a WARC archive.
+ *
+ * @param input The (already decompressed) WARC stream. Must outlive the reader.
+ */
+WarcReader::WarcReader(ByteSource& input)
+    : input(input), buffer(DECODER_BUFFER_SIZE), bufferPos(0), bufferEnd(0), remaining(0), payloadSource(*this) {}
+
+/**
+ * @brief Advances to the next record that carries an HTML document.
+ *
+ * Only "response" and "resource" records are returned; for responses the HTTP status line
+ * and headers are skipped so that payload() yields the document itself. Any unread payload
+ * of the previous record is skipped.
+ *
+ * @param targetUri Receives the WARC-Target-URI of the record.
+ * @return False once the archive has no more records.
+ */
+bool WarcReader::nextRecord(std::string& targetUri)
+{
+    while (true) {
+        skip(remaining);
+        remaining = 0;
+
+        // Find the version line, skipping the blank lines that separate records
+        std::string line;
+        do {
+            if (!readLine(line)) {
+                return false;
+            }
+        } while (line.empty());
+        if (line.compare(0, 5, "WARC/") != 0) {
+            std::cerr << "Error: Malformed WARC record header: " << line << std::endl;
+            return false;
+        }
+
+        std::string type;
+        std::string contentType;
+        std::int64_t contentLength = 0;
+        bool hasLength = true;
+        std::string lengthText;
+        targetUri.clear();
+        while (readLine(line) && !line.empty()) {
+            std::size_t colon = line.find(':');
+            if (colon == std::string::npos) {
+                continue;
+            }
+            std::string name = line.substr(0, colon);
+            std::string value = line.substr(colon + 1);
+            value.erase(0, value.find_first_not_of(" \t"));
+            std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+            if (name == "warc-type") {
+                type = value;
+            } else if (name == "warc-target-uri") {
+                targetUri = value;
+            } else if (name == "content-type") {
+                contentType = value;
+            } else if (name == "content-length") {
+                hasLength = parseLength(value, contentLength);
+                if (!hasLength) {
+                    lengthText = value;
+                }
+            }
+        }
+        // Without a valid length the end of the record, and so the start of
+        // the next one, is unknown
+        if (!hasLength) {
+            std::cerr << "Error: Invalid WARC Content-Length: " << lengthText << std::endl;
+            return false;
+        }
+        remaining = contentLength;
+
+        if (type == "resource" && contentType.find("html") != std::string::npos) {
+            return true;
+        }
+        if (type != "response") {
+            continue;
+        }
+
+        // Skip the HTTP status line and headers; keep only HTML responses
+        bool isHtml = true;
+        while (readPayloadLine(line) && !line.empty()) {
+            std::transform(line.begin(), line.end(), line.begin(), ::tolower);
+            if (line.compare(0, 13, "content-type:") == 0 && line.find("html") == std::string::npos) {
+                isHtml = false;
+            }
+        }
+        if (isHtml) {
+            return true;
+        }
+    }
+}
+
+/**
+ * @brief Gets a source that yields the document of the current record.
+ *
+ * @return A source that ends at the end of the current record.
+ */
+ByteSource& WarcReader::payload()
+{
+    return payloadSource;
+}
+
+/**
+ * @brief Reads the next bytes of the current record's document.
+ */
+std::size_t WarcReader::Payload::read(char* buffer, std::size_t size)
+{
+    std::size_t count = reader.readRaw(buffer, static_cast<std::size_t>(std::min<std::int64_t>(size, reader.remaining)));
+    reader.remaining -= count;
+    return count;
+}
+
+/**
+ * @brief Refills the internal buffer from the input.
+ *
+ * @return False at the end of the input.
+ */
+bool WarcReader::fill()
+{
+    bufferPos = 0;
+    bufferEnd = input.read(buffer.data(), buffer.size());
+    return bufferEnd > 0;
+}
+
+/**
+ * @brief Reads one header line, without its line terminator.
+ *
+ * @param line Receives the line.
+ * @return False if the input ended before any character was read.
+ */
+bool WarcReader::readLine(std::string& line)
+{
+    line.clear();
+    bool gotAny = false;
+    while (bufferPos < bufferEnd || fill()) {
+        gotAny = true;
+        char c = buffer[bufferPos++];
+        if (c == '\n') {
+            break;
+        }
+        line.push_back(c);
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return gotAny;
+}
+
+/**
+ * @brief Reads one line of the current record's block, without its line terminator.
+ *
+ * Unlike readLine() this never reads past the end of the record.
+ *
+ * @param line Receives the line.
+ * @return False if the record has no more bytes.
+ */
+bool WarcReader::readPayloadLine(std::string& line)
+{
+    line.clear();
+    if (remaining <= 0) {
+        return false;
+    }
+    while (remaining > 0 && (bufferPos < bufferEnd || fill())) {
+        char c = buffer[bufferPos++];
+        remaining--;
+        if (c == '\n') {
+            break;
+        }
+        line.push_back(c);
+    }
+    if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+    }
+    return true;
+}
+
+/**
+ * @brief Reads bytes through the internal buffer.
+ */
+std::size_t WarcReader::readRaw(char* out, std::size_t size)
+{
+    if (bufferPos == bufferEnd) {
+        // Large reads bypass the buffer entirely
+        if (size >= buffer.size()) {
+            return input.read(out, size);
+        }
+        if (!fill()) {
+            return 0;
+        }
+    }
+    std::size_t count = std::min(size, bufferEnd - bufferPos);
+    std::memcpy(out, buffer.data() + bufferPos, count);
+    bufferPos += count;
+    return count;
+}
+
+/**
+ * @brief Discards the given number of bytes.
+ */
+void WarcReader::skip(std::int64_t count)
+{
+    char scratch[4096];
+    while (count > 0) {
+        std::size_t read = readRaw(scratch, static_cast<std::size_t>(std::min<std::int64_t>(count, sizeof(scratch))));
+        if (read == 0) {
+            return;
+        }
+        count -= read;
+    }
+}
+
+/**
+ * @brief Opens a file as a byte stream, decompressing it on the fly.
+ *
+ * Files ending in .gz are decoded with zlib and files ending in .zst with zstd (when the
+ * application was built with zstd support); all other files are read as they are.
+ *
+ * @param path The file to open.
+ * @param prefetch If true, reading and decoding start immediately on a background thread
+ *                 (see PrefetchSource), so the file is ready by the time it is parsed.
+ * @return The source, or nullptr if the file cannot be opened or decoded.
+ */
+std::unique_ptr<ByteSource> openByteSource(const std::string& path, bool prefetch)
+{
+    auto file = std::make_unique<FileSource>(path);
+    if (!file->isOpen()) {
+        std::cerr << "Error: Unable to open file " << path << std::endl;
+        return nullptr;
+    }
+
+    std::unique_ptr<ByteSource> source;
+    if (endsWithIgnoreCase(path, ".gz")) {
+        source = std::make_unique<GzipSource>(std::move(file));
+    } else if (endsWithIgnoreCase(path, ".zst")) {
+#ifdef MEDIAMINER_HAVE_ZSTD
+        source = std::make_unique<ZstdSource>(std::move(file));
+#else
+        std::cerr << "Error: " << path << " is zstd-compressed but zstd support was not built in" << std::endl;
+        return nullptr;
+#endif
+    } else {
+        source = std::move(file);
+    }
+
+    if (prefetch) {
+        source = std::make_unique<PrefetchSource>(std::move(source), PREFETCH_CHUNK_SIZE, PREFETCH_CHUNK_COUNT);
+    }
+    return source;
+}
+
+/**
+ * @brief Checks whether a path names a WARC archive (.warc, optionally compressed).
+ *
+ * @param path The file path to check.
+ * @return True for WARC archives.
+ */
+bool isWarcFile(const std::string& path)
+{
+    return endsWithIgnoreCase(stripCompressionSuffix(path), ".warc");
+}
+
+/**
+ * @brief Checks whether a path names a file that can be analysed.
+ *
+ * HTML pages (.html, .htm) and WARC archives (.warc) are accepted, each optionally compressed
+ * with gzip (.gz) or zstd (.zst). Extensions are matched in any letter case.
+ *
+ * @param path The file path to check.
+ * @return True if the file should be analysed.
+ */
+bool isSupportedInputFile(const std::string& path)
+{
+    std::string uncompressed = stripCompressionSuffix(path);
+    return endsWithIgnoreCase(uncompressed, ".html") || endsWithIgnoreCase(uncompressed, ".htm")
+        || endsWithIgnoreCase(uncompressed, ".warc");
+}
@@ -0,0 +1,118 @@
+#ifndef BYTESOURCE_H
+#define BYTESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+#include "blockingqueue.h"
+
+/**
+ * @brief A sequential stream of bytes that a Page can be read from.
+ *
+ * Implementations decode files, archives or in-memory data. read() returns the number of
+ * bytes copied into the buffer and 0 once the stream is exhausted.
+ */
+class ByteSource {
+public:
+    virtual ~ByteSource() = default;
+    virtual std::size_t read(char* buffer, std::size_t size) = 0;
+};
+
+class FileSource : public ByteSource {
+public:
+    explicit FileSource(const std::string& path);
+    bool isOpen() const;
+    std::size_t read(char* buffer, std::size_t size) override;
+
+private:
+    std::ifstream file;
+};
+
+class GzipSource : public ByteSource {
+public:
+    explicit GzipSource(std::unique_ptr<ByteSource> input);
+    ~GzipSource() override;
+    std::size_t read(char* buffer, std::size_t size) override;
+
+private:
+    std::unique_ptr<ByteSource> input;
+    std::vector<char> inputBuffer;
+    z_stream stream;
+    bool finished;
+};
+
+#ifdef MEDIAMINER_HAVE_ZSTD
+class ZstdSource : public ByteSource {
+public:
+    explicit ZstdSource(std::unique_ptr<ByteSource> input);
+    ~ZstdSource() override;
+    std::size_t read(char* buffer, std::size_t size) override;
+
+private:
+    std::unique_ptr<ByteSource> input;
+    std::vector<char> inputBuffer;
+    std::size_t inputPos;
+    std::size_t inputEnd;
+    struct ZSTD_DCtx_s* context;
+    bool finished;
+};
+#endif
+
+class PrefetchSource : public ByteSource {
+public:
+    PrefetchSource(std::unique_ptr<ByteSource> input, std::size_t chunkSize, std::size_t chunkCount);
+    ~PrefetchSource() override;
+    std::size_t read(char* buffer, std::size_t size) override;
+
+private:
+    void produce();
+
+    std::unique_ptr<ByteSource> input;
+    std::size_t chunkSize;
+    BlockingQueue<std::string> chunks;
+    std::string current;
+    std::size_t currentPos;
+    std::thread producer;
+};
+
+class WarcReader {
+public:
+    explicit WarcReader(ByteSource& input);
+
+    bool nextRecord(std::string& targetUri);
+    ByteSource& payload();
+
+private:
+    class Payload : public ByteSource {
+    public:
+        explicit Payload(WarcReader& reader) : reader(reader) {}
+        std::size_t read(char* buffer, std::size_t size) override;
+
+    private:
+        WarcReader& reader;
+    };
+
+    bool fill();
+    bool readLine(std::string& line);
+    bool readPayloadLine(std::string& line);
+    std::size_t readRaw(char* buffer, std::size_t size);
+    void skip(std::int64_t count);
+
+    ByteSource& input;
+    std::vector<char> buffer;
+    std::size_t bufferPos;
+    std::size_t bufferEnd;
+    std::int64_t remaining;
+    Payload payloadSource;
+};
+
+std::unique_ptr<ByteSource> openByteSource(const std::string& path, bool prefetch = false);
+bool isWarcFile(const std::string& path);
+bool isSupportedInputFile(const std::string& path);
+
+#endif // BYTESOURCE_H
@@ -0,0 +1,627 @@
+#include "corpus.h"
+#include "keywordcontext.h"
+#include <algorithm>
+#include <cctype>
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs an empty Corpus that aggregates word statistics over many pages.
+ *
+ * The corpus keeps the contribution of every page separately so that a single page can be
+ * added, replaced or removed later without recomputing the statistics of the other pages.
+ * All words, occurrences and map nodes are allocated from an arena owned by the corpus and
+ * are released together when the corpus is destroyed. An inverted index of the paragraphs
+ * every word occurs in is kept as well, so the keyword can be changed without reading the
+ * pages again, frequent bigrams and trigrams are counted in a bounded PhraseCounter, and the
+ * keyword contexts are clustered with their near-duplicates across all pages.
+ *
+ * @param keyword The keyword query to track (see setKeyword()).
+ * @param stopwords Words that are excluded from all statistics. Must outlive the corpus.
+ */
+Corpus::Corpus(const std::string& keyword, const std::unordered_set<std::string>& stopwords)
+    : keyword(keyword), stopwords(stopwords), pages(arena.resource()), allWords(arena.resource()),
+      wordPosition(0), totalKeywordOccurrences(0)
+{
+    std::transform(this->keyword.begin(), this->keyword.end(), this->keyword.begin(), ::tolower);
+}
+
+/**
+ * @brief Gets the allocator that the corpus stores its words with.
+ *
+ * A Page constructed with this allocator can hand its words over to addPage() without copying.
+ *
+ * @return An allocator that uses the arena of this corpus.
+ */
+Word::allocator_type Corpus::getAllocator()
+{
+    return Word::allocator_type(arena.resource());
+}
+
+/**
+ * @brief Gets the spill that the corpus keeps the paragraph texts of its pages in.
+ *
+ * A Page constructed with this spill writes its paragraph texts there while it is read, so
+ * keyword queries can extract contexts without the corpus holding every text in memory. The
+ * texts of removed or replaced pages stay in the spill until the corpus is destroyed.
+ *
+ * @return The paragraph spill of this corpus.
+ */
+TextSpill* Corpus::getParagraphSpill()
+{
+    return &paragraphTexts;
+}
+
+/**
+ * @brief Merges the words of a page into the corpus statistics.
+ *
+ * If a page with the same path has already been added, its previous contribution is removed
+ * first so that modified files are counted only once. The words are moved out of the page and
+ * kept as the page's contribution; the merged word map only refers to them.
+ *
+ * @param path The unique path of the page, used as its key.
+ * @param page The page whose words have already been read. It is left without words.
+ */
+void Corpus::addPage(const std::string& path, Page&& page)
+{
+    removePage(path);
+    columnsSnapshot.reset();
+
+    changedPages.insert(path);
+    PageRecord& record = pages[path];
+    record.document = index.addDocument();
+    documents.push_back(&record);
+    record.name = page.getName();
+    record.paragraphs = page.takeParagraphs();
+
+    std::vector<Page::Phrase> phrases = page.takePhrases();
+    std::pmr::vector<Word> words = page.takeWords();
+    std::vector<int> keptIndex(words.size(), -1); // position of each page word in record.words, -1 for stopwords
+    auto kept = words.begin();
+    for (std::size_t i = 0; i < words.size(); i++) {
+        Word& word = words[i];
+        std::string lowercaseWord(word.getWord());
+        std::transform(lowercaseWord.begin(), lowercaseWord.end(), lowercaseWord.begin(), ::tolower);
+
+        // Skip stopwords
+        if (stopwords.count(lowercaseWord)) {
+            continue;
+        }
+
+        word.setWord(lowercaseWord);
+        columns.addOccurrences(columns.intern(lowercaseWord), word.getCount(), wordPosition);
+        index.addTerm(record.document, lowercaseWord, word.getOccurrences().data(), word.getOccurrences().size());
+
+        if (&*kept != &word) {
+            *kept = std::move(word);
+        }
+        keptIndex[i] = static_cast<int>(kept - words.begin());
+        ++kept;
+    }
+    words.erase(kept, words.end());
+    record.words = std::move(words);
+
+    // The merged map refers to the records, which no longer move
+    record.sourcePositions.resize(record.words.size());
+    for (std::size_t i = 0; i < record.words.size(); i++) {
+        const Word& word = record.words[i];
+        auto it = allWords.lower_bound(word.getWord());
+        if (it == allWords.end() || it->first != word.getWord()) {
+            it = allWords.emplace_hint(it, std::piecewise_construct, std::forward_as_tuple(word.getWord()),
+                                       std::forward_as_tuple());
+        }
+        it->second.add(word, record.sourcePositions[i]);
+    }
+
+    // Phrases that contain a stopword are not counted
+    for (const Page::Phrase& phrase : phrases) {
+        if (std::any_of(phrase.words, phrase.words + phrase.length, [&keptIndex](int word) { return keptIndex[word] < 0; })) {
+            continue;
+        }
+        if (phraseCounter.add(phrase.key, phrase.count)) {
+            std::string text(record.words[keptIndex[phrase.words[0]]].getWord());
+            for (int w = 1; w < phrase.length; w++) {
+                text += ' ';
+                text += record.words[keptIndex[phrase.words[w]]].getWord();
+            }
+            phraseCounter.track(phrase.key, std::move(text), phrase.count, record.document);
+        }
+    }
+    for (const Word& word : record.words) {
+        wordPosition += word.getCount();
+    }
+
+    // The new page is the last document of the index, so only its own postings are decoded
+    if (!keyword.empty()) {
+        applyKeyword(index.search(keyword, record.document));
+        unclassifiedPages.insert(path);
+    }
+}
+
+/**
+ * @brief Removes the contribution of a previously added page.
+ *
+ * @param path The path the page was added under.
+ * @return True if the page was part of the corpus, false otherwise.
+ */
+bool Corpus::removePage(const std::string& path)
+{
+    auto pageIt = pages.find(path);
+    if (pageIt == pages.end()) {
+        return false;
+    }
+
+    columnsSnapshot.reset();
+    changedPages.insert(path);
+    const PageRecord& record = pageIt->second;
+    for (std::size_t i = 0; i < record.words.size(); i++) {
+        const Word& word = record.words[i];
+        columns.removeOccurrences(columns.find(word.getWord()), word.getCount());
+
+        auto it = allWords.find(word.getWord());
+        if (it == allWords.end()) {
+            continue;
+        }
+        it->second.remove(record.sourcePositions[i]);
+        if (it->second.getWords().empty()) {
+            allWords.erase(it);
+        }
+    }
+    for (const auto& phrase : countPagePhrases(record)) {
+        phraseCounter.remove(phrase.first, phrase.second, record.document);
+    }
+    for (int cluster : record.contextClusters) {
+        nearDuplicates.remove(cluster);
+    }
+    unclassifiedPages.erase(path);
+    totalKeywordOccurrences -= record.keywordOccurrences;
+    index.removeDocument(record.document);
+    documents[record.document] = nullptr;
+    pages.erase(pageIt);
+    return true;
+}
+
+/**
+ * @brief Removes every page read from a file.
+ *
+ * A plain HTML file is stored under its own path, while the records of a WARC archive are
+ * stored as "<path>#<record index>"; both kinds are removed.
+ *
+ * @param path The path of the file.
+ */
+void Corpus::removeFile(const std::string& path)
+{
+    removePage(path);
+
+    // Record keys share the "<path>#" prefix and are therefore adjacent in the ordered map
+    std::string prefix = path + "#";
+    auto it = pages.lower_bound(prefix);
+    while (it != pages.end() && it->first.compare(0, prefix.size(), prefix) == 0) {
+        std::string key = (it++)->first;
+        removePage(key);
+    }
+}
+
+/**
+ * @brief Checks whether a page has been added under the given path.
+ *
+ * @param path The path to look up.
+ * @return True if the corpus contains the page.
+ */
+bool Corpus::hasPage(const std::string& path) const
+{
+    return pages.count(path) > 0;
+}
+
+/**
+ * @brief Gets the paths of all pages in the corpus.
+ *
+ * @return The page paths in sorted order.
+ */
+std::vector<std::string> Corpus::getPagePaths() const
+{
+    std::vector<std::string> paths;
+    paths.reserve(pages.size());
+    for (const auto& pair : pages) {
+        paths.push_back(pair.first);
+    }
+    return paths;
+}
+
+/**
+ * @brief Changes the keyword query and recomputes the keyword statistics of every page.
+ *
+ * The matches are looked up in the inverted index, so no page has to be read again. A query may
+ * consist of several words, which must then all occur in the same paragraph, and a word ending
+ * in '*' matches every word with that prefix. The sentiment of all pages is reset and has to be
+ * recomputed for the new contexts, so every page becomes unclassified.
+ *
+ * @param keyword The new keyword query (matched case-insensitively); empty to track no keyword.
+ */
+void Corpus::setKeyword(const std::string& keyword)
+{
+    this->keyword = keyword;
+    std::transform(this->keyword.begin(), this->keyword.end(), this->keyword.begin(), ::tolower);
+
+    totalKeywordOccurrences = 0;
+    nearDuplicates.clear();
+    unclassifiedPages.clear();
+    for (auto& pair : pages) {
+        pair.second.relevantTexts.clear();
+        pair.second.contextClusters.clear();
+        pair.second.keywordOccurrences = 0;
+        pair.second.sentiment = SentimentCounts();
+        if (!this->keyword.empty()) {
+            unclassifiedPages.insert(unclassifiedPages.end(), pair.first);
+        }
+    }
+    if (!this->keyword.empty()) {
+        applyKeyword(index.search(this->keyword));
+    }
+}
+
+/**
+ * @brief Adds the paragraphs matched by the keyword query to the statistics of their pages.
+ *
+ * Every match contributes the sentence around it (see extractKeywordContexts()). A page keeps
+ * each distinct window once, so repeated boilerplate is not analysed several times, and every
+ * window joins the cluster of its near-duplicates in the whole corpus.
+ *
+ * @param postings The matching paragraphs returned by the inverted index, ordered by document.
+ */
+void Corpus::applyKeyword(const std::vector<InvertedIndex::Posting>& postings)
+{
+    std::vector<InvertedIndex::QueryTerm> terms = InvertedIndex::parseQuery(keyword);
+    ContextDeduplicator pageContexts;
+    int lastDocument = -1;
+
+    for (const InvertedIndex::Posting& posting : postings) {
+        PageRecord* record = documents[posting.document];
+        if (!record) {
+            continue;
+        }
+        if (posting.document != lastDocument) {
+            pageContexts.clear();
+            lastDocument = posting.document;
+        }
+        record->keywordOccurrences += posting.frequency;
+        totalKeywordOccurrences += posting.frequency;
+        for (std::string& context : extractKeywordContexts(paragraphTexts.read(record->paragraphs[posting.paragraph]), terms)) {
+            if (pageContexts.insert(context)) {
+                record->contextClusters.push_back(nearDuplicates.add(context));
+                record->relevantTexts.push_back(std::move(context));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Records the sentiment counts computed for the relevant texts of a page.
+ *
+ * @param path The path of a page that is already part of the corpus.
+ * @param counts The number of positive, negative and neutral predictions for that page.
+ */
+void Corpus::setPageSentiment(const std::string& path, const SentimentCounts& counts)
+{
+    auto it = pages.find(path);
+    if (it != pages.end()) {
+        it->second.sentiment = counts;
+    }
+}
+
+/**
+ * @brief Collects the pages whose sentiment has to be computed, e.g. after files were added.
+ *
+ * A page is unclassified after it was added or replaced, or after the keyword changed. Removing
+ * a page does not change the clusters of the other pages' contexts (see NearDuplicateIndex::remove()),
+ * so their sentiment stays valid.
+ *
+ * @return The paths of the unclassified pages. The list is empty afterwards.
+ */
+std::vector<std::string> Corpus::takeUnclassifiedPages()
+{
+    std::vector<std::string> paths(unclassifiedPages.begin(), unclassifiedPages.end());
+    unclassifiedPages.clear();
+    return paths;
+}
+
+/**
+ * @brief Gets the texts a page's sentiment is computed from.
+ *
+ * Every cluster the page's contexts fall into is represented by its representative, weighted by
+ * the number of the page's contexts in it. A representative shared by several pages is the same
+ * text for all of them, so it is answered from the prediction cache after its first prediction.
+ *
+ * @param path The path of the page.
+ * @param representatives Receives one text per cluster of the page.
+ * @param weights Receives the number of the page's contexts in each of those clusters.
+ */
+void Corpus::getPageRepresentatives(const std::string& path, std::vector<std::string>& representatives,
+                                    std::vector<int>& weights) const
+{
+    representatives.clear();
+    weights.clear();
+    auto it = pages.find(path);
+    if (it == pages.end()) {
+        return;
+    }
+    std::unordered_map<int, std::size_t> positions; // position of every cluster in representatives
+    for (int cluster : it->second.contextClusters) {
+        auto inserted = positions.emplace(cluster, representatives.size());
+        if (inserted.second) {
+            representatives.push_back(nearDuplicates.getRepresentative(cluster));
+            weights.push_back(1);
+        } else {
+            weights[inserted.first->second]++;
+        }
+    }
+}
+
+/**
+ * @brief Gets the keyword contexts found in a single page.
+ *
+ * @param path The path of the page.
+ * @return The distinct keyword-in-context windows of that page (empty if the page is unknown).
+ */
+const std::vector<std::string>& Corpus::getPageRelevantTexts(const std::string& path) const
+{
+    static const std::vector<std::string> empty;
+    auto it = pages.find(path);
+    return it != pages.end() ? it->second.relevantTexts : empty;
+}
+
+/**
+ * @brief Gets the context of every occurrence of a word, e.g. to list them in the log.
+ *
+ * Occurrences only record their paragraph, so the contexts are built here from the beginning of
+ * the spilled paragraph text: "File: <page name> | Context: <first 100 characters>...".
+ *
+ * @param word The lowercase word.
+ * @return One context per occurrence, ordered by page and paragraph.
+ */
+std::vector<std::string> Corpus::getOccurrenceContexts(std::string_view word) const
+{
+    std::vector<std::string> contexts;
+    for (const InvertedIndex::Posting& posting : index.search(std::string(word))) {
+        const PageRecord* record = documents[posting.document];
+        TextSpill::Range excerpt = record->paragraphs[posting.paragraph];
+        excerpt.length = std::min<std::uint64_t>(excerpt.length, 100);
+        std::string context = "File: " + record->name + " | Context: " + paragraphTexts.read(excerpt) + "...";
+        contexts.insert(contexts.end(), posting.frequency, context);
+    }
+    return contexts;
+}
+
+/**
+ * @brief Gets all non-stopword words of the corpus keyed by their lowercase spelling.
+ *
+ * @return A const reference to the merged word map.
+ */
+const WordMap& Corpus::getWords() const
+{
+    return allWords;
+}
+
+/**
+ * @brief Gets the per-word statistics of the corpus in columnar form.
+ *
+ * @return A const reference to the column store; it changes whenever a page is added or removed.
+ */
+const WordColumns& Corpus::getColumns() const
+{
+    return columns;
+}
+
+/**
+ * @brief Gets an immutable copy of the per-word statistics.
+ *
+ * The copy is shared by all callers until the corpus changes, so readers such as the word cloud
+ * can keep it after the corpus has been modified or destroyed.
+ *
+ * @return The snapshot of the column store.
+ */
+std::shared_ptr<const WordColumns> Corpus::getColumnsSnapshot() const
+{
+    if (!columnsSnapshot) {
+        columnsSnapshot = std::make_shared<const WordColumns>(columns);
+    }
+    return columnsSnapshot;
+}
+
+/**
+ * @brief Gets the most frequent bigrams and trigrams that contain no stopwords.
+ *
+ * @param limit The maximum number of phrases.
+ * @return A column store of the phrases and their counts, most frequent first (see PhraseCounter).
+ */
+std::shared_ptr<const WordColumns> Corpus::getTopPhrases(std::size_t limit) const
+{
+    return phraseCounter.getTop(limit, [this](const std::string& phrase, int beforeDocument) {
+        return countPhrase(phrase, beforeDocument);
+    });
+}
+
+/**
+ * @brief Counts the bigrams and trigrams of a page again from its spilled paragraph text.
+ *
+ * The pages do not keep their phrases, so this is how the phrases of a removed page are found.
+ * The keys and counts are the ones Page computed when the page was read, without the phrases
+ * that contain a stopword. Removing or replacing a page therefore costs about as much as
+ * tokenizing it again, which dominates the phrase overhead of watch mode.
+ *
+ * @param record The page.
+ * @return The count of every phrase key of the page.
+ */
+std::unordered_map<std::uint64_t, int> Corpus::countPagePhrases(const PageRecord& record) const
+{
+    std::unordered_map<std::uint64_t, int> counts;
+    for (const TextSpill::Range& paragraph : record.paragraphs) {
+        std::vector<std::string> words = Page::splitWords(paragraphTexts.read(paragraph));
+        std::uint64_t previousHash = 0, bigramKey = 0;
+        for (std::size_t i = 0; i < words.size(); i++) {
+            std::uint64_t hash = PhraseCounter::hashWord(words[i]);
+            bool kept = !stopwords.count(words[i]);
+            if (i >= 2 && kept && !stopwords.count(words[i - 1]) && !stopwords.count(words[i - 2])) {
+                counts[PhraseCounter::extendKey(bigramKey, hash)]++;
+            }
+            if (i >= 1) {
+                bigramKey = PhraseCounter::extendKey(PhraseCounter::startKey(previousHash), hash);
+                if (kept && !stopwords.count(words[i - 1])) {
+                    counts[bigramKey]++;
+                }
+            }
+            previousHash = hash;
+        }
+    }
+    return counts;
+}
+
+/**
+ * @brief Counts the occurrences of a phrase in the pages added before a given one.
+ *
+ * Only the paragraphs that contain every word of the phrase are read from the spill.
+ *
+ * @param phrase The lowercase words of the phrase separated by single spaces.
+ * @param beforeDocument Only pages whose index document is numbered below this are counted.
+ * @return The number of occurrences.
+ */
+int Corpus::countPhrase(const std::string& phrase, int beforeDocument) const
+{
+    std::vector<std::string> phraseWords = Page::splitWords(phrase);
+    int count = 0;
+    for (const InvertedIndex::Posting& posting : index.search(phrase)) {
+        if (posting.document >= beforeDocument) {
+            break; // postings are ordered by document
+        }
+        const PageRecord* record = documents[posting.document];
+        std::vector<std::string> words = Page::splitWords(paragraphTexts.read(record->paragraphs[posting.paragraph]));
+        for (std::size_t i = 0; i + phraseWords.size() <= words.size(); i++) {
+            if (std::equal(phraseWords.begin(), phraseWords.end(), words.begin() + i)) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Counts the keyword contexts of every page in the corpus.
+ *
+ * @return The number of distinct keyword-in-context windows, summed over the pages.
+ */
+int Corpus::getRelevantTextCount() const
+{
+    std::size_t count = 0;
+    for (const auto& pair : pages) {
+        count += pair.second.relevantTexts.size();
+    }
+    return static_cast<int>(count);
+}
+
+/**
+ * @brief Sums the sentiment counts of all pages.
+ *
+ * @return The combined positive, negative and neutral counts.
+ */
+SentimentCounts Corpus::getSentiment() const
+{
+    SentimentCounts total;
+    for (const auto& pair : pages) {
+        total.positive += pair.second.sentiment.positive;
+        total.negative += pair.second.sentiment.negative;
+        total.neutral += pair.second.sentiment.neutral;
+    }
+    return total;
+}
+
+/**
+ * @brief Gets the number of pages in the corpus.
+ *
+ * @return The page count.
+ */
+int Corpus::getPageCount() const
+{
+    return static_cast<int>(pages.size());
+}
+
+/**
+ * @brief Gets the total number of non-stopword word occurrences.
+ *
+ * @return The total word count.
+ */
+int Corpus::getTotalWords() const
+{
+    return static_cast<int>(columns.getTotalCount());
+}
+
+/**
+ * @brief Gets the number of distinct non-stopword words.
+ *
+ * @return The unique word count.
+ */
+int Corpus::getUniqueWords() const
+{
+    return columns.getLiveCount();
+}
+
+/**
+ * @brief Gets the number of times the keyword occurs across all pages.
+ *
+ * @return The keyword occurrence count.
+ */
+int Corpus::getKeywordOccurrences() const
+{
+    return totalKeywordOccurrences;
+}
+
+/**
+ * @brief Gets the arena that holds the word data of this corpus, e.g. to report its allocation statistics.
+ *
+ * @return A const reference to the arena.
+ */
+const AnalysisArena& Corpus::getArena() const
+{
+    return arena;
+}
+
+/**
+ * @brief Checks whether pages have been added or removed since the last call to takeChanges().
+ *
+ * @return True if there are changes to persist.
+ */
+bool Corpus::hasChanges() const
+{
+    return !changedPages.empty();
+}
+
+/**
+ * @brief Collects the pages added or removed since the last call, e.g. to store them in a SegmentStore.
+ *
+ * Pages that are still part of the corpus are returned with their paragraph texts and the
+ * paragraph of every word occurrence; pages that have been removed become tombstones.
+ *
+ * @return The changes in segment form. The change list is empty afterwards.
+ */
+SegmentData Corpus::takeChanges()
+{
+    SegmentData data;
+    for (const std::string& path : changedPages) {
+        auto it = pages.find(path);
+        if (it == pages.end()) {
+            data.tombstones.push_back(path);
+            continue;
+        }
+
+        const PageRecord& record = it->second;
+        SegmentData::Document document;
+        document.path = path;
+        document.paragraphs = record.paragraphs;
+        for (std::size_t i = 0; i < record.words.size(); i++) {
+            const Word::Occurrences& occurrences = record.words[i].getOccurrences();
+            document.terms.emplace(std::string(record.words[i].getWord()), std::vector<int>(occurrences.begin(), occurrences.end()));
+        }
+        data.documents.push_back(std::move(document));
+    }
+    changedPages.clear();
+    data.paragraphTexts = &paragraphTexts;
+    return data;
+}
@@ -0,0 +1,112 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <map>
+#include <memory>
+#include <memory_resource>
+#include <set>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "analysisarena.h"
+#include "invertedindex.h"
+#include "nearduplicates.h"
+#include "page.h"
+#include "phrasecounter.h"
+#include "segment.h"
+#include "textspill.h"
+#include "word.h"
+#include "wordcolumns.h"
+
+struct SentimentCounts {
+    int positive = 0;
+    int negative = 0;
+    int neutral = 0;
+};
+
+class Corpus {
+public:
+    Corpus(const std::string& keyword, const std::unordered_set<std::string>& stopwords);
+
+    Word::allocator_type getAllocator();
+    TextSpill* getParagraphSpill();
+    void addPage(const std::string& path, Page&& page);
+    bool removePage(const std::string& path);
+    void removeFile(const std::string& path);
+    bool hasPage(const std::string& path) const;
+    std::vector<std::string> getPagePaths() const;
+
+    void setKeyword(const std::string& keyword);
+    void setPageSentiment(const std::string& path, const SentimentCounts& counts);
+    std::vector<std::string> takeUnclassifiedPages();
+    void getPageRepresentatives(const std::string& path, std::vector<std::string>& representatives,
+                                std::vector<int>& weights) const;
+    const std::vector<std::string>& getPageRelevantTexts(const std::string& path) const;
+    std::vector<std::string> getOccurrenceContexts(std::string_view word) const;
+
+    const WordMap& getWords() const;
+    const WordColumns& getColumns() const;
+    std::shared_ptr<const WordColumns> getColumnsSnapshot() const;
+    std::shared_ptr<const WordColumns> getTopPhrases(std::size_t limit) const;
+    int getRelevantTextCount() const;
+    SentimentCounts getSentiment() const;
+
+    int getPageCount() const;
+    int getTotalWords() const;
+    int getUniqueWords() const;
+    int getKeywordOccurrences() const;
+    const AnalysisArena& getArena() const;
+
+    bool hasChanges() const;
+    SegmentData takeChanges();
+
+private:
+    struct PageRecord {
+        using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+        explicit PageRecord(const allocator_type& alloc = {}) : words(alloc) {}
+        PageRecord(const PageRecord& other, const allocator_type& alloc)
+            : words(other.words, alloc), name(other.name), sourcePositions(other.sourcePositions),
+              document(other.document),
+              paragraphs(other.paragraphs), relevantTexts(other.relevantTexts), contextClusters(other.contextClusters),
+              keywordOccurrences(other.keywordOccurrences),
+              sentiment(other.sentiment) {}
+
+        std::pmr::vector<Word> words;
+        std::string name; // name of the page, shown in occurrence contexts
+        std::vector<std::size_t> sourcePositions; // position of every word in its WordSources, parallel to words
+        int document = -1; // id in the inverted index
+        std::vector<TextSpill::Range> paragraphs; // text of every paragraph in paragraphTexts
+        std::vector<std::string> relevantTexts; // distinct keyword-in-context windows
+        std::vector<int> contextClusters; // near-duplicate cluster of every relevant text
+        int keywordOccurrences = 0;
+        SentimentCounts sentiment;
+    };
+
+    void applyKeyword(const std::vector<InvertedIndex::Posting>& postings);
+    std::unordered_map<std::uint64_t, int> countPagePhrases(const PageRecord& record) const;
+    int countPhrase(const std::string& phrase, int beforeDocument) const;
+
+    // Declared first so that it outlives every container allocating from it
+    AnalysisArena arena;
+
+    std::string keyword;
+    TextSpill paragraphTexts; // cleaned paragraph text of every page read into the corpus
+    const std::unordered_set<std::string>& stopwords;
+    std::pmr::map<std::string, PageRecord> pages;
+    WordMap allWords;
+    WordColumns columns;
+    mutable PhraseCounter phraseCounter; // getTopPhrases() completes the exact counts it reports
+    InvertedIndex index;
+    NearDuplicateIndex nearDuplicates; // clusters of the relevant texts of all pages
+    std::set<std::string> unclassifiedPages; // pages whose clusters changed since the last takeUnclassifiedPages()
+    std::vector<PageRecord*> documents; // page record of every index document, nullptr once removed
+    mutable std::shared_ptr<const WordColumns> columnsSnapshot; // cached until the next change
+    std::set<std::string> changedPages; // pages added or removed since the last takeChanges()
+    long long wordPosition; // number of words ingested so far, including removed pages
+    int totalKeywordOccurrences;
+};
+
+#endif // CORPUS_H
@@ -0,0 +1,162 @@
+#include "directorywalker.h"
+#include "bytesource.h"
+#include <algorithm>
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs a DirectoryWalker that enumerates directory trees with several threads.
+ *
+ * Every thread takes a directory from a shared work queue, streams its entries with
+ * std::filesystem::directory_iterator and pushes any subdirectory back onto the work queue,
+ * so sibling directories are listed in parallel. Supported input files (see
+ * isSupportedInputFile()) are handed to the consumer as soon as they are discovered instead
+ * of being collected into a list first.
+ *
+ * @param threadCount The number of walker threads (at least one is used).
+ */
+DirectoryWalker::DirectoryWalker(unsigned int threadCount)
+    : threadCount(std::max(1u, threadCount)), files(nullptr), activeDirs(0), stopping(false) {}
+
+/**
+ * @brief Stops the walk if it is still running and joins all walker threads.
+ */
+DirectoryWalker::~DirectoryWalker()
+{
+    stop();
+    wait();
+}
+
+/**
+ * @brief Starts walking the tree below root in the background.
+ *
+ * Paths of supported input files are pushed to the given queue, which is closed once the whole tree
+ * has been enumerated (or the walk has been stopped). The caller consumes the queue while
+ * the walk is still in progress.
+ *
+ * @param root The directory to walk recursively.
+ * @param files Receives the path of every input file found. Must outlive the walk.
+ */
+void DirectoryWalker::start(const std::string& root, BlockingQueue<std::string>& files)
+{
+    this->files = &files;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = false;
+        directories.clear();
+        pendingDirs.clear();
+        pendingDirs.push_back(std::filesystem::path(root));
+        activeDirs = 1;
+    }
+    for (unsigned int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&DirectoryWalker::worker, this);
+    }
+}
+
+/**
+ * @brief Blocks until all walker threads have finished.
+ */
+void DirectoryWalker::wait()
+{
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
+
+/**
+ * @brief Abandons the walk; directories that have not been listed yet are skipped.
+ */
+void DirectoryWalker::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pendingDirs.clear();
+    }
+    workAvailable.notify_all();
+    if (files) {
+        files->close();
+    }
+}
+
+/**
+ * @brief Gets every directory that was listed during the walk, including the root.
+ *
+ * @return The directory paths, in no particular order.
+ */
+std::vector<std::string> DirectoryWalker::getDirectories() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return directories;
+}
+
+/**
+ * @brief Thread body: lists directories from the work queue until the tree is exhausted.
+ */
+void DirectoryWalker::worker()
+{
+    while (true) {
+        std::filesystem::path dir;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            workAvailable.wait(lock, [this] { return stopping || !pendingDirs.empty() || activeDirs == 0; });
+            if (stopping || pendingDirs.empty()) {
+                return;
+            }
+            dir = std::move(pendingDirs.front());
+            pendingDirs.pop_front();
+        }
+
+        scanDirectory(dir);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--activeDirs == 0) {
+            // Nothing queued and nothing being listed: the walk is complete
+            files->close();
+            workAvailable.notify_all();
+        }
+    }
+}
+
+/**
+ * @brief Lists one directory, queueing its subdirectories and emitting its input files.
+ *
+ * Unreadable entries are skipped. Symbolic links to directories are not followed so that
+ * link cycles cannot make the walk run forever.
+ *
+ * @param dir The directory to list.
+ */
+void DirectoryWalker::scanDirectory(const std::filesystem::path& dir)
+{
+    std::error_code error;
+    std::filesystem::directory_iterator it(dir, std::filesystem::directory_options::skip_permission_denied, error);
+    if (error) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        directories.push_back(dir.string());
+    }
+
+    for (; it != std::filesystem::directory_iterator(); it.increment(error)) {
+        if (error) {
+            break;
+        }
+        const std::filesystem::directory_entry& entry = *it;
+
+        if (entry.is_directory(error) && !entry.is_symlink(error)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (stopping) {
+                return;
+            }
+            pendingDirs.push_back(entry.path());
+            activeDirs++;
+            workAvailable.notify_one();
+        } else if (entry.is_regular_file(error) && isSupportedInputFile(entry.path().string())) {
+            if (!files->push(entry.path().string())) {
+                return; // consumer went away
+            }
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef DIRECTORYWALKER_H
+#define DIRECTORYWALKER_H
+
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <thread>
+#include <vector>
+#include "blockingqueue.h"
+
+class DirectoryWalker {
+public:
+    explicit DirectoryWalker(unsigned int threadCount = std::thread::hardware_concurrency());
+    ~DirectoryWalker();
+
+    DirectoryWalker(const DirectoryWalker&) = delete;
+    DirectoryWalker& operator=(const DirectoryWalker&) = delete;
+
+    void start(const std::string& root, BlockingQueue<std::string>& files);
+    void wait();
+    void stop();
+    std::vector<std::string> getDirectories() const;
+
+private:
+    void worker();
+    void scanDirectory(const std::filesystem::path& dir);
+
+    unsigned int threadCount;
+    BlockingQueue<std::string>* files;
+    std::vector<std::thread> threads;
+
+    mutable std::mutex mutex;
+    std::condition_variable workAvailable;
+    std::deque<std::filesystem::path> pendingDirs;
+    std::vector<std::string> directories;
+    int activeDirs;
+    bool stopping;
+};
+
+#endif // DIRECTORYWALKER_H
@@ -40,6 +40,11 @@ Args::Args() {
   pretrainedVectors = "";
   saveOutput = false;
   seed = 0;
+  deterministic = false;
+  pinThreads = false;
+  outputReplicas = 1;
+  batchSize = 1;
+  hotRows = 0;
 
   qout = false;
   retrain = false;
@@ -189,6 +194,18 @@ void Args::parseArgs(const std::vector<std::string>& args) {
         ai--;
       } else if (args[ai] == "-seed") {
         seed = std::stoi(args.at(ai + 1));
+      } else if (args[ai] == "-deterministic") {
+        deterministic = true;
+        ai--;
+      } else if (args[ai] == "-pinThreads") {
+        pinThreads = true;
+        ai--;
+      } else if (args[ai] == "-outputReplicas") {
+        outputReplicas = std::stoi(args.at(ai + 1));
+      } else if (args[ai] == "-batchSize") {
+        batchSize = std::stoi(args.at(ai + 1));
+      } else if (args[ai] == "-hotRows") {
+        hotRows = std::stoi(args.at(ai + 1));
       } else if (args[ai] == "-qnorm") {
         qnorm = true;
         ai--;
@@ -289,7 +306,22 @@ void Args::printTrainingHelp() {
       << pretrainedVectors << "]\n"
       << "  -saveOutput         whether output params should be saved ["
       << boolToString(saveOutput) << "]\n"
-      << "  -seed               random generator seed  [" << seed << "]\n";
+      << "  -seed               random generator seed  [" << seed << "]\n"
+      << "  -deterministic      train each thread on a fixed shard and apply "
+         "the threads' updates in a fixed order, for reproducible results; "
+         "threads train one at a time, so expect roughly single-thread speed ["
+      << boolToString(deterministic) << "]\n"
+      << "  -pinThreads         pin threads to CPUs, grouped by NUMA node ["
+      << boolToString(pinThreads) << "]\n"
+      << "  -outputReplicas     copies of the output matrix, one per group of "
+         "threads, averaged during supervised training ["
+      << outputReplicas << "]\n"
+      << "  -batchSize          examples per update, for supervised training "
+         "with softmax or ova loss (at most 4 with ova) ["
+      << batchSize << "]\n"
+      << "  -hotRows            most frequent words whose updates each thread "
+         "accumulates locally before writing them back ["
+      << hotRows << "]\n";
 }
 
 void Args::printAutotuneHelp() {
@@ -59,6 +59,11 @@ class Args {
   std::string pretrainedVectors;
   bool saveOutput;
   int seed;
+  bool deterministic;
+  bool pinThreads;
+  int outputReplicas;
+  int batchSize;
+  int hotRows;
 
   bool qout;
   bool retrain;
@@ -0,0 +1,284 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#include "binarycorpus.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace fasttext {
+
+namespace {
+
+const char kMagic[8] = {'F', 'T', 'C', 'O', 'R', 'P', 'U', 'S'};
+
+void pad(std::ofstream& out) {
+  while (out.tellp() % 8 != 0) {
+    out.put(0);
+  }
+}
+
+} // namespace
+
+bool BinaryCorpus::isCompiled(const std::string& filename) {
+  std::ifstream ifs(filename, std::ifstream::binary);
+  char magic[sizeof(kMagic)];
+  return ifs.read(magic, sizeof(magic)) &&
+      std::memcmp(magic, kMagic, sizeof(magic)) == 0;
+}
+
+// Builds the dictionary from args.input exactly as FastText::train() does,
+// then stores every line in the form the training loop consumes:
+// supervised lines as [nlabels, labels..., input features...], with subwords
+// and word n-grams already added; unsupervised lines as the ids of their
+// in-vocabulary words, since subsampling has to be redrawn in every epoch.
+void BinaryCorpus::compile(const Args& args) {
+  auto argsPtr = std::make_shared<Args>(args);
+  Dictionary dict(argsPtr);
+  dict.readFromFile(args.input);
+
+  std::ofstream ofs(args.output, std::ofstream::binary);
+  if (!ofs.is_open()) {
+    throw std::invalid_argument(args.output + " cannot be opened for saving.");
+  }
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = VERSION;
+  header.model = static_cast<int32_t>(args.model);
+  header.minCount = args.minCount;
+  header.minCountLabel = args.minCountLabel;
+  header.wordNgrams = args.wordNgrams;
+  header.bucket = args.bucket;
+  header.minn = args.minn;
+  header.maxn = args.maxn;
+  ofs.write((char*)&header, sizeof(header));
+  header.dictOffset = ofs.tellp();
+  dict.save(ofs);
+  pad(ofs);
+
+  header.valuesOffset = ofs.tellp();
+  std::vector<int64_t> lines(1, 0);
+  std::vector<int32_t> tokens;
+  std::vector<int32_t> words, labels;
+  std::ifstream ifs(args.input);
+  while (!ifs.eof()) {
+    int32_t ntokens;
+    if (args.model == model_name::sup) {
+      ntokens = dict.getLine(ifs, words, labels);
+    } else {
+      ntokens = dict.getLineIds(ifs, words);
+      labels.clear();
+    }
+    if (ntokens == 0) {
+      continue;
+    }
+    int32_t nlabels = labels.size();
+    ofs.write((char*)&nlabels, sizeof(int32_t));
+    ofs.write((char*)labels.data(), labels.size() * sizeof(int32_t));
+    ofs.write((char*)words.data(), words.size() * sizeof(int32_t));
+    lines.push_back(lines.back() + 1 + labels.size() + words.size());
+    tokens.push_back(ntokens);
+  }
+  ifs.close();
+  pad(ofs);
+
+  header.nlines = tokens.size();
+  header.nvalues = lines.back();
+  header.linesOffset = ofs.tellp();
+  ofs.write((char*)lines.data(), lines.size() * sizeof(int64_t));
+  header.tokensOffset = ofs.tellp();
+  ofs.write((char*)tokens.data(), tokens.size() * sizeof(int32_t));
+  pad(ofs);
+  header.fileSize = ofs.tellp();
+  ofs.seekp(0);
+  ofs.write((char*)&header, sizeof(header));
+  ofs.close();
+  if (!ofs) {
+    throw std::runtime_error("Writing " + args.output + " failed.");
+  }
+  if (args.verbose > 0) {
+    std::cerr << "Compiled " << header.nlines << " lines (" << header.nvalues
+              << " ids) into " << args.output << std::endl;
+  }
+}
+
+BinaryCorpus::BinaryCorpus(const std::string& filename)
+    : filename_(filename), data_(nullptr), size_(0) {
+#ifndef _WIN32
+  int fd = open(filename.c_str(), O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    if (fd >= 0) {
+      close(fd);
+    }
+    throw std::invalid_argument(filename + " cannot be opened for training!");
+  }
+  size_ = st.st_size;
+  void* mapping = size_ > 0
+      ? mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0)
+      : MAP_FAILED;
+  close(fd);
+  if (mapping == MAP_FAILED) {
+    throw std::invalid_argument(filename + " cannot be mapped for training!");
+  }
+  data_ = static_cast<const char*>(mapping);
+#else
+  std::ifstream ifs(filename, std::ifstream::binary);
+  if (!ifs.is_open()) {
+    throw std::invalid_argument(filename + " cannot be opened for training!");
+  }
+  buffer_.assign(
+      std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+  data_ = buffer_.data();
+  size_ = buffer_.size();
+#endif
+  if (size_ < sizeof(Header)) {
+    throw std::invalid_argument(filename + " is not a compiled corpus!");
+  }
+  std::memcpy(&header_, data_, sizeof(Header));
+  if (std::memcmp(header_.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header_.version != VERSION || header_.fileSize != size_ ||
+      header_.nlines <= 0 || header_.nvalues < header_.nlines ||
+      header_.valuesOffset < static_cast<int64_t>(sizeof(Header)) ||
+      header_.linesOffset < static_cast<int64_t>(sizeof(Header)) ||
+      header_.tokensOffset < static_cast<int64_t>(sizeof(Header)) ||
+      header_.valuesOffset % sizeof(int32_t) != 0 ||
+      header_.linesOffset % sizeof(int64_t) != 0 ||
+      header_.tokensOffset % sizeof(int32_t) != 0 ||
+      header_.linesOffset + (header_.nlines + 1) * sizeof(int64_t) > size_ ||
+      header_.tokensOffset + header_.nlines * sizeof(int32_t) > size_ ||
+      header_.valuesOffset + header_.nvalues * sizeof(int32_t) > size_) {
+    throw std::invalid_argument(
+        filename + " has wrong file format or version!");
+  }
+  values_ = reinterpret_cast<const int32_t*>(data_ + header_.valuesOffset);
+  lines_ = reinterpret_cast<const int64_t*>(data_ + header_.linesOffset);
+  tokens_ = reinterpret_cast<const int32_t*>(data_ + header_.tokensOffset);
+  // Training indexes the values through the line table without further
+  // checks, so every line has to lie within the values and hold its labels.
+  if (lines_[0] != 0 || lines_[header_.nlines] != header_.nvalues) {
+    throw std::invalid_argument(filename + " has a corrupted line table!");
+  }
+  for (int64_t i = 0; i < header_.nlines; i++) {
+    if (lines_[i + 1] <= lines_[i] || lines_[i + 1] > header_.nvalues) {
+      throw std::invalid_argument(filename + " has a corrupted line table!");
+    }
+    int32_t nlabels = values_[lines_[i]];
+    if (nlabels < 0 || nlabels >= lines_[i + 1] - lines_[i]) {
+      throw std::invalid_argument(
+          filename + " has a corrupted line " + std::to_string(i) + "!");
+    }
+  }
+}
+
+BinaryCorpus::~BinaryCorpus() {
+#ifndef _WIN32
+  if (data_) {
+    munmap(const_cast<char*>(data_), size_);
+  }
+#endif
+}
+
+// The stored ids are only valid for the arguments the dictionary and the
+// features were built with.
+void BinaryCorpus::checkArgs(const Args& args) const {
+  if (header_.model != static_cast<int32_t>(args.model) ||
+      header_.minCount != args.minCount ||
+      header_.minCountLabel != args.minCountLabel ||
+      header_.wordNgrams != args.wordNgrams || header_.bucket != args.bucket ||
+      header_.minn != args.minn || header_.maxn != args.maxn) {
+    throw std::invalid_argument(
+        filename_ +
+        " was compiled with a different model, minCount, minCountLabel, "
+        "wordNgrams, bucket, minn or maxn!");
+  }
+}
+
+std::shared_ptr<Dictionary> BinaryCorpus::loadDictionary(
+    std::shared_ptr<Args> args) const {
+  std::ifstream ifs(filename_, std::ifstream::binary);
+  ifs.seekg(header_.dictOffset);
+  auto dict = std::make_shared<Dictionary>(args, ifs);
+  if (!ifs) {
+    throw std::invalid_argument(filename_ + " has a corrupted dictionary!");
+  }
+  // Training uses the ids as row indices without further checks: features
+  // index the input matrix, labels the output matrix, and unsupervised words
+  // the discard table as well.
+  int64_t nfeatures = header_.model == static_cast<int32_t>(model_name::sup)
+      ? static_cast<int64_t>(dict->nwords()) + header_.bucket
+      : dict->nwords();
+  for (int64_t i = 0; i < header_.nlines; i++) {
+    const int32_t* values = values_ + lines_[i];
+    int32_t size = lines_[i + 1] - lines_[i];
+    int32_t nlabels = values[0];
+    for (int32_t j = 1; j < size; j++) {
+      int64_t limit = j <= nlabels ? dict->nlabels() : nfeatures;
+      if (values[j] < 0 || values[j] >= limit) {
+        throw std::invalid_argument(
+            filename_ + " has an id out of range in line " +
+            std::to_string(i) + "!");
+      }
+    }
+  }
+  return dict;
+}
+
+int64_t BinaryCorpus::nlines() const {
+  return header_.nlines;
+}
+
+const int32_t* BinaryCorpus::line(int64_t& position, int32_t& size) const {
+  if (position >= header_.nlines) {
+    position = 0;
+  }
+  const int32_t* values = values_ + lines_[position];
+  size = lines_[position + 1] - lines_[position];
+  return values;
+}
+
+int32_t BinaryCorpus::getLine(
+    int64_t& position,
+    std::vector<int32_t>& words,
+    std::vector<int32_t>& labels) const {
+  int32_t size;
+  const int32_t* values = line(position, size);
+  int32_t nlabels = values[0];
+  labels.assign(values + 1, values + 1 + nlabels);
+  words.assign(values + 1 + nlabels, values + size);
+  return tokens_[position++];
+}
+
+int32_t BinaryCorpus::getLine(
+    int64_t& position,
+    const Dictionary& dict,
+    std::vector<int32_t>& words,
+    std::minstd_rand& rng) const {
+  std::uniform_real_distribution<> uniform(0, 1);
+  int32_t size;
+  const int32_t* values = line(position, size);
+  words.clear();
+  for (int32_t i = 1; i < size; i++) {
+    if (!dict.discard(values[i], uniform(rng))) {
+      words.push_back(values[i]);
+    }
+  }
+  return tokens_[position++];
+}
+
+} // namespace fasttext
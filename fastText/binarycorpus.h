@@ -0,0 +1,81 @@
+/**
+ * Copyright (c) 2016-present, Facebook, Inc.
+ * All rights reserved.
+ *
+ * This source code is licensed under the MIT license found in the
+ * LICENSE file in the root directory of this source tree.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "args.h"
+#include "dictionary.h"
+
+namespace fasttext {
+
+// A training file that has been read once and stored as the dictionary plus,
+// for every line, the ids getLine() would return. Training from it maps the
+// file and copies ids instead of reading, hashing and looking up every token
+// again in every epoch.
+class BinaryCorpus {
+ protected:
+  static const int32_t VERSION = 1;
+
+  struct Header {
+    char magic[8];
+    int32_t version;
+    int32_t model;
+    int32_t minCount;
+    int32_t minCountLabel;
+    int32_t wordNgrams;
+    int32_t bucket;
+    int32_t minn;
+    int32_t maxn;
+    int64_t nlines;
+    int64_t nvalues;
+    int64_t dictOffset;
+    int64_t valuesOffset;
+    int64_t linesOffset;
+    int64_t tokensOffset;
+    int64_t fileSize;
+  };
+
+  std::string filename_;
+  const char* data_;
+  int64_t size_;
+  std::vector<char> buffer_;
+  Header header_;
+  const int32_t* values_;
+  const int64_t* lines_;
+  const int32_t* tokens_;
+
+  const int32_t* line(int64_t&, int32_t&) const;
+
+ public:
+  static bool isCompiled(const std::string&);
+  static void compile(const Args&);
+
+  explicit BinaryCorpus(const std::string&);
+  BinaryCorpus(const BinaryCorpus&) = delete;
+  BinaryCorpus& operator=(const BinaryCorpus&) = delete;
+  ~BinaryCorpus();
+
+  void checkArgs(const Args&) const;
+  std::shared_ptr<Dictionary> loadDictionary(std::shared_ptr<Args>) const;
+  int64_t nlines() const;
+  int32_t getLine(int64_t&, std::vector<int32_t>&, std::vector<int32_t>&)
+      const;
+  int32_t getLine(
+      int64_t&,
+      const Dictionary&,
+      std::vector<int32_t>&,
+      std::minstd_rand&) const;
+};
+
+} // namespace fasttext
@@ -8,6 +8,7 @@
 
 #include "densematrix.h"
 
+#include <algorithm>
 #include <random>
 #include <stdexcept>
 #include <thread>
@@ -46,11 +47,38 @@ void DenseMatrix::uniformThread(real a, int block, int32_t seed) {
   }
 }
 
-void DenseMatrix::uniform(real a, unsigned int thread, int32_t seed) {
+// Clears part `part` of `parts` equal parts of the matrix from `begin` on.
+void DenseMatrix::zeroThread(int64_t begin, int part, int parts) {
+  int64_t length = m_ * n_ - begin;
+  std::fill(
+      data_.begin() + begin + length * part / parts,
+      data_.begin() + begin + length * (part + 1) / parts,
+      0.0);
+}
+
+// With cpus, thread i runs on cpus[i], so that the pages it writes first are
+// allocated on that CPU's NUMA node.
+void DenseMatrix::uniform(
+    real a,
+    unsigned int thread,
+    int32_t seed,
+    const std::vector<int32_t>& cpus) {
+  // uniformThread() draws one tenth of the matrix per thread, so with fewer
+  // than ten threads the end of the matrix is not drawn. AlignedVector does
+  // not initialize its memory; each thread clears a share of that end too, so
+  // that those pages are also first written by a pinned thread.
+  const int64_t drawn =
+      std::min(m_ * n_, (m_ * n_) / 10 * std::max(1u, thread));
   if (thread > 1) {
     std::vector<std::thread> threads;
     for (int i = 0; i < thread; i++) {
-      threads.push_back(std::thread([=]() { uniformThread(a, i, seed); }));
+      threads.push_back(std::thread([=, &cpus]() {
+        if (!cpus.empty()) {
+          utils::pinThread(cpus[i]);
+        }
+        uniformThread(a, i, seed);
+        zeroThread(drawn, i, thread);
+      }));
     }
     for (int32_t i = 0; i < threads.size(); i++) {
       threads[i].join();
@@ -58,6 +86,7 @@ void DenseMatrix::uniform(real a, unsigned int thread, int32_t seed) {
   } else {
     // webassembly can't instantiate `std::thread`
     uniformThread(a, 0, seed);
+    zeroThread(drawn, 0, 1);
   }
 }
 
@@ -156,16 +185,32 @@ using Register = __m512;
 inline Register Add(Register first, Register second) { return _mm512_add_ps(first, second); }
 inline Register Set1(float to) { return _mm512_set1_ps(to); }
 inline Register Multiply(Register first, Register second) { return _mm512_mul_ps(first, second); }
+inline Register Load(const float* from) { return _mm512_loadu_ps(from); }
+inline void Store(float* to, Register value) { _mm512_storeu_ps(to, value); }
+inline float Sum(Register value) { return _mm512_reduce_add_ps(value); }
 #elif defined(__AVX__)
 using Register = __m256;
 inline Register Add(Register first, Register second) { return _mm256_add_ps(first, second); }
 inline Register Set1(float to) { return _mm256_set1_ps(to); }
 inline Register Multiply(Register first, Register second) { return _mm256_mul_ps(first, second); }
+inline Register Load(const float* from) { return _mm256_loadu_ps(from); }
+inline void Store(float* to, Register value) { _mm256_storeu_ps(to, value); }
+inline float Sum(Register value) {
+  __m128 half = _mm_add_ps(_mm256_castps256_ps128(value), _mm256_extractf128_ps(value, 1));
+  half = _mm_add_ps(half, _mm_movehl_ps(half, half));
+  return _mm_cvtss_f32(_mm_add_ss(half, _mm_shuffle_ps(half, half, 1)));
+}
 #elif defined(__SSE__)
 using Register = __m128;
 inline Register Add(Register first, Register second) { return _mm_add_ps(first, second); }
 inline Register Set1(float to) { return _mm_set1_ps(to); }
 inline Register Multiply(Register first, Register second) { return _mm_mul_ps(first, second); }
+inline Register Load(const float* from) { return _mm_loadu_ps(from); }
+inline void Store(float* to, Register value) { _mm_storeu_ps(to, value); }
+inline float Sum(Register value) {
+  value = _mm_add_ps(value, _mm_movehl_ps(value, value));
+  return _mm_cvtss_f32(_mm_add_ss(value, _mm_shuffle_ps(value, value, 1)));
+}
 #endif
 
 /* Faster routine for averaging rows of a matrix on x86.
@@ -236,6 +281,125 @@ void DenseMatrix::averageRowsToVector(Vector& x, const std::vector<int32_t>& row
   x.mul(1.0 / rows.size());
 }
 
+namespace {
+
+// Rows of the matrix that the batch kernels below work on at a time, small
+// enough to stay in the L1 cache while every example of the batch uses them.
+const int64_t kBatchTileRows = 32;
+
+// Dot products of one row with four vectors x, x + stride, ... at once, so
+// that every load of the row is used four times.
+void dotRow4(const real* row, const real* x, int64_t stride, int64_t n, real* out) {
+  int64_t j = 0;
+  real sums[4] = {0.0, 0.0, 0.0, 0.0};
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE__)
+  constexpr int64_t width = sizeof(Register) / sizeof(float);
+  Register accum[4] = {Set1(0.0), Set1(0.0), Set1(0.0), Set1(0.0)};
+  for (; j + width <= n; j += width) {
+    Register r = Load(row + j);
+    for (int64_t k = 0; k < 4; k++) {
+      accum[k] = Add(accum[k], Multiply(r, Load(x + k * stride + j)));
+    }
+  }
+  for (int64_t k = 0; k < 4; k++) {
+    sums[k] = Sum(accum[k]);
+  }
+#endif
+  for (; j < n; j++) {
+    for (int64_t k = 0; k < 4; k++) {
+      sums[k] += row[j] * x[k * stride + j];
+    }
+  }
+  std::copy(sums, sums + 4, out);
+}
+
+real dotRow1(const real* row, const real* x, int64_t n) {
+  int64_t j = 0;
+  real sum = 0.0;
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE__)
+  constexpr int64_t width = sizeof(Register) / sizeof(float);
+  Register accum = Set1(0.0);
+  for (; j + width <= n; j += width) {
+    accum = Add(accum, Multiply(Load(row + j), Load(x + j)));
+  }
+  sum = Sum(accum);
+#endif
+  for (; j < n; j++) {
+    sum += row[j] * x[j];
+  }
+  return sum;
+}
+
+// y += a * x
+void axpy(real a, const real* x, int64_t n, real* y) {
+  int64_t j = 0;
+#if defined(__AVX512F__) || defined(__AVX__) || defined(__SSE__)
+  constexpr int64_t width = sizeof(Register) / sizeof(float);
+  Register scale = Set1(a);
+  for (; j + width <= n; j += width) {
+    Store(y + j, Add(Load(y + j), Multiply(scale, Load(x + j))));
+  }
+#endif
+  for (; j < n; j++) {
+    y[j] += a * x[j];
+  }
+}
+
+} // namespace
+
+/* Scores of a batch of row-major vectors x (batch x cols()) against every
+ * row: out[b * rows() + i] = <row i, x[b]>. The matrix is walked in tiles of
+ * kBatchTileRows rows, each tile used by the whole batch before the next. */
+void DenseMatrix::dotRowsBatch(const real* x, int64_t batch, real* out) const {
+  real sums[4];
+  for (int64_t ib = 0; ib < m_; ib += kBatchTileRows) {
+    int64_t ie = std::min(m_, ib + kBatchTileRows);
+    int64_t b = 0;
+    for (; b + 4 <= batch; b += 4) {
+      for (int64_t i = ib; i < ie; i++) {
+        dotRow4(data_.data() + i * n_, x + b * n_, n_, n_, sums);
+        for (int64_t k = 0; k < 4; k++) {
+          out[(b + k) * m_ + i] = sums[k];
+        }
+      }
+    }
+    for (; b < batch; b++) {
+      for (int64_t i = ib; i < ie; i++) {
+        out[b * m_ + i] = dotRow1(data_.data() + i * n_, x + b * n_, n_);
+      }
+    }
+  }
+  for (int64_t k = 0; k < batch * m_; k++) {
+    if (std::isnan(out[k])) {
+      throw EncounteredNaNError();
+    }
+  }
+}
+
+/* Backward pass of dotRowsBatch() with the gradient coefficients alphas
+ * (batch x rows()): adds alphas[b * rows() + i] * row i to grads[b] (batch x
+ * cols()), then alphas[b * rows() + i] * x[b] to row i. As with one example
+ * at a time, the gradients use the rows from before this update. */
+void DenseMatrix::addRowsBatch(
+    const real* alphas,
+    const real* x,
+    int64_t batch,
+    real* grads) {
+  for (int64_t ib = 0; ib < m_; ib += kBatchTileRows) {
+    int64_t ie = std::min(m_, ib + kBatchTileRows);
+    for (int64_t b = 0; b < batch; b++) {
+      for (int64_t i = ib; i < ie; i++) {
+        axpy(alphas[b * m_ + i], data_.data() + i * n_, n_, grads + b * n_);
+      }
+    }
+    for (int64_t i = ib; i < ie; i++) {
+      for (int64_t b = 0; b < batch; b++) {
+        axpy(alphas[b * m_ + i], x + b * n_, n_, data_.data() + i * n_);
+      }
+    }
+  }
+}
+
 void DenseMatrix::save(std::ostream& out) const {
   out.write((char*)&m_, sizeof(int64_t));
   out.write((char*)&n_, sizeof(int64_t));
@@ -27,6 +27,7 @@ class DenseMatrix : public Matrix {
  protected:
   intgemm::AlignedVector<real> data_;
   void uniformThread(real, int, int32_t);
+  void zeroThread(int64_t, int, int);
 
  public:
   DenseMatrix();
@@ -60,7 +61,11 @@ class DenseMatrix : public Matrix {
     return n_;
   }
   void zero();
-  void uniform(real, unsigned int, int32_t);
+  void uniform(
+      real,
+      unsigned int,
+      int32_t,
+      const std::vector<int32_t>& cpus = {});
 
   void multiplyRow(const Vector& nums, int64_t ib = 0, int64_t ie = -1);
   void divideRow(const Vector& denoms, int64_t ib = 0, int64_t ie = -1);
@@ -73,6 +78,8 @@ class DenseMatrix : public Matrix {
   void addRowToVector(Vector& x, int32_t i) const override;
   void addRowToVector(Vector& x, int32_t i, real a) const override;
   void averageRowsToVector(Vector& x, const std::vector<int32_t>& rows) const override;
+  void dotRowsBatch(const real* x, int64_t batch, real* out) const;
+  void addRowsBatch(const real* alphas, const real* x, int64_t batch, real* grads);
   void save(std::ostream&) const override;
   void load(std::istream&) override;
   void dump(std::ostream&) const override;
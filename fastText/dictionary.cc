@@ -7,25 +7,34 @@
  */
 
 #include "dictionary.h"
+#include "utils.h"
 
 #include <assert.h>
 
 #include <algorithm>
 #include <cmath>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <iterator>
 #include <stdexcept>
+#include <thread>
+
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
 
 namespace fasttext {
 
 const std::string Dictionary::EOS = "</s>";
 const std::string Dictionary::BOW = "<";
 const std::string Dictionary::EOW = ">";
+const int32_t Dictionary::kGroupWidth;
+const int8_t Dictionary::kEmpty;
 
 Dictionary::Dictionary(std::shared_ptr<Args> args)
     : args_(args),
-      word2int_(MAX_VOCAB_SIZE, -1),
+      word2int_(MAX_VOCAB_SIZE / kGroupWidth, emptyGroup()),
       size_(0),
       nwords_(0),
       nlabels_(0),
@@ -46,27 +55,107 @@ int32_t Dictionary::find(const std::string_view w) const {
   return find(w, hash(w));
 }
 
+namespace {
+
+// Bit i of matches is set if control byte i of the group equals tag, bit i of
+// empties if control byte i is empty (the only value with the high bit set).
+// Only the low width bits are meaningful.
+inline void matchGroup(
+    const int8_t* group,
+    int8_t tag,
+    uint32_t& matches,
+    uint32_t& empties) {
+#if defined(__SSE2__)
+  __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+  matches = _mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(tag)));
+  empties = _mm_movemask_epi8(ctrl);
+#else
+  matches = 0;
+  empties = 0;
+  for (int32_t i = 0; i < 16; i++) {
+    matches |= uint32_t(group[i] == tag) << i;
+    empties |= uint32_t(group[i] < 0) << i;
+  }
+#endif
+}
+
+inline int32_t lowestBit(uint32_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return __builtin_ctz(bits);
+#else
+  int32_t i = 0;
+  while (!(bits & 1)) {
+    bits >>= 1;
+    i++;
+  }
+  return i;
+#endif
+}
+
+} // namespace
+
+// Probes groups of kGroupWidth slots linearly. Each group is one cache line
+// holding one control byte per slot (7 bits of the hash, or kEmpty) and the
+// slot ids, so one vector comparison finds the few slots worth checking and
+// words_ is only read for those.
 int32_t Dictionary::find(const std::string_view w, uint32_t h) const {
-  int32_t word2intsize = word2int_.size();
-  int32_t id = h % word2intsize;
-  while (word2int_[id] != -1 && words_[word2int_[id]].word != w) {
-    id = (id + 1) % word2intsize;
+  int32_t ngroups = word2int_.size();
+  int32_t g = h % ngroups;
+  int8_t tag = h >> 25;
+  while (true) {
+    const Group& group = word2int_[g];
+    uint32_t matches, empties;
+    matchGroup(group.ctrl, tag, matches, empties);
+    matches &= (1u << kGroupWidth) - 1;
+    empties &= (1u << kGroupWidth) - 1;
+    while (matches) {
+      int32_t i = lowestBit(matches);
+      if (words_[group.ids[i]].word == w) {
+        return g * kGroupWidth + i;
+      }
+      matches &= matches - 1;
+    }
+    if (empties) {
+      return g * kGroupWidth + lowestBit(empties);
+    }
+    g = g + 1 < ngroups ? g + 1 : 0;
   }
-  return id;
+}
+
+Dictionary::Group Dictionary::emptyGroup() {
+  Group group;
+  std::fill(group.ctrl, group.ctrl + 16, kEmpty);
+  std::fill(group.ids, group.ids + kGroupWidth, -1);
+  return group;
+}
+
+int32_t Dictionary::slotId(int32_t slot) const {
+  return word2int_[slot / kGroupWidth].ids[slot % kGroupWidth];
+}
+
+void Dictionary::insertSlot(int32_t slot, uint32_t h, int32_t id) {
+  Group& group = word2int_[slot / kGroupWidth];
+  group.ctrl[slot % kGroupWidth] = h >> 25;
+  group.ids[slot % kGroupWidth] = id;
+}
+
+void Dictionary::resetTable(int32_t size) {
+  word2int_.assign((size + kGroupWidth - 1) / kGroupWidth, emptyGroup());
 }
 
 void Dictionary::add(const std::string& w) {
-  int32_t h = find(w);
+  uint32_t wh = hash(w);
+  int32_t h = find(w, wh);
   ntokens_++;
-  if (word2int_[h] == -1) {
+  if (slotId(h) == -1) {
     entry e;
     e.word = w;
     e.count = 1;
     e.type = getType(w);
     words_.push_back(e);
-    word2int_[h] = size_++;
+    insertSlot(h, wh, size_++);
   } else {
-    words_[word2int_[h]].count++;
+    words_[slotId(h)].count++;
   }
 }
 
@@ -82,21 +171,23 @@ int64_t Dictionary::ntokens() const {
   return ntokens_;
 }
 
-const std::vector<int32_t>& Dictionary::getSubwords(int32_t i) const {
+SubwordRange Dictionary::getSubwords(int32_t i) const {
   assert(i >= 0);
   assert(i < nwords_);
-  return words_[i].subwords;
+  const int32_t* data = subwords_.data();
+  return SubwordRange(data + subwordOffsets_[i], data + subwordOffsets_[i + 1]);
 }
 
 const std::vector<int32_t> Dictionary::getSubwords(
     const std::string& word) const {
   int32_t i = getId(word);
   if (i >= 0) {
-    return getSubwords(i);
+    SubwordRange ngrams = getSubwords(i);
+    return std::vector<int32_t>(ngrams.begin(), ngrams.end());
   }
   std::vector<int32_t> ngrams;
   if (word != EOS) {
-    computeSubwords(BOW + word + EOW, ngrams);
+    computeTokenSubwords(word, ngrams);
   }
   return ngrams;
 }
@@ -128,12 +219,12 @@ bool Dictionary::discard(int32_t id, real rand) const {
 
 int32_t Dictionary::getId(const std::string_view w, uint32_t h) const {
   int32_t id = find(w, h);
-  return word2int_[id];
+  return slotId(id);
 }
 
 int32_t Dictionary::getId(const std::string_view w) const {
   int32_t h = find(w);
-  return word2int_[h];
+  return slotId(h);
 }
 
 entry_type Dictionary::getType(int32_t id) const {
@@ -174,20 +265,19 @@ void Dictionary::computeSubwords(
     std::vector<int32_t>& ngrams,
     std::vector<std::string>* substrings) const {
   for (size_t i = 0; i < word.size(); i++) {
-    std::string ngram;
     if ((word[i] & 0xC0) == 0x80) {
       continue;
     }
+    uint32_t h = 2166136261;
     for (size_t j = i, n = 1; j < word.size() && n <= args_->maxn; n++) {
-      ngram.push_back(word[j++]);
+      h = (h ^ uint32_t(int8_t(word[j++]))) * 16777619;
       while (j < word.size() && (word[j] & 0xC0) == 0x80) {
-        ngram.push_back(word[j++]);
+        h = (h ^ uint32_t(int8_t(word[j++]))) * 16777619;
       }
       if (n >= args_->minn && !(n == 1 && (i == 0 || j == word.size()))) {
-        int32_t h = hash(ngram) % args_->bucket;
-        pushHash(ngrams, h);
+        pushHash(ngrams, h % args_->bucket);
         if (substrings) {
-          substrings->push_back(ngram);
+          substrings->push_back(word.substr(i, j - i));
         }
       }
     }
@@ -195,14 +285,18 @@ void Dictionary::computeSubwords(
 }
 
 void Dictionary::initNgrams() {
+  subwords_.clear();
+  subwordOffsets_.clear();
+  subwordOffsets_.reserve(size_ + 1);
+  subwordOffsets_.push_back(0);
   for (size_t i = 0; i < size_; i++) {
-    std::string word = BOW + words_[i].word + EOW;
-    words_[i].subwords.clear();
-    words_[i].subwords.push_back(i);
+    subwords_.push_back(i);
     if (words_[i].word != EOS) {
-      computeSubwords(word, words_[i].subwords);
+      computeTokenSubwords(words_[i].word, subwords_);
     }
+    subwordOffsets_.push_back(subwords_.size());
   }
+  subwords_.shrink_to_fit();
 }
 
 bool Dictionary::readWord(std::istream& in, std::string& word) const {
@@ -244,6 +338,195 @@ void Dictionary::readFromFile(std::istream& in) {
       threshold(minThreshold, minThreshold);
     }
   }
+  finishReading();
+}
+
+namespace {
+
+// Word counts of one byte range of the input, in order of first occurrence.
+struct ChunkCounts {
+  struct Count {
+    std::string word;
+    uint32_t h;
+    int64_t count;
+    int64_t first;
+  };
+
+  std::vector<Count> words;
+  std::vector<int32_t> table;
+  int64_t ntokens = 0;
+
+  ChunkCounts() : table(1 << 16, -1) {}
+
+  void add(const std::string& w, uint32_t h, int64_t count, int64_t first) {
+    size_t mask = table.size() - 1;
+    size_t i = h & mask;
+    while (table[i] != -1) {
+      Count& c = words[table[i]];
+      if (c.h == h && c.word == w) {
+        c.count += count;
+        return;
+      }
+      i = (i + 1) & mask;
+    }
+    table[i] = words.size();
+    words.push_back({w, h, count, first});
+    if (2 * words.size() > table.size()) {
+      table.assign(2 * table.size(), -1);
+      mask = table.size() - 1;
+      for (int32_t j = 0; j < words.size(); j++) {
+        i = words[j].h & mask;
+        while (table[i] != -1) {
+          i = (i + 1) & mask;
+        }
+        table[i] = j;
+      }
+    }
+  }
+};
+
+bool isSpace(int c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\v' ||
+      c == '\f' || c == '\0';
+}
+
+// Splits [start, end) into words exactly like Dictionary::readWord() and
+// counts them; first is the chunk index followed by the word's position in
+// the chunk, so that sorting by it restores the order of the whole file.
+void countChunk(
+    const std::string& filename,
+    int64_t chunk,
+    int64_t start,
+    int64_t end,
+    const std::string& eos,
+    uint32_t eosHash,
+    ChunkCounts& counts) {
+  std::ifstream ifs(filename);
+  ifs.seekg(start);
+  std::vector<char> buffer(1 << 20);
+  std::string word;
+  uint32_t h = 2166136261;
+  auto add = [&](const std::string& w, uint32_t wh) {
+    counts.ntokens++;
+    counts.add(w, wh, 1, (chunk << 40) | counts.words.size());
+  };
+  for (int64_t remaining = end - start; remaining > 0;) {
+    ifs.read(
+        buffer.data(), std::min<int64_t>(buffer.size(), remaining));
+    int64_t n = ifs.gcount();
+    if (n == 0) {
+      break;
+    }
+    remaining -= n;
+    for (int64_t i = 0; i < n; i++) {
+      char c = buffer[i];
+      if (isSpace(c)) {
+        if (!word.empty()) {
+          add(word, h);
+          word.clear();
+          h = 2166136261;
+        }
+        if (c == '\n') {
+          add(eos, eosHash);
+        }
+      } else {
+        word.push_back(c);
+        h = (h ^ uint32_t(int8_t(c))) * 16777619;
+      }
+    }
+  }
+  if (!word.empty()) {
+    add(word, h);
+  }
+}
+
+} // namespace
+
+// Counts the words of the file with args_->thread threads and produces the
+// same dictionary as readFromFile(std::istream&): the file is split into
+// byte ranges that end at newlines, every thread counts its range, and the
+// counts are merged by hash partition. Words are then added in order of
+// their first occurrence in the file, which is the order add() sees them in,
+// so threshold() sorts them into the same ids. If the vocabulary is so large
+// that the serial pass would have pruned it while reading, the file is read
+// again serially.
+void Dictionary::readFromFile(const std::string& filename) {
+  std::ifstream ifs(filename);
+  if (!ifs.is_open()) {
+    throw std::invalid_argument(filename + " cannot be opened for training!");
+  }
+  int32_t nthreads = args_->thread;
+  if (nthreads <= 1) {
+    readFromFile(ifs);
+    return;
+  }
+
+  std::vector<int64_t> bounds = utils::lineShards(ifs, nthreads);
+  ifs.close();
+
+  uint32_t eosHash = hash(EOS);
+  std::vector<ChunkCounts> chunks(nthreads);
+  std::vector<std::thread> threads;
+  for (int32_t i = 0; i < nthreads; i++) {
+    threads.emplace_back([&, i]() {
+      countChunk(
+          filename, i, bounds[i], bounds[i + 1], EOS, eosHash, chunks[i]);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  threads.clear();
+
+  std::vector<ChunkCounts> partitions(nthreads);
+  for (int32_t p = 0; p < nthreads; p++) {
+    threads.emplace_back([&, p]() {
+      for (const ChunkCounts& chunk : chunks) {
+        for (const ChunkCounts::Count& c : chunk.words) {
+          if (c.h % nthreads == p) {
+            partitions[p].add(c.word, c.h, c.count, c.first);
+          }
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  chunks.clear();
+
+  std::vector<ChunkCounts::Count*> merged;
+  for (ChunkCounts& partition : partitions) {
+    for (ChunkCounts::Count& c : partition.words) {
+      merged.push_back(&c);
+    }
+  }
+  if (merged.size() > 0.75 * MAX_VOCAB_SIZE) {
+    ifs.open(filename);
+    readFromFile(ifs);
+    return;
+  }
+  std::sort(
+      merged.begin(),
+      merged.end(),
+      [](const ChunkCounts::Count* a, const ChunkCounts::Count* b) {
+        return a->first < b->first;
+      });
+
+  words_.reserve(merged.size());
+  for (ChunkCounts::Count* c : merged) {
+    entry e;
+    e.type = getType(c->word);
+    e.word = std::move(c->word);
+    e.count = c->count;
+    insertSlot(find(e.word, c->h), c->h, size_++);
+    ntokens_ += c->count;
+    words_.push_back(std::move(e));
+  }
+  finishReading();
+}
+
+void Dictionary::finishReading() {
   threshold(args_->minCount, args_->minCountLabel);
   initTableDiscard();
   initNgrams();
@@ -278,10 +561,10 @@ void Dictionary::threshold(int64_t t, int64_t tl) {
   size_ = 0;
   nwords_ = 0;
   nlabels_ = 0;
-  std::fill(word2int_.begin(), word2int_.end(), -1);
+  resetTable(word2int_.size() * kGroupWidth);
   for (auto it = words_.begin(); it != words_.end(); ++it) {
-    int32_t h = find(it->word);
-    word2int_[h] = size_++;
+    uint32_t wh = hash(it->word);
+    insertSlot(find(it->word, wh), wh, size_++);
     if (it->type == entry_type::word) {
       nwords_++;
     }
@@ -328,23 +611,125 @@ void Dictionary::addSubwords(
     int32_t wid) const {
   if (wid < 0) { // out of vocab
     if (token != EOS) {
-      std::string concat;
-      concat.reserve(BOW.size() + token.size() + EOW.size());
-      concat += BOW;
-      concat.append(token.data(), token.size());
-      concat += EOW;
-      computeSubwords(concat, line);
+      computeTokenSubwords(token, line);
     }
   } else {
     if (args_->maxn <= 0) { // in vocab w/o subwords
       line.push_back(wid);
     } else { // in vocab w/ subwords
-      const std::vector<int32_t>& ngrams = getSubwords(wid);
+      SubwordRange ngrams = getSubwords(wid);
       line.insert(line.end(), ngrams.cbegin(), ngrams.cend());
     }
   }
 }
 
+namespace {
+
+// Limits of the ASCII path of computeTokenSubwords(), which keeps the hashes
+// of every n-gram of the bracketed token on the stack.
+const size_t kMaxAsciiWordSize = 64;
+const int32_t kMaxAsciiNgram = 8;
+
+bool isAscii(const std::string_view s) {
+  uint8_t bits = 0;
+  for (char c : s) {
+    bits |= uint8_t(c);
+  }
+  return bits < 0x80;
+}
+
+// One FNV-1a step on four 32-bit hashes, adding the bytes at c[0] to c[3].
+// SSE2 has no 32-bit multiply, but the FNV prime is 2^24 + 2^8 + 0x93.
+inline void fnvStep4(const uint32_t* h, const uint8_t* c, uint32_t* out) {
+#if defined(__SSE2__)
+  int32_t bytes;
+  std::memcpy(&bytes, c, sizeof(bytes));
+  __m128i zero = _mm_setzero_si128();
+  __m128i x = _mm_unpacklo_epi16(
+      _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero), zero);
+  x = _mm_xor_si128(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(h)), x);
+  x = _mm_add_epi32(
+      _mm_add_epi32(
+          _mm_add_epi32(x, _mm_slli_epi32(x, 1)),
+          _mm_add_epi32(_mm_slli_epi32(x, 4), _mm_slli_epi32(x, 7))),
+      _mm_add_epi32(_mm_slli_epi32(x, 8), _mm_slli_epi32(x, 24)));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), x);
+#else
+  for (int32_t k = 0; k < 4; k++) {
+    out[k] = (h[k] ^ uint32_t(c[k])) * 16777619;
+  }
+#endif
+}
+
+} // namespace
+
+// Same n-grams as computeSubwords(BOW + token + EOW, ngrams), but hashed
+// incrementally without building the bracketed word or any n-gram string.
+void Dictionary::computeTokenSubwords(
+    const std::string_view token,
+    std::vector<int32_t>& ngrams) const {
+  const size_t size = BOW.size() + token.size() + EOW.size();
+  if (size <= kMaxAsciiWordSize && args_->maxn <= kMaxAsciiNgram &&
+      isAscii(token)) {
+    computeAsciiSubwords(token, ngrams);
+    return;
+  }
+  auto at = [&](size_t k) {
+    if (k < BOW.size()) {
+      return BOW[k];
+    }
+    k -= BOW.size();
+    return k < token.size() ? token[k] : EOW[k - token.size()];
+  };
+  for (size_t i = 0; i < size; i++) {
+    if ((at(i) & 0xC0) == 0x80) {
+      continue;
+    }
+    uint32_t h = 2166136261;
+    for (size_t j = i, n = 1; j < size && n <= args_->maxn; n++) {
+      h = (h ^ uint32_t(int8_t(at(j++)))) * 16777619;
+      while (j < size && (at(j) & 0xC0) == 0x80) {
+        h = (h ^ uint32_t(int8_t(at(j++)))) * 16777619;
+      }
+      if (n >= args_->minn && !(n == 1 && (i == 0 || j == size))) {
+        pushHash(ngrams, h % args_->bucket);
+      }
+    }
+  }
+}
+
+// Without UTF-8 continuation bytes every n-gram is n bytes long, so the
+// hashes of all n-grams of one length are those one byte shorter extended at
+// every start position, four positions at a time. The n-grams are then
+// emitted in the order of computeSubwords().
+void Dictionary::computeAsciiSubwords(
+    const std::string_view token,
+    std::vector<int32_t>& ngrams) const {
+  const int32_t size = BOW.size() + token.size() + EOW.size();
+  const int32_t maxn = args_->maxn;
+  uint8_t word[kMaxAsciiWordSize + kMaxAsciiNgram] = {};
+  std::copy(BOW.begin(), BOW.end(), word);
+  std::copy(token.begin(), token.end(), word + BOW.size());
+  std::copy(EOW.begin(), EOW.end(), word + BOW.size() + token.size());
+
+  uint32_t hashes[kMaxAsciiNgram + 1][kMaxAsciiWordSize];
+  std::fill(hashes[0], hashes[0] + kMaxAsciiWordSize, 2166136261);
+  for (int32_t n = 1; n <= maxn; n++) {
+    for (int32_t i = 0; i < size; i += 4) {
+      fnvStep4(hashes[n - 1] + i, word + i + n - 1, hashes[n] + i);
+    }
+  }
+
+  for (int32_t i = 0; i < size; i++) {
+    for (int32_t n = 1; n <= maxn && i + n <= size; n++) {
+      if (n >= args_->minn && !(n == 1 && (i == 0 || i + n == size))) {
+        pushHash(ngrams, hashes[n][i] % args_->bucket);
+      }
+    }
+  }
+}
+
 void Dictionary::reset(std::istream& in) const {
   if (in.eof()) {
     in.clear();
@@ -357,6 +742,20 @@ int32_t Dictionary::getLine(
     std::vector<int32_t>& words,
     std::minstd_rand& rng) const {
   std::uniform_real_distribution<> uniform(0, 1);
+  int32_t ntokens = getLineIds(in, words);
+  words.erase(
+      std::remove_if(
+          words.begin(),
+          words.end(),
+          [&](int32_t wid) { return discard(wid, uniform(rng)); }),
+      words.end());
+  return ntokens;
+}
+
+// The words of the next line before subsampling, i.e. what getLine() keeps
+// when nothing is discarded.
+int32_t Dictionary::getLineIds(std::istream& in, std::vector<int32_t>& words)
+    const {
   std::string token;
   int32_t ntokens = 0;
 
@@ -364,13 +763,13 @@ int32_t Dictionary::getLine(
   words.clear();
   while (readWord(in, token)) {
     int32_t h = find(token);
-    int32_t wid = word2int_[h];
+    int32_t wid = slotId(h);
     if (wid < 0) {
       continue;
     }
 
     ntokens++;
-    if (getType(wid) == entry_type::word && !discard(wid, uniform(rng))) {
+    if (getType(wid) == entry_type::word) {
       words.push_back(wid);
     }
     if (ntokens > MAX_LINE_SIZE || token == EOS) {
@@ -456,6 +855,32 @@ int32_t Dictionary::getStringNoNewline(
   return ntokens;
 }
 
+// Adds the input features of one already split token, as getLine() does
+// during training; h must be hash(token). Labels add no features. Returns the
+// id of the token, or -1 if it is out of vocabulary.
+int32_t Dictionary::addToken(
+    std::vector<int32_t>& words,
+    std::vector<int32_t>& word_hashes,
+    const std::string_view token,
+    uint32_t h) const {
+  int32_t wid = getId(token, h);
+  entry_type type = wid < 0 ? getType(token) : getType(wid);
+  if (type == entry_type::word) {
+    addSubwords(words, token, wid);
+    word_hashes.push_back(h);
+  }
+  return wid;
+}
+
+// Completes a line built with addToken(): adds the end-of-sentence token that
+// readWord() appends to every training line, then the word n-grams.
+void Dictionary::endLine(
+    std::vector<int32_t>& words,
+    std::vector<int32_t>& word_hashes) const {
+  addToken(words, word_hashes, EOS, hash(EOS));
+  addWordNgrams(words, word_hashes, args_->wordNgrams);
+}
+
 void Dictionary::pushHash(std::vector<int32_t>& hashes, int32_t id) const {
   if (pruneidx_size_ == 0 || id < 0) {
     return;
@@ -526,9 +951,10 @@ void Dictionary::load(std::istream& in) {
   initNgrams();
 
   int32_t word2intsize = std::ceil(size_ / 0.7);
-  word2int_.assign(word2intsize, -1);
+  resetTable(word2intsize);
   for (int32_t i = 0; i < size_; i++) {
-    word2int_[find(words_[i].word)] = i;
+    uint32_t wh = hash(words_[i].word);
+    insertSlot(find(words_[i].word, wh), wh, i);
   }
 }
 
@@ -559,14 +985,15 @@ void Dictionary::prune(std::vector<int32_t>& idx) {
   }
   pruneidx_size_ = pruneidx_.size();
 
-  std::fill(word2int_.begin(), word2int_.end(), -1);
+  resetTable(word2int_.size() * kGroupWidth);
 
   int32_t j = 0;
   for (int32_t i = 0; i < words_.size(); i++) {
     if (getType(i) == entry_type::label ||
         (j < words.size() && words[j] == i)) {
       words_[j] = words_[i];
-      word2int_[find(words_[j].word)] = j;
+      uint32_t wh = hash(words_[j].word);
+      insertSlot(find(words_[j].word, wh), wh, j);
       j++;
     }
   }
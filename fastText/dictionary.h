@@ -29,25 +29,72 @@ struct entry {
   std::string word;
   int64_t count;
   entry_type type;
-  std::vector<int32_t> subwords;
+};
+
+// Read-only view of the subword ids of one dictionary entry.
+class SubwordRange {
+ public:
+  SubwordRange(const int32_t* begin, const int32_t* end)
+      : begin_(begin), end_(end) {}
+  const int32_t* begin() const {
+    return begin_;
+  }
+  const int32_t* end() const {
+    return end_;
+  }
+  const int32_t* cbegin() const {
+    return begin_;
+  }
+  const int32_t* cend() const {
+    return end_;
+  }
+  size_t size() const {
+    return end_ - begin_;
+  }
+  int32_t operator[](size_t i) const {
+    return begin_[i];
+  }
+
+ private:
+  const int32_t* begin_;
+  const int32_t* end_;
 };
 
 class Dictionary {
  protected:
   static const int32_t MAX_VOCAB_SIZE = 30000000;
   static const int32_t MAX_LINE_SIZE = 1024;
+  static const int32_t kGroupWidth = 12;
+  static const int8_t kEmpty = -128;
 
   int32_t find(const std::string_view) const;
   int32_t find(const std::string_view, uint32_t h) const;
+  int32_t slotId(int32_t) const;
+  void insertSlot(int32_t, uint32_t, int32_t);
+  void resetTable(int32_t);
   void initTableDiscard();
   void initNgrams();
+  void finishReading();
   void reset(std::istream&) const;
   void pushHash(std::vector<int32_t>&, int32_t) const;
   void addSubwords(std::vector<int32_t>&, const std::string_view, int32_t) const;
+  void computeTokenSubwords(const std::string_view, std::vector<int32_t>&) const;
+  void computeAsciiSubwords(const std::string_view, std::vector<int32_t>&) const;
 
   std::shared_ptr<Args> args_;
-  std::vector<int32_t> word2int_;
+  struct alignas(64) Group {
+    int8_t ctrl[16];
+    int32_t ids[kGroupWidth];
+  };
+  static Group emptyGroup();
+
+  std::vector<Group> word2int_;
   std::vector<entry> words_;
+  // Subword ids of entry i are subwords_[subwordOffsets_[i]] up to
+  // subwords_[subwordOffsets_[i + 1]], so entries are laid out by id, i.e.
+  // by decreasing frequency.
+  std::vector<int32_t> subwords_;
+  std::vector<int64_t> subwordOffsets_;
 
   std::vector<real> pdiscard_;
   int32_t size_;
@@ -78,7 +125,7 @@ class Dictionary {
   entry_type getType(const std::string_view) const;
   bool discard(int32_t, real) const;
   std::string getWord(int32_t) const;
-  const std::vector<int32_t>& getSubwords(int32_t) const;
+  SubwordRange getSubwords(int32_t) const;
   const std::vector<int32_t> getSubwords(const std::string&) const;
   void getSubwords(
       const std::string&,
@@ -92,6 +139,7 @@ class Dictionary {
   void add(const std::string&);
   bool readWord(std::istream&, std::string&) const;
   void readFromFile(std::istream&);
+  void readFromFile(const std::string&);
   std::string getLabel(int32_t) const;
   void save(std::ostream&) const;
   void load(std::istream&);
@@ -100,8 +148,15 @@ class Dictionary {
       const;
   int32_t getLine(std::istream&, std::vector<int32_t>&, std::minstd_rand&)
       const;
+  int32_t getLineIds(std::istream&, std::vector<int32_t>&) const;
   int32_t getStringNoNewline(std::string_view, std::vector<int32_t>&,
       std::vector<int32_t>&) const;
+  int32_t addToken(
+      std::vector<int32_t>&,
+      std::vector<int32_t>&,
+      const std::string_view,
+      uint32_t) const;
+  void endLine(std::vector<int32_t>&, std::vector<int32_t>&) const;
   void threshold(int64_t, int64_t);
   void prune(std::vector<int32_t>&);
   bool isPruned() {
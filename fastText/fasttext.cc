@@ -11,8 +11,10 @@
 #include "quantmatrix.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <stdexcept>
@@ -48,7 +50,10 @@ std::shared_ptr<Loss> FastText::createLoss(std::shared_ptr<Matrix>& output) {
 }
 
 FastText::FastText()
-    : quant_(false), wordVectors_(nullptr), trainException_(nullptr) {}
+    : quant_(false),
+      wordVectors_(nullptr),
+      trainException_(nullptr),
+      turn_(0) {}
 
 void FastText::addInputVector(Vector& vec, int32_t ind) const {
   vec.addRow(*input_, ind);
@@ -340,9 +345,10 @@ void FastText::quantize(const Args& qargs, const TrainCallback& callback) {
     std::shared_ptr<DenseMatrix> ninput =
         std::make_shared<DenseMatrix>(idx.size(), args_->dim);
     for (auto i = 0; i < idx.size(); i++) {
-      for (auto j = 0; j < args_->dim; j++) {
-        ninput->at(i, j) = input->at(idx[i], j);
-      }
+      std::copy_n(
+          input->data() + int64_t(idx[i]) * args_->dim,
+          args_->dim,
+          ninput->data() + int64_t(i) * args_->dim);
     }
     input = ninput;
     if (qargs.retrain) {
@@ -356,11 +362,11 @@ void FastText::quantize(const Args& qargs, const TrainCallback& callback) {
     }
   }
   input_ = std::make_shared<QuantMatrix>(
-      std::move(*(input.get())), qargs.dsub, qargs.qnorm);
+      std::move(*(input.get())), qargs.dsub, qargs.qnorm, qargs.thread);
 
   if (args_->qout) {
     output_ = std::make_shared<QuantMatrix>(
-        std::move(*(output.get())), 2, qargs.qnorm);
+        std::move(*(output.get())), 2, qargs.qnorm, qargs.thread);
   }
   quant_ = true;
   auto loss = createLoss(output_);
@@ -368,6 +374,7 @@ void FastText::quantize(const Args& qargs, const TrainCallback& callback) {
 }
 
 void FastText::supervised(
+    Model& model,
     Model::State& state,
     real lr,
     const std::vector<int32_t>& line,
@@ -375,12 +382,19 @@ void FastText::supervised(
   if (labels.size() == 0 || line.size() == 0) {
     return;
   }
-  if (args_->loss == loss_name::ova) {
-    model_->update(line, labels, Model::kAllLabelsAsTarget, lr, state);
-  } else {
+  int32_t targetIndex = Model::kAllLabelsAsTarget;
+  if (args_->loss != loss_name::ova) {
     std::uniform_int_distribution<> uniform(0, labels.size() - 1);
-    int32_t i = uniform(state.rng);
-    model_->update(line, labels, i, lr, state);
+    targetIndex = uniform(state.rng);
+  }
+  if (args_->batchSize > 1) {
+    state.batch.add(line, labels, targetIndex);
+    if (state.batch.size() >= args_->batchSize) {
+      model.updateBatch(lr, state);
+      state.batch.clear();
+    }
+  } else {
+    model.update(line, labels, targetIndex, lr, state);
   }
 }
 
@@ -395,7 +409,7 @@ void FastText::cbow(
     bow.clear();
     for (int32_t c = -boundary; c <= boundary; c++) {
       if (c != 0 && w + c >= 0 && w + c < line.size()) {
-        const std::vector<int32_t>& ngrams = dict_->getSubwords(line[w + c]);
+        SubwordRange ngrams = dict_->getSubwords(line[w + c]);
         bow.insert(bow.end(), ngrams.cbegin(), ngrams.cend());
       }
     }
@@ -408,9 +422,11 @@ void FastText::skipgram(
     real lr,
     const std::vector<int32_t>& line) {
   std::uniform_int_distribution<> uniform(1, args_->ws);
+  std::vector<int32_t> ngrams;
   for (int32_t w = 0; w < line.size(); w++) {
     int32_t boundary = uniform(state.rng);
-    const std::vector<int32_t>& ngrams = dict_->getSubwords(line[w]);
+    SubwordRange subwords = dict_->getSubwords(line[w]);
+    ngrams.assign(subwords.begin(), subwords.end());
     for (int32_t c = -boundary; c <= boundary; c++) {
       if (c != 0 && w + c >= 0 && w + c < line.size()) {
         model_->update(ngrams, line, w + c, lr, state);
@@ -629,18 +645,93 @@ bool FastText::keepTraining(const int64_t ntokens) const {
   return tokenCount_ < args_->epoch * ntokens && !trainException_;
 }
 
+// Each thread starts at its own shard (lines of the input, or of the compiled
+// corpus). Normally threads then read on through the whole input until all
+// of them together have seen epoch * ntokens tokens, updating the shared
+// matrices without locks. With -deterministic a thread only ever reads its
+// own shard, and the threads take turns in a fixed order: each reads its next
+// kDeterministicChunkTokens tokens while the others train, then waits for its
+// turn to train on them. All updates are thus applied in the same order, at
+// learning rates decayed by the same global token count, in every run.
 void FastText::trainThread(int32_t threadId, const TrainCallback& callback) {
-  std::ifstream ifs(args_->input);
-  utils::seek(ifs, threadId * utils::size(ifs) / args_->thread);
+  if (!threadCpus_.empty()) {
+    utils::pinThread(threadCpus_[threadId]);
+  }
+  Model& model = *replicaModels_[int64_t(threadId) * replicaModels_.size() /
+                                 args_->thread];
+  std::ifstream ifs;
+  const int64_t shardStart = shards_[threadId];
+  const int64_t shardEnd = shards_[threadId + 1];
+  int64_t corpusLine = 0;
+  if (corpus_) {
+    corpusLine = shardStart;
+  } else {
+    ifs.open(args_->input);
+    utils::seek(ifs, shardStart);
+  }
 
   Model::State state(args_->dim, output_->size(0), threadId + args_->seed);
+  state.setHotRows(std::min<int64_t>(args_->hotRows, dict_->nwords()));
+
+  auto getLine = [&](std::vector<int32_t>& line,
+                     std::vector<int32_t>& labels) {
+    int32_t ntokens = 0;
+    if (args_->model == model_name::sup) {
+      ntokens = corpus_ ? corpus_->getLine(corpusLine, line, labels)
+                        : dict_->getLine(ifs, line, labels);
+    } else {
+      ntokens = corpus_ ? corpus_->getLine(corpusLine, *dict_, line, state.rng)
+                        : dict_->getLine(ifs, line, state.rng);
+    }
+    if (args_->deterministic) {
+      if (corpus_ && corpusLine >= shardEnd) {
+        corpusLine = shardStart;
+      } else if (!corpus_ && (ifs.eof() || ifs.tellg() >= shardEnd)) {
+        utils::seek(ifs, shardStart);
+      }
+    }
+    return ntokens;
+  };
 
   const int64_t ntokens = dict_->ntokens();
   int64_t localTokenCount = 0;
   std::vector<int32_t> line, labels;
+  std::vector<std::vector<int32_t>> chunkLines, chunkLabels;
+  std::vector<int32_t> chunkTokens;
+  size_t chunkPos = 0;
+  bool hasTurn = false;
   uint64_t callbackCounter = 0;
+  real lr = args_->lr;
   try {
-    while (keepTraining(ntokens)) {
+    while (true) {
+      if (args_->deterministic && chunkPos == chunkTokens.size()) {
+        if (hasTurn) {
+          // Leave nothing of this turn to be applied during a later one
+          model.updateBatch(lr, state);
+          state.batch.clear();
+          model.flushHotRows(state);
+          tokenCount_ += localTokenCount;
+          localTokenCount = 0;
+          passTurn();
+        }
+        chunkTokens.clear();
+        int64_t readTokens = 0;
+        while (readTokens < kDeterministicChunkTokens) {
+          if (chunkTokens.size() == chunkLines.size()) {
+            chunkLines.emplace_back();
+            chunkLabels.emplace_back();
+          }
+          size_t i = chunkTokens.size();
+          chunkTokens.push_back(getLine(chunkLines[i], chunkLabels[i]));
+          readTokens += chunkTokens.back();
+        }
+        chunkPos = 0;
+        waitForTurn(threadId);
+        hasTurn = true;
+      }
+      if (!keepTraining(ntokens)) {
+        break;
+      }
       real progress = real(tokenCount_) / (args_->epoch * ntokens);
       if (callback && ((callbackCounter++ % 64) == 0)) {
         double wst;
@@ -650,15 +741,19 @@ void FastText::trainThread(int32_t threadId, const TrainCallback& callback) {
             progressInfo(progress);
         callback(progress, loss_, wst, lr, eta);
       }
-      real lr = args_->lr * (1.0 - progress);
+      lr = args_->lr * (1.0 - progress);
+      if (args_->deterministic) {
+        line.swap(chunkLines[chunkPos]);
+        labels.swap(chunkLabels[chunkPos]);
+        localTokenCount += chunkTokens[chunkPos++];
+      } else {
+        localTokenCount += getLine(line, labels);
+      }
       if (args_->model == model_name::sup) {
-        localTokenCount += dict_->getLine(ifs, line, labels);
-        supervised(state, lr, line, labels);
+        supervised(model, state, lr, line, labels);
       } else if (args_->model == model_name::cbow) {
-        localTokenCount += dict_->getLine(ifs, line, state.rng);
         cbow(state, lr, line);
       } else if (args_->model == model_name::sg) {
-        localTokenCount += dict_->getLine(ifs, line, state.rng);
         skipgram(state, lr, line);
       }
       if (localTokenCount > args_->lrUpdateRate) {
@@ -669,14 +764,33 @@ void FastText::trainThread(int32_t threadId, const TrainCallback& callback) {
         }
       }
     }
+    model.updateBatch(lr, state);
+    model.flushHotRows(state);
   } catch (DenseMatrix::EncounteredNaNError&) {
     trainException_ = std::current_exception();
   }
+  if (hasTurn) {
+    passTurn();
+  }
   if (threadId == 0)
     loss_ = state.getLoss();
   ifs.close();
 }
 
+void FastText::waitForTurn(int32_t threadId) {
+  std::unique_lock<std::mutex> lock(turnMutex_);
+  turnChanged_.wait(
+      lock, [&]() { return turn_ % args_->thread == threadId; });
+}
+
+void FastText::passTurn() {
+  {
+    std::lock_guard<std::mutex> lock(turnMutex_);
+    turn_++;
+  }
+  turnChanged_.notify_all();
+}
+
 std::shared_ptr<Matrix> FastText::getInputMatrixFromFile(
     const std::string& filename) const {
   std::ifstream in(filename);
@@ -725,7 +839,7 @@ std::shared_ptr<Matrix> FastText::getInputMatrixFromFile(
 std::shared_ptr<Matrix> FastText::createRandomMatrix() const {
   std::shared_ptr<DenseMatrix> input = std::make_shared<DenseMatrix>(
       dict_->nwords() + args_->bucket, args_->dim);
-  input->uniform(1.0 / args_->dim, args_->thread, args_->seed);
+  input->uniform(1.0 / args_->dim, args_->thread, args_->seed, threadCpus());
 
   return input;
 }
@@ -747,13 +861,34 @@ void FastText::train(const Args& args, const TrainCallback& callback) {
     // manage expectations
     throw std::invalid_argument("Cannot use stdin for training!");
   }
-  std::ifstream ifs(args_->input);
-  if (!ifs.is_open()) {
+  if (args_->batchSize > 1 &&
+      (args_->model != model_name::sup ||
+       (args_->loss != loss_name::softmax && args_->loss != loss_name::ova))) {
     throw std::invalid_argument(
-        args_->input + " cannot be opened for training!");
+        "Mini-batches are only supported for supervised training with "
+        "softmax or one-vs-all loss!");
+  }
+  if (args_->loss == loss_name::ova &&
+      args_->batchSize > Model::kMaxOvaBatchSize) {
+    throw std::invalid_argument(
+        "Mini-batches with one-vs-all loss are limited to " +
+        std::to_string(Model::kMaxOvaBatchSize) + " examples!");
+  }
+  if (args_->hotRows < 0) {
+    throw std::invalid_argument("-hotRows cannot be negative!");
+  }
+  if (BinaryCorpus::isCompiled(args_->input)) {
+    if (!args_->pretrainedVectors.empty()) {
+      throw std::invalid_argument(
+          "Pretrained vectors cannot be used with a compiled corpus!");
+    }
+    corpus_ = std::make_shared<BinaryCorpus>(args_->input);
+    corpus_->checkArgs(*args_);
+    dict_ = corpus_->loadDictionary(args_);
+  } else {
+    corpus_.reset();
+    dict_->readFromFile(args_->input);
   }
-  dict_->readFromFile(ifs);
-  ifs.close();
 
   if (!args_->pretrainedVectors.empty()) {
     input_ = getInputMatrixFromFile(args_->pretrainedVectors);
@@ -777,8 +912,29 @@ void FastText::abort() {
 }
 
 void FastText::startThreads(const TrainCallback& callback) {
+  if (corpus_) {
+    shards_.assign(args_->thread + 1, 0);
+    for (int32_t i = 0; i <= args_->thread; i++) {
+      shards_[i] = i * corpus_->nlines() / args_->thread;
+    }
+  } else {
+    std::ifstream ifs(args_->input);
+    shards_ = utils::lineShards(ifs, args_->thread);
+  }
+  if (args_->deterministic) {
+    for (int32_t i = 0; i < args_->thread; i++) {
+      if (shards_[i] == shards_[i + 1]) {
+        throw std::invalid_argument(
+            "Too few lines for deterministic training with " +
+            std::to_string(args_->thread) + " threads!");
+      }
+    }
+  }
+  threadCpus_ = threadCpus();
+  createOutputReplicas();
   start_ = std::chrono::steady_clock::now();
   tokenCount_ = 0;
+  turn_ = 0;
   loss_ = -1;
   trainException_ = nullptr;
   std::vector<std::thread> threads;
@@ -794,6 +950,7 @@ void FastText::startThreads(const TrainCallback& callback) {
   // Same condition as trainThread
   while (keepTraining(ntokens)) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    averageOutputReplicas();
     if (loss_ >= 0 && args_->verbose > 1) {
       real progress = real(tokenCount_) / (args_->epoch * ntokens);
       std::cerr << "\r";
@@ -803,6 +960,10 @@ void FastText::startThreads(const TrainCallback& callback) {
   for (int32_t i = 0; i < threads.size(); i++) {
     threads[i].join();
   }
+  averageOutputReplicas();
+  replicaModels_.clear();
+  outputReplicas_.clear();
+  threadCpus_.clear();
   if (trainException_) {
     std::exception_ptr exception = trainException_;
     trainException_ = nullptr;
@@ -815,6 +976,93 @@ void FastText::startThreads(const TrainCallback& callback) {
   }
 }
 
+// With -pinThreads, the CPU of every training thread. Threads are spread over
+// the NUMA nodes in contiguous groups, the same grouping as output replicas,
+// so that threads sharing a replica also share a node.
+std::vector<int32_t> FastText::threadCpus() const {
+  std::vector<int32_t> cpus;
+  if (!args_->pinThreads || args_->thread <= 1) {
+    return cpus;
+  }
+  std::vector<std::vector<int32_t>> nodes = utils::numaNodes();
+  int64_t nnodes = nodes.size();
+  for (int32_t i = 0; i < args_->thread; i++) {
+    int64_t node = i * nnodes / args_->thread;
+    int64_t first = (node * args_->thread + nnodes - 1) / nnodes;
+    cpus.push_back(nodes[node][(i - first) % nodes[node].size()]);
+  }
+  return cpus;
+}
+
+// Hogwild threads on different sockets keep invalidating each other's cache
+// lines of the output matrix, which is small and written on every update.
+// With -outputReplicas n, threads are split into n contiguous groups, each
+// updating its own copy, and the copies are averaged every 100 ms while
+// training and once at the end. Copy r is written first by a thread on the
+// node of group r.
+void FastText::createOutputReplicas() {
+  int32_t nreplicas = std::min(args_->outputReplicas, args_->thread);
+  if (nreplicas > 1 && args_->model != model_name::sup) {
+    throw std::invalid_argument(
+        "Output replicas are only supported for supervised training!");
+  }
+  if (nreplicas > 1 && args_->deterministic) {
+    // Replicas are averaged at timed intervals
+    throw std::invalid_argument(
+        "Output replicas cannot be used with deterministic training!");
+  }
+  outputReplicas_.assign(1, output_);
+  replicaModels_.assign(1, model_);
+  if (nreplicas <= 1) {
+    return;
+  }
+  const DenseMatrix& output = dynamic_cast<const DenseMatrix&>(*output_);
+  std::vector<std::thread> threads;
+  for (int32_t r = 1; r < nreplicas; r++) {
+    auto replica = std::make_shared<DenseMatrix>(output.rows(), output.cols());
+    outputReplicas_.push_back(replica);
+    int32_t first = (int64_t(r) * args_->thread + nreplicas - 1) / nreplicas;
+    threads.push_back(std::thread([&output, replica, first, this]() {
+      if (!threadCpus_.empty()) {
+        utils::pinThread(threadCpus_[first]);
+      }
+      std::copy(
+          output.data(),
+          output.data() + output.rows() * output.cols(),
+          replica->data());
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (int32_t r = 1; r < nreplicas; r++) {
+    replicaModels_.push_back(std::make_shared<Model>(
+        input_, outputReplicas_[r], createLoss(outputReplicas_[r]), true));
+  }
+}
+
+void FastText::averageOutputReplicas() {
+  if (outputReplicas_.size() <= 1) {
+    return;
+  }
+  std::vector<real*> replicas;
+  for (auto& replica : outputReplicas_) {
+    replicas.push_back(dynamic_cast<DenseMatrix&>(*replica).data());
+  }
+  int64_t size = output_->size(0) * output_->size(1);
+  real scale = 1.0 / replicas.size();
+  for (int64_t i = 0; i < size; i++) {
+    real sum = 0.0;
+    for (real* replica : replicas) {
+      sum += replica[i];
+    }
+    sum *= scale;
+    for (real* replica : replicas) {
+      replica[i] = sum;
+    }
+  }
+}
+
 int FastText::getDimension() const {
   return args_->dim;
 }
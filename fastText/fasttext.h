@@ -12,14 +12,17 @@
 
 #include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <set>
 #include <tuple>
 
 #include "args.h"
+#include "binarycorpus.h"
 #include "densematrix.h"
 #include "dictionary.h"
 #include "matrix.h"
@@ -42,6 +45,11 @@ class FastText {
   std::shared_ptr<Matrix> input_;
   std::shared_ptr<Matrix> output_;
   std::shared_ptr<Model> model_;
+  std::shared_ptr<BinaryCorpus> corpus_;
+  std::vector<int64_t> shards_;
+  std::vector<int32_t> threadCpus_;
+  std::vector<std::shared_ptr<Matrix>> outputReplicas_;
+  std::vector<std::shared_ptr<Model>> replicaModels_;
   std::atomic<int64_t> tokenCount_{};
   std::atomic<real> loss_{};
   std::chrono::steady_clock::time_point start_;
@@ -49,12 +57,24 @@ class FastText {
   int32_t version;
   std::unique_ptr<DenseMatrix> wordVectors_;
   std::exception_ptr trainException_;
+  std::mutex turnMutex_;
+  std::condition_variable turnChanged_;
+  int64_t turn_; // with -deterministic, thread turn_ % thread trains next
+
+  // Tokens a thread reads ahead and then trains on per turn with
+  // -deterministic
+  static const int64_t kDeterministicChunkTokens = 4096;
 
   void signModel(std::ostream&);
   bool checkModel(std::istream&);
   void startThreads(const TrainCallback& callback = {});
+  std::vector<int32_t> threadCpus() const;
+  void createOutputReplicas();
+  void averageOutputReplicas();
   void addInputVector(Vector&, int32_t) const;
   void trainThread(int32_t, const TrainCallback& callback);
+  void waitForTurn(int32_t threadId);
+  void passTurn();
   std::vector<std::pair<real, std::string>> getNN(
       const DenseMatrix& wordVectors,
       const Vector& queryVec,
@@ -68,6 +88,7 @@ class FastText {
   std::vector<int64_t> getTargetCounts() const;
   std::shared_ptr<Loss> createLoss(std::shared_ptr<Matrix>& output);
   void supervised(
+      Model& model,
       Model::State& state,
       real lr,
       const std::vector<int32_t>& line,
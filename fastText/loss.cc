@@ -10,6 +10,7 @@
 #include "utils.h"
 
 #include <cmath>
+#include <stdexcept>
 
 namespace fasttext {
 
@@ -61,6 +62,18 @@ real Loss::sigmoid(real x) const {
   }
 }
 
+// Loss of one example from its scores, the products of the hidden vector
+// with every output row; each score is replaced by lr times the derivative
+// of minus the loss with respect to it. Used by Model::updateBatch().
+real Loss::forwardScores(
+    const std::vector<int32_t>& /*targets*/,
+    int32_t /*targetIndex*/,
+    real* /*scores*/,
+    real /*lr*/) const {
+  throw std::invalid_argument(
+      "Mini-batches are only supported with softmax and one-vs-all losses!");
+}
+
 void Loss::predict(
     int32_t k,
     real threshold,
@@ -142,6 +155,22 @@ real OneVsAllLoss::forward(
   return loss;
 }
 
+real OneVsAllLoss::forwardScores(
+    const std::vector<int32_t>& targets,
+    int32_t /* we take all targets here */,
+    real* scores,
+    real lr) const {
+  real loss = 0.0;
+  int32_t osz = wo_->size(0);
+  for (int32_t i = 0; i < osz; i++) {
+    bool isMatch = utils::contains(targets, i);
+    real score = sigmoid(scores[i]);
+    scores[i] = lr * (real(isMatch) - score);
+    loss += isMatch ? -log(score) : -log(1.0 - score);
+  }
+  return loss;
+}
+
 NegativeSamplingLoss::NegativeSamplingLoss(
     std::shared_ptr<Matrix>& wo,
     int neg,
@@ -343,4 +372,29 @@ real SoftmaxLoss::forward(
   return -log(state.output[target]);
 };
 
+real SoftmaxLoss::forwardScores(
+    const std::vector<int32_t>& targets,
+    int32_t targetIndex,
+    real* scores,
+    real lr) const {
+  assert(targetIndex >= 0);
+  assert(targetIndex < targets.size());
+  int32_t target = targets[targetIndex];
+  int32_t osz = wo_->size(0);
+  real max = scores[0], z = 0.0;
+  for (int32_t i = 0; i < osz; i++) {
+    max = std::max(scores[i], max);
+  }
+  for (int32_t i = 0; i < osz; i++) {
+    scores[i] = exp(scores[i] - max);
+    z += scores[i];
+  }
+  real loss = -log(scores[target] / z);
+  for (int32_t i = 0; i < osz; i++) {
+    real label = (i == target) ? 1.0 : 0.0;
+    scores[i] = lr * (label - scores[i] / z);
+  }
+  return loss;
+}
+
 } // namespace fasttext
@@ -47,6 +47,11 @@ class Loss {
       real lr,
       bool backprop) = 0;
   virtual void computeOutput(Model::State& state) const = 0;
+  virtual real forwardScores(
+      const std::vector<int32_t>& targets,
+      int32_t targetIndex,
+      real* scores,
+      real lr) const;
 
   virtual void predict(
       int32_t /*k*/,
@@ -73,6 +78,11 @@ class BinaryLogisticLoss : public Loss {
 class OneVsAllLoss : public BinaryLogisticLoss {
  public:
   explicit OneVsAllLoss(std::shared_ptr<Matrix>& wo);
+  real forwardScores(
+      const std::vector<int32_t>& targets,
+      int32_t targetIndex,
+      real* scores,
+      real lr) const override;
   ~OneVsAllLoss() noexcept override = default;
   real forward(
       const std::vector<int32_t>& targets,
@@ -158,6 +168,11 @@ class SoftmaxLoss : public Loss {
       real lr,
       bool backprop) override;
   void computeOutput(Model::State& state) const override;
+  real forwardScores(
+      const std::vector<int32_t>& targets,
+      int32_t targetIndex,
+      real* scores,
+      real lr) const override;
 };
 
 } // namespace fasttext
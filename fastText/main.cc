@@ -31,6 +31,8 @@ void printUsage() {
          "probabilities\n"
       << "  skipgram                train a skipgram model\n"
       << "  cbow                    train a cbow model\n"
+      << "  compile                 pre-tokenize a training file into a "
+         "binary corpus\n"
       << "  print-word-vectors      print word vectors given a trained model\n"
       << "  print-sentence-vectors  print sentence vectors given a trained "
          "model\n"
@@ -43,6 +45,19 @@ void printUsage() {
       << std::endl;
 }
 
+void printCompileUsage() {
+  std::cerr
+      << "usage: fasttext compile <supervised|cbow|skipgram> <args>\n\n"
+      << "Reads -input once and writes the dictionary and the token ids of "
+         "every line\n"
+      << "to -output. Pass that file as -input of the same training command "
+         "(with the\n"
+      << "same -minCount, -minCountLabel, -wordNgrams, -bucket, -minn and "
+         "-maxn) to\n"
+      << "train without parsing the text again in every epoch.\n"
+      << std::endl;
+}
+
 void printQuantizeUsage() {
   std::cerr << "usage: fasttext quantize <args>" << std::endl;
 }
@@ -386,6 +401,19 @@ void train(const std::vector<std::string> args) {
   }
 }
 
+void compile(const std::vector<std::string> args) {
+  if (args.size() < 3 ||
+      (args[2] != "supervised" && args[2] != "cbow" &&
+       args[2] != "skipgram")) {
+    printCompileUsage();
+    exit(EXIT_FAILURE);
+  }
+  std::vector<std::string> trainArgs(args.begin() + 1, args.end());
+  Args a = Args();
+  a.parseArgs(trainArgs);
+  BinaryCorpus::compile(a);
+}
+
 void dump(const std::vector<std::string>& args) {
   if (args.size() < 4) {
     printDumpUsage();
@@ -428,6 +456,8 @@ int main(int argc, char** argv) {
   std::string command(args[1]);
   if (command == "skipgram" || command == "cbow" || command == "supervised") {
     train(args);
+  } else if (command == "compile") {
+    compile(args);
   } else if (command == "test" || command == "test-label") {
     test(args);
   } else if (command == "quantize") {
@@ -7,6 +7,7 @@
  */
 
 #include "model.h"
+#include "densematrix.h"
 #include "loss.h"
 #include "utils.h"
 
@@ -21,7 +22,8 @@ Model::State::State(int32_t hiddenSize, int32_t outputSize, int32_t seed)
       hidden(hiddenSize),
       output(outputSize),
       grad(hiddenSize),
-      rng(seed) {}
+      rng(seed),
+      hotExamples(0) {}
 
 real Model::State::getLoss() const {
   return lossValue_ / nexamples_;
@@ -32,6 +34,18 @@ void Model::State::incrementNExamples(real loss) {
   nexamples_++;
 }
 
+void Model::State::setHotRows(int32_t rows) {
+  hotGrads.clear();
+  hotGrads.reserve(rows);
+  for (int32_t i = 0; i < rows; i++) {
+    hotGrads.emplace_back(hidden.size());
+    hotGrads.back().zero();
+  }
+  hotPending.assign(rows, false);
+  hotDirty.clear();
+  hotExamples = 0;
+}
+
 Model::Model(
     std::shared_ptr<Matrix> wi,
     std::shared_ptr<Matrix> wo,
@@ -81,8 +95,121 @@ void Model::update(
   if (normalizeGradient_) {
     grad.mul(1.0 / input.size());
   }
+  addInputGradient(input, state);
+}
+
+// Adds state.grad to the rows of input. The most frequent words have the
+// lowest ids and their rows are written by every thread, so rows below
+// state.hotRows() are accumulated per thread and flushed every
+// kHotRowsFlushInterval examples instead of being written each time.
+void Model::addInputGradient(
+    const std::vector<int32_t>& input,
+    State& state) {
+  const int32_t hotRows = state.hotRows();
   for (auto it = input.cbegin(); it != input.cend(); ++it) {
-    wi_->addVectorToRow(grad, *it, 1.0);
+    if (*it < hotRows) {
+      if (!state.hotPending[*it]) {
+        state.hotPending[*it] = true;
+        state.hotDirty.push_back(*it);
+      }
+      state.hotGrads[*it].addVector(state.grad);
+    } else {
+      wi_->addVectorToRow(state.grad, *it, 1.0);
+    }
+  }
+  if (hotRows > 0 && ++state.hotExamples >= kHotRowsFlushInterval) {
+    flushHotRows(state);
+  }
+}
+
+void Model::flushHotRows(State& state) {
+  for (int32_t row : state.hotDirty) {
+    Vector& hot = state.hotGrads[row];
+    wi_->addVectorToRow(hot, row, 1.0);
+    hot.zero();
+    state.hotPending[row] = false;
+  }
+  state.hotDirty.clear();
+  state.hotExamples = 0;
+}
+
+void Model::Batch::add(
+    const std::vector<int32_t>& input,
+    const std::vector<int32_t>& targets,
+    int32_t targetIndex) {
+  if (size_ == inputs.size()) {
+    inputs.emplace_back();
+    this->targets.emplace_back();
+    targetIndices.emplace_back();
+  }
+  inputs[size_].assign(input.begin(), input.end());
+  this->targets[size_].assign(targets.begin(), targets.end());
+  targetIndices[size_] = targetIndex;
+  size_++;
+}
+
+// Same gradients as update() on each example of state.batch, except that
+// every example sees the output matrix from before the batch. The scores
+// and the output-side gradients of the whole batch are computed by blocked
+// matrix products, which read the output matrix twice per batch instead of
+// twice per example; the input rows are then updated example by example.
+// The output rows receive the sum of the batch's gradients at the full lr,
+// which is why one-vs-all batches are limited to kMaxOvaBatchSize.
+void Model::updateBatch(real lr, State& state) {
+  const Batch& batch = state.batch;
+  const int64_t n = batch.size();
+  if (n == 0) {
+    return;
+  }
+  DenseMatrix& wo = dynamic_cast<DenseMatrix&>(*wo_);
+  const int64_t dim = wo.cols();
+  const int64_t osz = wo.rows();
+  state.batchHidden.resize(n * dim);
+  state.batchScores.resize(n * osz);
+  state.batchGrads.assign(n * dim, 0.0);
+
+  for (int64_t b = 0; b < n; b++) {
+    if (batch.inputs[b].empty()) {
+      std::fill_n(state.batchHidden.data() + b * dim, dim, 0.0);
+      continue;
+    }
+    computeHidden(batch.inputs[b], state);
+    std::copy(
+        state.hidden.data(),
+        state.hidden.data() + dim,
+        state.batchHidden.data() + b * dim);
+  }
+
+  wo.dotRowsBatch(state.batchHidden.data(), n, state.batchScores.data());
+  for (int64_t b = 0; b < n; b++) {
+    if (batch.inputs[b].empty()) {
+      std::fill_n(state.batchScores.data() + b * osz, osz, 0.0);
+      continue;
+    }
+    real lossValue = loss_->forwardScores(
+        batch.targets[b],
+        batch.targetIndices[b],
+        state.batchScores.data() + b * osz,
+        lr);
+    state.incrementNExamples(lossValue);
+  }
+  wo.addRowsBatch(
+      state.batchScores.data(),
+      state.batchHidden.data(),
+      n,
+      state.batchGrads.data());
+
+  Vector& grad = state.grad;
+  for (int64_t b = 0; b < n; b++) {
+    const std::vector<int32_t>& input = batch.inputs[b];
+    std::copy(
+        state.batchGrads.data() + b * dim,
+        state.batchGrads.data() + (b + 1) * dim,
+        grad.data());
+    if (normalizeGradient_ && !input.empty()) {
+      grad.mul(1.0 / input.size());
+    }
+    addInputGradient(input, state);
   }
 }
 
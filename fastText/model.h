@@ -40,6 +40,30 @@ class Model {
   Model& operator=(const Model& other) = delete;
   Model& operator=(Model&& other) = delete;
 
+  // Examples collected for one updateBatch().
+  class Batch {
+   public:
+    int32_t size() const {
+      return size_;
+    }
+    void add(
+        const std::vector<int32_t>& input,
+        const std::vector<int32_t>& targets,
+        int32_t targetIndex);
+    void clear() {
+      size_ = 0;
+    }
+
+    // Only the first size() entries are used; the others keep their
+    // capacity for later batches.
+    std::vector<std::vector<int32_t>> inputs;
+    std::vector<std::vector<int32_t>> targets;
+    std::vector<int32_t> targetIndices;
+
+   private:
+    int32_t size_ = 0;
+  };
+
   class State {
    private:
     real lossValue_;
@@ -51,9 +75,25 @@ class Model {
     Vector grad;
     std::minstd_rand rng;
 
+    Batch batch;
+    std::vector<real> batchHidden;
+    std::vector<real> batchScores;
+    std::vector<real> batchGrads;
+
+    // Gradients for input rows below hotRows() are summed here and only
+    // written to the shared input matrix by Model::flushHotRows().
+    std::vector<Vector> hotGrads;
+    std::vector<bool> hotPending;
+    std::vector<int32_t> hotDirty;
+    int32_t hotExamples;
+
     State(int32_t hiddenSize, int32_t outputSize, int32_t seed);
     real getLoss() const;
     void incrementNExamples(real loss);
+    void setHotRows(int32_t rows);
+    int32_t hotRows() const {
+      return hotGrads.size();
+    }
   };
 
   void predict(
@@ -68,12 +108,21 @@ class Model {
       int32_t targetIndex,
       real lr,
       State& state);
+  void updateBatch(real lr, State& state);
+  void flushHotRows(State& state);
   void computeHidden(const std::vector<int32_t>& input, State& state) const;
 
   real std_log(real) const;
 
   static const int32_t kUnlimitedPredictions = -1;
   static const int32_t kAllLabelsAsTarget = -1;
+  static const int32_t kHotRowsFlushInterval = 16;
+  // One-vs-all moves every output row on every example, so the summed
+  // updates of a batch of stale gradients diverge beyond this size.
+  static const int32_t kMaxOvaBatchSize = 4;
+
+ protected:
+  void addInputGradient(const std::vector<int32_t>& input, State& state);
 };
 
 } // namespace fasttext
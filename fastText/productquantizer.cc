@@ -13,6 +13,11 @@
 #include <numeric>
 #include <stdexcept>
 #include <string>
+#include <thread>
+
+#if defined(__SSE__)
+#include <immintrin.h>
+#endif
 
 namespace fasttext {
 
@@ -25,6 +30,111 @@ real distL2(const real* x, const real* y, int32_t d) {
   return dist;
 }
 
+// Squared distances from x to k centroids stored dimension by dimension,
+// ct[i * k + j] being coordinate i of centroid j. Each distance is summed
+// in the same order as distL2, so the results are identical.
+void distL2Transposed(
+    const real* x,
+    const real* ct,
+    int32_t d,
+    int32_t k,
+    real* dis) {
+  int32_t j = 0;
+#if defined(__SSE__)
+  for (; j + 16 <= k; j += 16) {
+    __m128 d0 = _mm_setzero_ps(), d1 = d0, d2 = d0, d3 = d0;
+    for (auto i = 0; i < d; i++) {
+      const __m128 xi = _mm_set1_ps(x[i]);
+      const real* c = ct + i * k + j;
+      __m128 t0 = _mm_sub_ps(xi, _mm_loadu_ps(c));
+      __m128 t1 = _mm_sub_ps(xi, _mm_loadu_ps(c + 4));
+      __m128 t2 = _mm_sub_ps(xi, _mm_loadu_ps(c + 8));
+      __m128 t3 = _mm_sub_ps(xi, _mm_loadu_ps(c + 12));
+      d0 = _mm_add_ps(d0, _mm_mul_ps(t0, t0));
+      d1 = _mm_add_ps(d1, _mm_mul_ps(t1, t1));
+      d2 = _mm_add_ps(d2, _mm_mul_ps(t2, t2));
+      d3 = _mm_add_ps(d3, _mm_mul_ps(t3, t3));
+    }
+    _mm_storeu_ps(dis + j, d0);
+    _mm_storeu_ps(dis + j + 4, d1);
+    _mm_storeu_ps(dis + j + 8, d2);
+    _mm_storeu_ps(dis + j + 12, d3);
+  }
+#endif
+  std::fill(dis + j, dis + k, 0.0);
+  for (auto i = 0; i < d; i++) {
+    for (auto l = j; l < k; l++) {
+      auto tmp = x[i] - ct[i * k + l];
+      dis[l] += tmp * tmp;
+    }
+  }
+}
+
+// Index of the first smallest of k distances, as a scan keeping the first
+// strictly smaller value would find it.
+int32_t argminL2(const real* dis, int32_t k) {
+#if defined(__SSE__)
+  if (k % 16 == 0) {
+    __m128 m0 = _mm_loadu_ps(dis), m1 = _mm_loadu_ps(dis + 4);
+    __m128 m2 = _mm_loadu_ps(dis + 8), m3 = _mm_loadu_ps(dis + 12);
+    __m128 nan = _mm_cmpunord_ps(m0, m1);
+    nan = _mm_or_ps(nan, _mm_cmpunord_ps(m2, m3));
+    for (auto j = 16; j < k; j += 16) {
+      __m128 v0 = _mm_loadu_ps(dis + j), v1 = _mm_loadu_ps(dis + j + 4);
+      __m128 v2 = _mm_loadu_ps(dis + j + 8), v3 = _mm_loadu_ps(dis + j + 12);
+      nan = _mm_or_ps(nan, _mm_cmpunord_ps(v0, v1));
+      nan = _mm_or_ps(nan, _mm_cmpunord_ps(v2, v3));
+      m0 = _mm_min_ps(m0, v0);
+      m1 = _mm_min_ps(m1, v1);
+      m2 = _mm_min_ps(m2, v2);
+      m3 = _mm_min_ps(m3, v3);
+    }
+    // NaNs are skipped by the scalar scan but not by min, so leave them
+    // to it.
+    if (_mm_movemask_ps(nan) == 0) {
+      __m128 m = _mm_min_ps(_mm_min_ps(m0, m1), _mm_min_ps(m2, m3));
+      m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(1, 0, 3, 2)));
+      m = _mm_min_ps(m, _mm_shuffle_ps(m, m, _MM_SHUFFLE(2, 3, 0, 1)));
+      for (auto j = 0; j < k; j += 4) {
+        int mask = _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(dis + j), m));
+        if (mask != 0) {
+          return j + __builtin_ctz(mask);
+        }
+      }
+    }
+  }
+#endif
+  int32_t best = 0;
+  real bestDis = dis[0];
+  for (auto j = 1; j < k; j++) {
+    if (dis[j] < bestDis) {
+      best = j;
+      bestDis = dis[j];
+    }
+  }
+  return best;
+}
+
+// Runs f(begin, end) on up to `thread` threads, over contiguous ranges
+// that cover [0, n).
+template <typename F>
+void parallelFor(int32_t n, int32_t thread, const F& f) {
+  thread = std::max(1, std::min(thread, n / 1024));
+  if (thread == 1) {
+    f(0, n);
+    return;
+  }
+  std::vector<std::thread> threads;
+  for (auto t = 0; t < thread; t++) {
+    int32_t begin = int64_t(n) * t / thread;
+    int32_t end = int64_t(n) * (t + 1) / thread;
+    threads.push_back(std::thread([&f, begin, end]() { f(begin, end); }));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
 ProductQuantizer::ProductQuantizer(int32_t dim, int32_t dsub)
     : dim_(dim),
       nsubq_(dim / dsub),
@@ -53,6 +163,28 @@ real* ProductQuantizer::get_centroids(int32_t m, uint8_t i) {
   return &centroids_[(m * ksub_ + i) * dsub_];
 }
 
+void ProductQuantizer::transpose_centroids(
+    const real* c,
+    int32_t d,
+    real* ct) const {
+  for (auto j = 0; j < ksub_; j++) {
+    for (auto i = 0; i < d; i++) {
+      ct[i * ksub_ + j] = c[j * d + i];
+    }
+  }
+}
+
+real ProductQuantizer::assign_transposed(
+    const real* x,
+    const real* ct,
+    uint8_t* code,
+    int32_t d,
+    real* dis) const {
+  distL2Transposed(x, ct, d, ksub_, dis);
+  code[0] = (uint8_t)argminL2(dis, ksub_);
+  return dis[code[0]];
+}
+
 real ProductQuantizer::assign_centroid(
     const real* x,
     const real* c0,
@@ -77,10 +209,16 @@ void ProductQuantizer::Estep(
     const real* centroids,
     uint8_t* codes,
     int32_t d,
-    int32_t n) const {
-  for (auto i = 0; i < n; i++) {
-    assign_centroid(x + i * d, centroids, codes + i, d);
-  }
+    int32_t n,
+    int32_t thread) const {
+  std::vector<real> ct(d * ksub_);
+  transpose_centroids(centroids, d, ct.data());
+  parallelFor(n, thread, [&](int32_t begin, int32_t end) {
+    std::vector<real> dis(ksub_);
+    for (auto i = begin; i < end; i++) {
+      assign_transposed(x + i * d, ct.data(), codes + i, d, dis.data());
+    }
+  });
 }
 
 void ProductQuantizer::MStep(
@@ -132,7 +270,12 @@ void ProductQuantizer::MStep(
   }
 }
 
-void ProductQuantizer::kmeans(const real* x, real* c, int32_t n, int32_t d) {
+void ProductQuantizer::kmeans(
+    const real* x,
+    real* c,
+    int32_t n,
+    int32_t d,
+    int32_t thread) {
   std::vector<int32_t> perm(n, 0);
   std::iota(perm.begin(), perm.end(), 0);
   std::shuffle(perm.begin(), perm.end(), rng);
@@ -141,12 +284,12 @@ void ProductQuantizer::kmeans(const real* x, real* c, int32_t n, int32_t d) {
   }
   auto codes = std::vector<uint8_t>(n);
   for (auto i = 0; i < niter_; i++) {
-    Estep(x, c, codes.data(), d, n);
+    Estep(x, c, codes.data(), d, n, thread);
     MStep(x, c, codes.data(), d, n);
   }
 }
 
-void ProductQuantizer::train(int32_t n, const real* x) {
+void ProductQuantizer::train(int32_t n, const real* x, int32_t thread) {
   if (n < ksub_) {
     throw std::invalid_argument(
         "Matrix too small for quantization, must have at least " +
@@ -170,7 +313,7 @@ void ProductQuantizer::train(int32_t n, const real* x) {
           x + perm[j] * dim_ + m * dsub_,
           d * sizeof(real));
     }
-    kmeans(xslice.data(), get_centroids(m, 0), np, d);
+    kmeans(xslice.data(), get_centroids(m, 0), np, d, thread);
   }
 }
 
@@ -222,11 +365,33 @@ void ProductQuantizer::compute_code(const real* x, uint8_t* code) const {
   }
 }
 
-void ProductQuantizer::compute_codes(const real* x, uint8_t* codes, int32_t n)
-    const {
-  for (auto i = 0; i < n; i++) {
-    compute_code(x + i * dim_, codes + i * nsubq_);
+void ProductQuantizer::compute_codes(
+    const real* x,
+    uint8_t* codes,
+    int32_t n,
+    int32_t thread) const {
+  std::vector<real> ct(centroids_.size());
+  for (auto m = 0; m < nsubq_; m++) {
+    auto d = m == nsubq_ - 1 ? lastdsub_ : dsub_;
+    transpose_centroids(get_centroids(m, 0), d, ct.data() + m * ksub_ * dsub_);
   }
+  parallelFor(n, thread, [&](int32_t begin, int32_t end) {
+    std::vector<real> dis(ksub_);
+    for (auto i = begin; i < end; i++) {
+      auto d = dsub_;
+      for (auto m = 0; m < nsubq_; m++) {
+        if (m == nsubq_ - 1) {
+          d = lastdsub_;
+        }
+        assign_transposed(
+            x + i * dim_ + m * dsub_,
+            ct.data() + m * ksub_ * dsub_,
+            codes + i * nsubq_ + m,
+            d,
+            dis.data());
+      }
+    }
+  });
 }
 
 void ProductQuantizer::save(std::ostream& out) const {
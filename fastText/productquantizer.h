@@ -45,16 +45,20 @@ class ProductQuantizer {
   real* get_centroids(int32_t, uint8_t);
   const real* get_centroids(int32_t, uint8_t) const;
 
+  void transpose_centroids(const real*, int32_t, real*) const;
+  real assign_transposed(const real*, const real*, uint8_t*, int32_t, real*)
+      const;
   real assign_centroid(const real*, const real*, uint8_t*, int32_t) const;
-  void Estep(const real*, const real*, uint8_t*, int32_t, int32_t) const;
+  void Estep(const real*, const real*, uint8_t*, int32_t, int32_t, int32_t = 1)
+      const;
   void MStep(const real*, real*, const uint8_t*, int32_t, int32_t);
-  void kmeans(const real*, real*, int32_t, int32_t);
-  void train(int, const real*);
+  void kmeans(const real*, real*, int32_t, int32_t, int32_t = 1);
+  void train(int, const real*, int32_t = 1);
 
   real mulcode(const Vector&, const uint8_t*, int32_t, real) const;
   void addcode(Vector&, const uint8_t*, int32_t, real) const;
   void compute_code(const real*, uint8_t*) const;
-  void compute_codes(const real*, uint8_t*, int32_t) const;
+  void compute_codes(const real*, uint8_t*, int32_t, int32_t = 1) const;
 
   void save(std::ostream&) const;
   void load(std::istream&);
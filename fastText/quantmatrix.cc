@@ -16,7 +16,11 @@ namespace fasttext {
 
 QuantMatrix::QuantMatrix() : Matrix(), qnorm_(false), codesize_(0) {}
 
-QuantMatrix::QuantMatrix(DenseMatrix&& mat, int32_t dsub, bool qnorm)
+QuantMatrix::QuantMatrix(
+    DenseMatrix&& mat,
+    int32_t dsub,
+    bool qnorm,
+    int32_t thread)
     : Matrix(mat.size(0), mat.size(1)),
       qnorm_(qnorm),
       codesize_(mat.size(0) * ((mat.size(1) + dsub - 1) / dsub)) {
@@ -26,27 +30,27 @@ QuantMatrix::QuantMatrix(DenseMatrix&& mat, int32_t dsub, bool qnorm)
     norm_codes_.resize(m_);
     npq_ = std::unique_ptr<ProductQuantizer>(new ProductQuantizer(1, 1));
   }
-  quantize(std::forward<DenseMatrix>(mat));
+  quantize(std::forward<DenseMatrix>(mat), thread);
 }
 
-void QuantMatrix::quantizeNorm(const Vector& norms) {
+void QuantMatrix::quantizeNorm(const Vector& norms, int32_t thread) {
   assert(qnorm_);
   assert(norms.size() == m_);
   auto dataptr = norms.data();
-  npq_->train(m_, dataptr);
-  npq_->compute_codes(dataptr, norm_codes_.data(), m_);
+  npq_->train(m_, dataptr, thread);
+  npq_->compute_codes(dataptr, norm_codes_.data(), m_, thread);
 }
 
-void QuantMatrix::quantize(DenseMatrix&& mat) {
+void QuantMatrix::quantize(DenseMatrix&& mat, int32_t thread) {
   if (qnorm_) {
     Vector norms(mat.size(0));
     mat.l2NormRow(norms);
     mat.divideRow(norms);
-    quantizeNorm(norms);
+    quantizeNorm(norms, thread);
   }
   auto dataptr = mat.data();
-  pq_->train(m_, dataptr);
-  pq_->compute_codes(dataptr, codes_.data(), m_);
+  pq_->train(m_, dataptr, thread);
+  pq_->compute_codes(dataptr, codes_.data(), m_, thread);
 }
 
 real QuantMatrix::dotRow(const Vector& vec, int64_t i) const {
@@ -38,15 +38,15 @@ class QuantMatrix : public Matrix {
 
  public:
   QuantMatrix();
-  QuantMatrix(DenseMatrix&&, int32_t, bool);
+  QuantMatrix(DenseMatrix&&, int32_t, bool, int32_t = 1);
   QuantMatrix(const QuantMatrix&) = delete;
   QuantMatrix(QuantMatrix&&) = delete;
   QuantMatrix& operator=(const QuantMatrix&) = delete;
   QuantMatrix& operator=(QuantMatrix&&) = delete;
   virtual ~QuantMatrix() noexcept override = default;
 
-  void quantizeNorm(const Vector&);
-  void quantize(DenseMatrix&& mat);
+  void quantizeNorm(const Vector&, int32_t = 1);
+  void quantize(DenseMatrix&& mat, int32_t thread = 1);
 
   real dotRow(const Vector&, int64_t) const override;
   void addVectorToRow(const Vector&, int64_t, real) override;
@@ -10,6 +10,13 @@
 
 #include <iomanip>
 #include <ios>
+#include <string>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
 
 namespace fasttext {
 
@@ -25,6 +32,88 @@ void seek(std::ifstream& ifs, int64_t pos) {
   ifs.seekg(std::streampos(pos));
 }
 
+// Splits the file into nshards byte ranges that each start at the beginning
+// of a line; shard i is [bounds[i], bounds[i + 1]) and may be empty.
+std::vector<int64_t> lineShards(std::ifstream& ifs, int32_t nshards) {
+  int64_t fileSize = size(ifs);
+  std::vector<int64_t> bounds(nshards + 1, fileSize);
+  bounds[0] = 0;
+  for (int32_t i = 1; i < nshards; i++) {
+    seek(ifs, std::max(bounds[i - 1], fileSize * i / nshards));
+    std::streambuf& sb = *ifs.rdbuf();
+    int c;
+    while ((c = sb.sbumpc()) != EOF && c != '\n') {
+    }
+    bounds[i] = c == EOF ? fileSize : int64_t(ifs.tellg());
+  }
+  return bounds;
+}
+
+// The CPUs this process may run on, grouped by NUMA node. Nodes without such
+// CPUs are left out; without NUMA information all CPUs form one node.
+std::vector<std::vector<int32_t>> numaNodes() {
+  std::vector<std::vector<int32_t>> nodes;
+#if defined(__linux__)
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  sched_getaffinity(0, sizeof(allowed), &allowed);
+  for (int32_t node = 0;; node++) {
+    std::ifstream ifs(
+        "/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (!ifs.is_open()) {
+      break;
+    }
+    // e.g. "0-15,32-47"
+    std::vector<int32_t> cpus;
+    int32_t first, last;
+    while (ifs >> first) {
+      last = first;
+      if (ifs.peek() == '-') {
+        ifs.get();
+        ifs >> last;
+      }
+      for (int32_t cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &allowed)) {
+          cpus.push_back(cpu);
+        }
+      }
+      if (ifs.peek() == ',') {
+        ifs.get();
+      }
+    }
+    if (!cpus.empty()) {
+      nodes.push_back(cpus);
+    }
+  }
+  if (nodes.empty()) {
+    nodes.emplace_back();
+    for (int32_t cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+      if (CPU_ISSET(cpu, &allowed)) {
+        nodes[0].push_back(cpu);
+      }
+    }
+  }
+#endif
+  if (nodes.empty() || nodes[0].empty()) {
+    nodes.assign(1, std::vector<int32_t>());
+    int32_t ncpus = std::max(1u, std::thread::hardware_concurrency());
+    for (int32_t cpu = 0; cpu < ncpus; cpu++) {
+      nodes[0].push_back(cpu);
+    }
+  }
+  return nodes;
+}
+
+// Binds the calling thread to one CPU; does nothing where unsupported.
+void pinThread(int32_t cpu) {
+#if defined(__linux__)
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
 double getDuration(
     const std::chrono::steady_clock::time_point& start,
     const std::chrono::steady_clock::time_point& end) {
@@ -34,6 +34,12 @@ int64_t size(std::ifstream&);
 
 void seek(std::ifstream&, int64_t);
 
+std::vector<int64_t> lineShards(std::ifstream&, int32_t);
+
+std::vector<std::vector<int32_t>> numaNodes();
+
+void pinThread(int32_t);
+
 template <typename T>
 bool contains(const std::vector<T>& container, const T& value) {
   return std::find(container.begin(), container.end(), value) !=
@@ -0,0 +1,365 @@
+#include "invertedindex.h"
+#include "varint.h"
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+/// Minimum number of removed documents before their postings are purged from the index
+const int COMPACT_THRESHOLD = 64;
+
+namespace {
+
+bool lessByPosition(const InvertedIndex::Posting& a, const InvertedIndex::Posting& b)
+{
+    return a.document != b.document ? a.document < b.document : a.paragraph < b.paragraph;
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs an empty inverted index from words to the paragraphs they occur in.
+ *
+ * Every term maps to a posting list of (document, paragraph, frequency) entries ordered by
+ * document and paragraph. The lists are stored as byte strings in which document ids are
+ * delta-encoded, paragraph numbers are delta-encoded within a document, and every number is
+ * written as a varint, so a posting usually takes three bytes.
+ *
+ * Documents are numbered in the order they are added and ids are never reused. Removing a
+ * document only marks it; its postings are skipped by searches and purged once enough
+ * documents have been removed.
+ */
+InvertedIndex::InvertedIndex() : liveCount(0), removedCount(0) {}
+
+/**
+ * @brief Registers a new document whose terms are added next.
+ *
+ * @return The id of the document; larger than every id returned before.
+ */
+int InvertedIndex::addDocument()
+{
+    removed.push_back(false);
+    liveCount++;
+    return static_cast<int>(removed.size()) - 1;
+}
+
+/**
+ * @brief Removes a document from all future search results.
+ *
+ * @param document The id of the document.
+ */
+void InvertedIndex::removeDocument(int document)
+{
+    if (removed[document]) {
+        return;
+    }
+    removed[document] = true;
+    liveCount--;
+    removedCount++;
+
+    if (removedCount >= COMPACT_THRESHOLD && removedCount > liveCount) {
+        compact();
+    }
+}
+
+/**
+ * @brief Adds the occurrences of a term in a document.
+ *
+ * Must be called for the most recently added document, once per distinct term.
+ *
+ * @param document The id of the document.
+ * @param term The lowercase term.
+ * @param paragraphs The paragraph number of every occurrence, in ascending order.
+ * @param count The number of occurrences.
+ */
+void InvertedIndex::addTerm(int document, std::string_view term, const int* paragraphs, std::size_t count)
+{
+    auto it = terms.find(term);
+    if (it == terms.end()) {
+        it = terms.emplace(std::string(term), PostingList()).first;
+    }
+
+    // Repeated paragraph numbers become one posting with a higher frequency
+    for (std::size_t i = 0; i < count;) {
+        std::size_t end = i + 1;
+        while (end < count && paragraphs[end] == paragraphs[i]) {
+            end++;
+        }
+        appendPosting(it->second, document, paragraphs[i], static_cast<int>(end - i));
+        i = end;
+    }
+}
+
+/**
+ * @brief Finds the paragraphs that match a query.
+ *
+ * The query consists of whitespace-separated terms that must all occur in the same paragraph.
+ * A term ending in '*' matches every word starting with the text before it. Matching is
+ * case-insensitive.
+ *
+ * @param query The query, e.g. "apple", "apple pie" or "app*".
+ * @param document Restricts the search to one document, or -1 to search all documents.
+ * @return The matching paragraphs ordered by document and paragraph. The frequency of each is
+ *         the smallest number of occurrences of any query term in that paragraph.
+ */
+std::vector<InvertedIndex::Posting> InvertedIndex::search(const std::string& query, int document) const
+{
+    return evaluateQuery(query, [this, document](const std::string& term, bool prefix, std::vector<Posting>& postings) {
+        if (!prefix) {
+            auto it = terms.find(term);
+            if (it != terms.end()) {
+                decode(it->second, document, postings);
+            }
+            return;
+        }
+        // Terms sharing the prefix are adjacent in the ordered term dictionary
+        for (auto it = terms.lower_bound(term); it != terms.end() && it->first.compare(0, term.size(), term) == 0; ++it) {
+            decode(it->second, document, postings);
+        }
+    });
+}
+
+/**
+ * @brief Splits a query into its terms (see search() for the syntax).
+ *
+ * @param query The query text.
+ * @return The lowercase terms in query order.
+ */
+std::vector<InvertedIndex::QueryTerm> InvertedIndex::parseQuery(const std::string& query)
+{
+    std::istringstream stream(query);
+    std::string term;
+    std::vector<QueryTerm> terms;
+    while (stream >> term) {
+        std::transform(term.begin(), term.end(), term.begin(), ::tolower);
+        bool prefix = term.size() > 1 && term.back() == '*';
+        if (prefix) {
+            term.pop_back();
+        }
+        terms.push_back({term, prefix});
+    }
+    return terms;
+}
+
+/**
+ * @brief Evaluates a query against any source of posting lists.
+ *
+ * Shared by the in-memory index and the on-disk segments so that both interpret queries the
+ * same way (see search()).
+ *
+ * @param query The query text.
+ * @param collect Appends the postings of one term, or of every term with the given prefix, to a vector.
+ * @return The matching paragraphs ordered by document and paragraph.
+ */
+std::vector<InvertedIndex::Posting> InvertedIndex::evaluateQuery(const std::string& query, const TermCollector& collect)
+{
+    std::vector<Posting> result;
+    bool first = true;
+
+    for (const QueryTerm& term : parseQuery(query)) {
+        std::vector<Posting> postings;
+        collect(term.text, term.prefix, postings);
+        if (term.prefix) {
+            // Several terms may have postings for the same paragraph; add their frequencies up
+            std::sort(postings.begin(), postings.end(), lessByPosition);
+            std::vector<Posting> merged;
+            for (const Posting& posting : postings) {
+                if (!merged.empty() && !lessByPosition(merged.back(), posting)) {
+                    merged.back().frequency += posting.frequency;
+                } else {
+                    merged.push_back(posting);
+                }
+            }
+            postings = std::move(merged);
+        }
+
+        if (first) {
+            result = std::move(postings);
+            first = false;
+            continue;
+        }
+
+        // Keep only the paragraphs that contain this term as well
+        std::vector<Posting> matched;
+        auto a = result.begin();
+        auto b = postings.begin();
+        while (a != result.end() && b != postings.end()) {
+            if (lessByPosition(*a, *b)) {
+                ++a;
+            } else if (lessByPosition(*b, *a)) {
+                ++b;
+            } else {
+                matched.push_back({a->document, a->paragraph, std::min(a->frequency, b->frequency)});
+                ++a;
+                ++b;
+            }
+        }
+        result = std::move(matched);
+    }
+    return result;
+}
+
+/**
+ * @brief Decodes an encoded run of postings.
+ *
+ * Decoding never reads past size, even if the bytes are corrupt; the decoded numbers are then
+ * arbitrary and have to be checked by the caller.
+ *
+ * @param bytes The encoded postings.
+ * @param size The number of bytes to decode.
+ * @param baseDocument The document the first posting is delta-encoded against (-1 at the start of a list).
+ * @param postings Receives the decoded postings.
+ * @return False if the last posting is cut off by the end of the bytes.
+ */
+bool InvertedIndex::decodePostings(const char* bytes, std::size_t size, int baseDocument, std::vector<Posting>& postings)
+{
+    std::size_t pos = 0;
+    std::uint32_t document = static_cast<std::uint32_t>(baseDocument);
+    std::uint32_t paragraph = 0;
+    while (pos < size) {
+        std::uint32_t documentDelta, paragraphValue, frequency;
+        if (!readVarint(bytes, size, pos, documentDelta) || !readVarint(bytes, size, pos, paragraphValue)
+            || !readVarint(bytes, size, pos, frequency)) {
+            return false;
+        }
+        // Unsigned arithmetic, so that corrupt deltas wrap instead of overflowing
+        if (documentDelta > 0) {
+            document += documentDelta;
+            paragraph = paragraphValue;
+        } else {
+            paragraph += paragraphValue;
+        }
+        postings.push_back({static_cast<int>(document), static_cast<int>(paragraph), static_cast<int>(frequency)});
+    }
+    return true;
+}
+
+/**
+ * @brief Encodes a complete posting list in the format read by decodePostings().
+ *
+ * @param postings The postings, ordered by document and paragraph.
+ * @param bytes Receives the encoded postings; its previous contents are replaced.
+ */
+void InvertedIndex::encodePostings(const std::vector<Posting>& postings, std::string& bytes)
+{
+    PostingList list;
+    list.bytes.swap(bytes);
+    list.bytes.clear();
+    for (const Posting& posting : postings) {
+        appendPosting(list, posting.document, posting.paragraph, posting.frequency);
+    }
+    bytes.swap(list.bytes);
+}
+
+/**
+ * @brief Visits every term with its encoded posting list, in alphabetical order.
+ *
+ * Postings of removed documents are still included until the index is compacted.
+ *
+ * @param visit Called with each term and its postings in the format read by decodePostings().
+ */
+void InvertedIndex::forEachTerm(const std::function<void(const std::string& term, const std::string& postings)>& visit) const
+{
+    for (const auto& pair : terms) {
+        visit(pair.first, pair.second.bytes);
+    }
+}
+
+/**
+ * @brief Gets the number of distinct terms in the index.
+ *
+ * @return The term count.
+ */
+std::size_t InvertedIndex::getTermCount() const
+{
+    return terms.size();
+}
+
+/**
+ * @brief Gets the size of all encoded posting lists.
+ *
+ * @return The number of bytes used by the postings, excluding the terms themselves.
+ */
+std::size_t InvertedIndex::getEncodedSize() const
+{
+    std::size_t size = 0;
+    for (const auto& pair : terms) {
+        size += pair.second.bytes.size();
+    }
+    return size;
+}
+
+/**
+ * @brief Appends one posting to the end of a list.
+ *
+ * @param list The list to extend; the document must not be smaller than its last document.
+ * @param document The document id.
+ * @param paragraph The paragraph number; larger than the previous one if the document is the same.
+ * @param frequency The number of occurrences in the paragraph.
+ */
+void InvertedIndex::appendPosting(PostingList& list, int document, int paragraph, int frequency)
+{
+    if (document != list.lastDocument) {
+        list.tailOffset = list.bytes.size();
+        list.tailBaseDocument = list.lastDocument;
+        appendVarint(list.bytes, static_cast<std::uint32_t>(document - list.lastDocument));
+        appendVarint(list.bytes, static_cast<std::uint32_t>(paragraph));
+    } else {
+        appendVarint(list.bytes, 0);
+        appendVarint(list.bytes, static_cast<std::uint32_t>(paragraph - list.lastParagraph));
+    }
+    appendVarint(list.bytes, static_cast<std::uint32_t>(frequency));
+    list.lastDocument = document;
+    list.lastParagraph = paragraph;
+}
+
+/**
+ * @brief Decodes the postings of a list that belong to documents that have not been removed.
+ *
+ * @param list The list to decode.
+ * @param document Only decode the postings of this document, or -1 for all documents.
+ * @param postings Receives the decoded postings.
+ */
+void InvertedIndex::decode(const PostingList& list, int document, std::vector<Posting>& postings) const
+{
+    std::size_t start = postings.size();
+    if (document < 0) {
+        decodePostings(list.bytes.data(), list.bytes.size(), -1, postings);
+    } else if (document == list.lastDocument) {
+        // The newest document is at the end of the list, so only its own postings are read
+        decodePostings(list.bytes.data() + list.tailOffset, list.bytes.size() - list.tailOffset,
+                       list.tailBaseDocument, postings);
+    } else if (document < list.lastDocument) {
+        decodePostings(list.bytes.data(), list.bytes.size(), -1, postings);
+    }
+
+    postings.erase(std::remove_if(postings.begin() + start, postings.end(),
+                                  [this, document](const Posting& posting) {
+                                      return removed[posting.document] || (document >= 0 && posting.document != document);
+                                  }),
+                   postings.end());
+}
+
+/**
+ * @brief Re-encodes every posting list without the postings of removed documents.
+ */
+void InvertedIndex::compact()
+{
+    for (auto it = terms.begin(); it != terms.end();) {
+        std::vector<Posting> postings;
+        decode(it->second, -1, postings);
+        if (postings.empty()) {
+            it = terms.erase(it);
+            continue;
+        }
+
+        PostingList list;
+        for (const Posting& posting : postings) {
+            appendPosting(list, posting.document, posting.paragraph, posting.frequency);
+        }
+        it->second = std::move(list);
+        ++it;
+    }
+    // Removed ids stay marked so that they are never handed out or matched again
+    removedCount = 0;
+}
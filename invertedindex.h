@@ -0,0 +1,61 @@
+#ifndef INVERTEDINDEX_H
+#define INVERTEDINDEX_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class InvertedIndex {
+public:
+    struct Posting {
+        int document;
+        int paragraph;
+        int frequency;
+    };
+
+    struct QueryTerm {
+        std::string text; // lowercase, without the trailing '*'
+        bool prefix;
+    };
+
+    InvertedIndex();
+
+    int addDocument();
+    void removeDocument(int document);
+    void addTerm(int document, std::string_view term, const int* paragraphs, std::size_t count);
+
+    using TermCollector = std::function<void(const std::string& term, bool prefix, std::vector<Posting>& postings)>;
+
+    std::vector<Posting> search(const std::string& query, int document = -1) const;
+    static std::vector<QueryTerm> parseQuery(const std::string& query);
+    static std::vector<Posting> evaluateQuery(const std::string& query, const TermCollector& collect);
+    static bool decodePostings(const char* bytes, std::size_t size, int baseDocument, std::vector<Posting>& postings);
+    static void encodePostings(const std::vector<Posting>& postings, std::string& bytes);
+    void forEachTerm(const std::function<void(const std::string& term, const std::string& postings)>& visit) const;
+    std::size_t getTermCount() const;
+    std::size_t getEncodedSize() const;
+
+private:
+    struct PostingList {
+        std::string bytes;           // delta + varint encoded (document, paragraph, frequency) triples
+        int lastDocument = -1;
+        int lastParagraph = 0;
+        std::size_t tailOffset = 0;  // start of the postings of lastDocument
+        int tailBaseDocument = -1;   // document the first posting of the tail is encoded against
+    };
+
+    static void appendPosting(PostingList& list, int document, int paragraph, int frequency);
+    void decode(const PostingList& list, int document, std::vector<Posting>& postings) const;
+    void compact();
+
+    std::map<std::string, PostingList, std::less<>> terms;
+    std::vector<bool> removed;
+    int liveCount;
+    int removedCount; // removed documents whose postings have not been purged yet
+};
+
+#endif // INVERTEDINDEX_H
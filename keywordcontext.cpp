@@ -0,0 +1,164 @@
+#include "keywordcontext.h"
+#include <algorithm>
+#include <cctype>
+#include <functional>
+
+/// Number of words kept on each side of a keyword when its sentence is longer
+const std::size_t CONTEXT_WINDOW_WORDS = 20;
+
+namespace {
+
+struct Token {
+    std::size_t start;
+    std::size_t end;
+};
+
+bool isLetter(char c)
+{
+    return std::isalpha(static_cast<unsigned char>(c)) != 0;
+}
+
+/**
+ * @brief Checks whether a character ends a sentence at the given position.
+ *
+ * @param text The paragraph text.
+ * @param pos The position of the character.
+ * @return True for '.', '!' or '?' followed by whitespace or the end of the text.
+ */
+bool endsSentence(std::string_view text, std::size_t pos)
+{
+    char c = text[pos];
+    if (c != '.' && c != '!' && c != '?') {
+        return false;
+    }
+    return pos + 1 == text.size() || std::isspace(static_cast<unsigned char>(text[pos + 1]));
+}
+
+/**
+ * @brief Checks whether a word matches one of the query terms.
+ *
+ * @param text The paragraph text.
+ * @param token The word.
+ * @param terms The lowercase query terms.
+ * @return True if the lowercase word equals a term, or starts with a prefix term.
+ */
+bool matchesTerm(std::string_view text, const Token& token, const std::vector<InvertedIndex::QueryTerm>& terms)
+{
+    std::size_t length = token.end - token.start;
+    for (const InvertedIndex::QueryTerm& term : terms) {
+        if (length < term.text.size() || (!term.prefix && length != term.text.size())) {
+            continue;
+        }
+        bool equal = true;
+        for (std::size_t i = 0; i < term.text.size() && equal; i++) {
+            equal = std::tolower(static_cast<unsigned char>(text[token.start + i])) == term.text[i];
+        }
+        if (equal) {
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Finds the keyword-in-context windows of a paragraph.
+ *
+ * Words are split the same way as in Page::extractWords(): letters, optionally joined by
+ * single apostrophes or hyphens. Every word that matches a query term yields the sentence it
+ * occurs in, cut down to CONTEXT_WINDOW_WORDS words on either side of the match when the
+ * sentence is longer. Several matches in the same window yield the window only once.
+ *
+ * @param paragraph The cleaned text of the paragraph.
+ * @param terms The parsed keyword query.
+ * @return The windows in paragraph order, with surrounding whitespace removed.
+ */
+std::vector<std::string> extractKeywordContexts(std::string_view paragraph,
+                                                const std::vector<InvertedIndex::QueryTerm>& terms)
+{
+    std::vector<Token> tokens;
+    std::vector<std::size_t> sentenceStarts(1, 0); // offset at which each sentence starts
+    std::vector<int> tokenSentences;               // sentence of every token
+    std::size_t pos = 0;
+    while (pos < paragraph.size()) {
+        if (!isLetter(paragraph[pos])) {
+            if (endsSentence(paragraph, pos)) {
+                sentenceStarts.push_back(pos + 1);
+            }
+            pos++;
+            continue;
+        }
+        Token token{pos, pos};
+        while (token.end < paragraph.size()) {
+            if (isLetter(paragraph[token.end])) {
+                token.end++;
+            } else if ((paragraph[token.end] == '\'' || paragraph[token.end] == '-')
+                       && token.end + 1 < paragraph.size() && isLetter(paragraph[token.end + 1])) {
+                token.end += 2;
+            } else {
+                break;
+            }
+        }
+        tokens.push_back(token);
+        tokenSentences.push_back(static_cast<int>(sentenceStarts.size()) - 1);
+        pos = token.end;
+    }
+    sentenceStarts.push_back(paragraph.size());
+
+    std::vector<std::string> contexts;
+    std::size_t lastStart = std::string_view::npos;
+    std::size_t lastEnd = std::string_view::npos;
+    for (std::size_t i = 0; i < tokens.size(); i++) {
+        if (!matchesTerm(paragraph, tokens[i], terms)) {
+            continue;
+        }
+
+        // The sentence of the match, cut off where it extends beyond the word window
+        int sentence = tokenSentences[i];
+        std::size_t start = sentenceStarts[sentence];
+        std::size_t end = sentenceStarts[sentence + 1];
+        if (i >= CONTEXT_WINDOW_WORDS && tokenSentences[i - CONTEXT_WINDOW_WORDS] == sentence) {
+            start = tokens[i - CONTEXT_WINDOW_WORDS].start;
+        }
+        if (i + CONTEXT_WINDOW_WORDS < tokens.size() && tokenSentences[i + CONTEXT_WINDOW_WORDS] == sentence) {
+            end = tokens[i + CONTEXT_WINDOW_WORDS].end;
+        }
+
+        while (start < end && std::isspace(static_cast<unsigned char>(paragraph[start]))) {
+            start++;
+        }
+        while (end > start && std::isspace(static_cast<unsigned char>(paragraph[end - 1]))) {
+            end--;
+        }
+        if (start == lastStart && end == lastEnd) {
+            continue;
+        }
+        lastStart = start;
+        lastEnd = end;
+        contexts.emplace_back(paragraph.substr(start, end - start));
+    }
+    return contexts;
+}
+
+/**
+ * @brief Records a context and reports whether it is new.
+ *
+ * Contexts are compared by hash only, so the memory used does not depend on their length.
+ *
+ * @param context The context text.
+ * @return True if no context with the same hash has been inserted before.
+ */
+bool ContextDeduplicator::insert(std::string_view context)
+{
+    return seen.insert(std::hash<std::string_view>()(context)).second;
+}
+
+/**
+ * @brief Forgets all contexts inserted so far.
+ */
+void ContextDeduplicator::clear()
+{
+    seen.clear();
+}
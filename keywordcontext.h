@@ -0,0 +1,23 @@
+#ifndef KEYWORDCONTEXT_H
+#define KEYWORDCONTEXT_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+#include "invertedindex.h"
+
+std::vector<std::string> extractKeywordContexts(std::string_view paragraph,
+                                                const std::vector<InvertedIndex::QueryTerm>& terms);
+
+class ContextDeduplicator {
+public:
+    bool insert(std::string_view context);
+    void clear();
+
+private:
+    std::unordered_set<std::size_t> seen; // hashes of the contexts inserted so far
+};
+
+#endif // KEYWORDCONTEXT_H
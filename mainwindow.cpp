@@ -2,7 +2,11 @@
 #include "ui_mainwindow.h"
 #include "WordCloudWidget.h"
 #include "page.h"
+#include "analysisarena.h"
+#include "bytesource.h"
+#include "directorywalker.h"
 #include "word.h"
+#include "nearduplicates.h"
 #include <QMessageBox>
 #include <QDir>
 #include <QFile>
@@ -13,6 +17,11 @@
 #include <QVBoxLayout>
 #include <QDialog>
 #include <QFileDialog>
+#include <QFileInfo>
+#include <QCheckBox>
+#include <QCryptographicHash>
+#include <QStandardPaths>
+#include <QSet>
 #include <algorithm>
 #include <unordered_set>
 #include <iostream>
@@ -36,13 +45,70 @@
 /// Set of common stop words to filter out from word analysis
 const std::unordered_set<std::string> STOPWORDS = {"0o", "0s", "3a", "3b", "3d", "6b", "6o", "a", "a1", "a2", "a3", "a4", "ab", "able", "about", "above", "abst", "ac", "accordance", "according", "accordingly", "across", "act", "actually", "ad", "added", "adj", "ae", "af", "affected", "affecting", "affects", "after", "afterwards", "ag", "again", "against", "ah", "ain", "ain't", "aj", "al", "all", "allow", "allows", "almost", "alone", "along", "already", "also", "although", "always", "am", "among", "amongst", "amoungst", "amount", "an", "and", "announce", "another", "any", "anybody", "anyhow", "anymore", "anyone", "anything", "anyway", "anyways", "anywhere", "ao", "ap", "apart", "apparently", "appear", "appreciate", "appropriate", "approximately", "ar", "are", "aren", "arent", "aren't", "arise", "around", "as", "a's", "aside", "ask", "asking", "associated", "at", "au", "auth", "av", "available", "aw", "away", "awfully", "ax", "ay", "az", "b", "b1", "b2", "b3", "ba", "back", "bc", "bd", "be", "became", "because", "become", "becomes", "becoming", "been", "before", "beforehand", "begin", "beginning", "beginnings", "begins", "behind", "being", "believe", "below", "beside", "besides", "best", "better", "between", "beyond", "bi", "bill", "biol", "bj", "bk", "bl", "bn", "both", "bottom", "bp", "br", "brief", "briefly", "bs", "bt", "bu", "but", "bx", "by", "c", "c1", "c2", "c3", "ca", "call", "came", "can", "cannot", "cant", "can't", "cause", "causes", "cc", "cd", "ce", "certain", "certainly", "cf", "cg", "ch", "changes", "ci", "cit", "cj", "cl", "clearly", "cm", "c'mon", "cn", "co", "com", "come", "comes", "con", "concerning", "consequently", "consider", "considering", "contain", "containing", "contains", "corresponding", "could", "couldn", "couldnt", "couldn't", "course", "cp", "cq", "cr", "cry", "cs", "c's", "ct", "cu", "currently", "cv", "cx", "cy", "cz", "d", "d2", "da", "date", "dc", "dd", "de", "definitely", "describe", "described", "despite", "detail", "df", "di", "did", "didn", "didn't", "different", "dj", "dk", "dl", "do", "does", "doesn", "doesn't", "doing", "don", "done", "don't", "down", "downwards", "dp", "dr", "ds", "dt", "du", "due", "during", "dx", "dy", "e", "e2", "e3", "ea", "each", "ec", "ed", "edu", "ee", "ef", "effect", "eg", "ei", "eight", "eighty", "either", "ej", "el", "eleven", "else", "elsewhere", "em", "empty", "en", "end", "ending", "enough", "entirely", "eo", "ep", "eq", "er", "es", "especially", "est", "et", "et-al", "etc", "eu", "ev", "even", "ever", "every", "everybody", "everyone", "everything", "everywhere", "ex", "exactly", "example", "except", "ey", "f", "f2", "fa", "far", "fc", "few", "ff", "fi", "fifteen", "fifth", "fify", "fill", "find", "fire", "first", "five", "fix", "fj", "fl", "fn", "fo", "followed", "following", "follows", "for", "former", "formerly", "forth", "forty", "found", "four", "fr", "from", "front", "fs", "ft", "fu", "full", "further", "furthermore", "fy", "g", "ga", "gave", "ge", "get", "gets", "getting", "gi", "give", "given", "gives", "giving", "gj", "gl", "go", "goes", "going", "gone", "got", "gotten", "gr", "greetings", "gs", "gy", "h", "h2", "h3", "had", "hadn", "hadn't", "happens", "hardly", "has", "hasn", "hasnt", "hasn't", "have", "haven", "haven't", "having", "he", "hed", "he'd", "he'll", "hello", "help", "hence", "her", "here", "hereafter", "hereby", "herein", "heres", "here's", "hereupon", "hers", "herself", "hes", "he's", "hh", "hi", "hid", "him", "himself", "his", "hither", "hj", "ho", "home", "hopefully", "how", "howbeit", "however", "how's", "hr", "hs", "http", "hu", "hundred", "hy", "i", "i2", "i3", "i4", "i6", "i7", "i8", "ia", "ib", "ibid", "ic", "id", "i'd", "ie", "if", "ig", "ignored", "ih", "ii", "ij", "il", "i'll", "im", "i'm", "immediate", "immediately", "importance", "important", "in", "inasmuch", "inc", "indeed", "index", "indicate", "indicated", "indicates", "information", "inner", "insofar", "instead", "interest", "into", "invention", "inward", "io", "ip", "iq", "ir", "is", "isn", "isn't", "it", "itd", "it'd", "it'll", "its", "it's", "itself", "iv", "i've", "ix", "iy", "iz", "j", "jj", "jr", "js", "jt", "ju", "just", "k", "ke", "keep", "keeps", "kept", "kg", "kj", "km", "know", "known", "knows", "ko", "l", "l2", "la", "largely", "last", "lately", "later", "latter", "latterly", "lb", "lc", "le", "least", "les", "less", "lest", "let", "lets", "let's", "lf", "like", "liked", "likely", "line", "little", "lj", "ll", "ll", "ln", "lo", "look", "looking", "looks", "los", "lr", "ls", "lt", "ltd", "m", "m2", "ma", "made", "mainly", "make", "makes", "many", "may", "maybe", "me", "mean", "means", "meantime", "meanwhile", "merely", "mg", "might", "mightn", "mightn't", "mill", "million", "mine", "miss", "ml", "mn", "mo", "more", "moreover", "most", "mostly", "move", "mr", "mrs", "ms", "mt", "mu", "much", "mug", "must", "mustn", "mustn't", "my", "myself", "n", "n2", "na", "name", "namely", "nay", "nc", "nd", "ne", "near", "nearly", "necessarily", "necessary", "need", "needn", "needn't", "needs", "neither", "never", "nevertheless", "new", "next", "ng", "ni", "nine", "ninety", "nj", "nl", "nn", "no", "nobody", "non", "none", "nonetheless", "noone", "nor", "normally", "nos", "not", "noted", "nothing", "novel", "now", "nowhere", "nr", "ns", "nt", "ny", "o", "oa", "ob", "obtain", "obtained", "obviously", "oc", "od", "of", "off", "often", "og", "oh", "oi", "oj", "ok", "okay", "ol", "old", "om", "omitted", "on", "once", "one", "ones", "only", "onto", "oo", "op", "oq", "or", "ord", "os", "ot", "other", "others", "otherwise", "ou", "ought", "our", "ours", "ourselves", "out", "outside", "over", "overall", "ow", "owing", "own", "ox", "oz", "p", "p1", "p2", "p3", "page", "pagecount", "pages", "par", "part", "particular", "particularly", "pas", "past", "pc", "pd", "pe", "per", "perhaps", "pf", "ph", "pi", "pj", "pk", "pl", "placed", "please", "plus", "pm", "pn", "po", "poorly", "possible", "possibly", "potentially", "pp", "pq", "pr", "predominantly", "present", "presumably", "previously", "primarily", "probably", "promptly", "proud", "provides", "ps", "pt", "pu", "put", "py", "q", "qj", "qu", "que", "quickly", "quite", "qv", "r", "r2", "ra", "ran", "rather", "rc", "rd", "re", "readily", "really", "reasonably", "recent", "recently", "ref", "refs", "regarding", "regardless", "regards", "related", "relatively", "research", "research-articl", "respectively", "resulted", "resulting", "results", "rf", "rh", "ri", "right", "rj", "rl", "rm", "rn", "ro", "rq", "rr", "rs", "rt", "ru", "run", "rv", "ry", "s", "s2", "sa", "said", "same", "saw", "say", "saying", "says", "sc", "sd", "se", "sec", "second", "secondly", "section", "see", "seeing", "seem", "seemed", "seeming", "seems", "seen", "self", "selves", "sensible", "sent", "serious", "seriously", "seven", "several", "sf", "shall", "shan", "shan't", "she", "shed", "she'd", "she'll", "shes", "she's", "should", "shouldn", "shouldn't", "should've", "show", "showed", "shown", "showns", "shows", "si", "side", "significant", "significantly", "similar", "similarly", "since", "sincere", "six", "sixty", "sj", "sl", "slightly", "sm", "sn", "so", "some", "somebody", "somehow", "someone", "somethan", "something", "sometime", "sometimes", "somewhat", "somewhere", "soon", "sorry", "sp", "specifically", "specified", "specify", "specifying", "sq", "sr", "ss", "st", "still", "stop", "strongly", "sub", "substantially", "successfully", "such", "sufficiently", "suggest", "sup", "sure", "sy", "system", "sz", "t", "t1", "t2", "t3", "take", "taken", "taking", "tb", "tc", "td", "te", "tell", "ten", "tends", "tf", "th", "than", "thank", "thanks", "thanx", "that", "that'll", "thats", "that's", "that've", "the", "their", "theirs", "them", "themselves", "then", "thence", "there", "thereafter", "thereby", "thered", "therefore", "therein", "there'll", "thereof", "therere", "theres", "there's", "thereto", "thereupon", "there've", "these", "they", "theyd", "they'd", "they'll", "theyre", "they're", "they've", "thickv", "thin", "think", "third", "this", "thorough", "thoroughly", "those", "thou", "though", "thoughh", "thousand", "three", "throug", "through", "throughout", "thru", "thus", "ti", "til", "tip", "tj", "tl", "tm", "tn", "to", "together", "too", "took", "top", "toward", "towards", "tp", "tq", "tr", "tried", "tries", "truly", "try", "trying", "ts", "t's", "tt", "tv", "twelve", "twenty", "twice", "two", "tx", "u", "u201d", "ue", "ui", "uj", "uk", "um", "un", "under", "unfortunately", "unless", "unlike", "unlikely", "until", "unto", "uo", "up", "upon", "ups", "ur", "us", "use", "used", "useful", "usefully", "usefulness", "uses", "using", "usually", "ut", "v", "va", "value", "various", "vd", "ve", "ve", "very", "via", "viz", "vj", "vo", "vol", "vols", "volumtype", "vq", "vs", "vt", "vu", "w", "wa", "want", "wants", "was", "wasn", "wasnt", "wasn't", "way", "we", "wed", "we'd", "welcome", "well", "we'll", "well-b", "went", "were", "we're", "weren", "werent", "weren't", "we've", "what", "whatever", "what'll", "whats", "what's", "when", "whence", "whenever", "when's", "where", "whereafter", "whereas", "whereby", "wherein", "wheres", "where's", "whereupon", "wherever", "whether", "which", "while", "whim", "whither", "who", "whod", "whoever", "whole", "who'll", "whom", "whomever", "whos", "who's", "whose", "why", "why's", "wi", "widely", "will", "willing", "wish", "with", "within", "without", "wo", "won", "wonder", "wont", "won't", "words", "world", "would", "wouldn", "wouldnt", "wouldn't", "www", "x", "x1", "x2", "x3", "xf", "xi", "xj", "xk", "xl", "xn", "xo", "xs", "xt", "xv", "xx", "y", "y2", "yes", "yet", "yj", "yl", "you", "youd", "you'd", "you'll", "your", "youre", "you're", "yours", "yourself", "yourselves", "you've", "yr", "ys", "yt", "z", "zero", "zi", "zz"};
 
-extern std::map<std::string, double> analyze_tweets_wrapper(const std::string& keyword, const std::vector<std::string>& tweets);
+/// Maximum number of discovered file paths waiting to be ingested
+const std::size_t DISCOVERY_QUEUE_CAPACITY = 4096;
+
+/// Number of phrases shown in the results and in the word cloud
+const std::size_t PHRASE_DISPLAY_LIMIT = 20;
+
+/// Minimum time between two refreshes of the results while watching a directory
+const int REFRESH_INTERVAL_MS = 1000;
+
+extern std::map<std::string, double> analyze_weighted_tweets_wrapper(const std::string& keyword,
+                                                                     const std::vector<std::string>& tweets,
+                                                                     const std::vector<int>& weights);
+
+/**
+ * @brief Classifies cluster representatives with the sentiment model.
+ *
+ * The contexts have already been matched against the keyword query, so the analyser's own
+ * substring filter is not used (it does not understand prefix or multi-word queries).
+ *
+ * @param representatives One context of every cluster to classify.
+ * @param weights The number of contexts every representative stands for.
+ * @return The number of positive, negative and neutral predictions.
+ */
+static SentimentCounts classifyRepresentatives(const std::vector<std::string>& representatives,
+                                               const std::vector<int>& weights)
+{
+    std::map<std::string, double> result = analyze_weighted_tweets_wrapper("", representatives, weights);
+
+    SentimentCounts counts;
+    counts.positive = static_cast<int>(result["positive_count"]);
+    counts.negative = static_cast<int>(result["negative_count"]);
+    counts.neutral = static_cast<int>(result["neutral_count"]);
+    return counts;
+}
+
+/**
+ * @brief Classifies keyword contexts with the sentiment model.
+ *
+ * Retweets, quotes and syndicated copies make many contexts near-identical, so near-duplicates
+ * are clustered first and only one context per cluster is classified, counting as many
+ * predictions as the cluster has contexts.
+ *
+ * @param texts The contexts to classify.
+ * @return The number of positive, negative and neutral predictions.
+ */
+static SentimentCounts analyzeSentiment(const std::vector<std::string>& texts)
+{
+    std::vector<TextCluster> clusters = clusterNearDuplicates(texts);
+    std::vector<std::string> representatives;
+    std::vector<int> weights;
+    representatives.reserve(clusters.size());
+    weights.reserve(clusters.size());
+    for (const TextCluster& cluster : clusters) {
+        representatives.push_back(texts[cluster.representative]);
+        weights.push_back(cluster.size);
+    }
+    return classifyRepresentatives(representatives, weights);
+}
 
 /**
  * @brief MainWindow class that handles the GUI interaction and word analysis functionality.
  */
 MainWindow::MainWindow(QWidget *parent)
-    : QMainWindow(parent), ui(new Ui::MainWindow)
+    : QMainWindow(parent), ui(new Ui::MainWindow), peakRssBeforeKb(-1)
 {
     ui->setupUi(this);
 
@@ -54,10 +120,28 @@ MainWindow::MainWindow(QWidget *parent)
     QVBoxLayout *layout = new QVBoxLayout(ui->tab_2); // Add to the specific tab or widget
     layout->addWidget(wordCloudWidget, 0, Qt::AlignCenter);  // Add the wordCloudWidget and center it
 
+    // Watch mode: ingest files as they appear and refresh the results at a bounded rate
+    watcher = new QFileSystemWatcher(this);
+    refreshTimer = new QTimer(this);
+    refreshTimer->setSingleShot(true);
+    refreshTimer->setInterval(REFRESH_INTERVAL_MS);
+    connect(watcher, &QFileSystemWatcher::directoryChanged, this, &MainWindow::handleDirectoryChanged);
+    connect(watcher, &QFileSystemWatcher::fileChanged, this, &MainWindow::handleFileChanged);
+    connect(refreshTimer, &QTimer::timeout, this, &MainWindow::refreshResults);
+    connect(ui->watchCheckBox, &QCheckBox::toggled, this, [this](bool checked) {
+        if (checked) {
+            startWatching();
+        } else {
+            stopWatching();
+        }
+    });
+
     // Connect the Browse button to the corresponding slot
     connect(ui->browseButton, &QPushButton::clicked, this, &MainWindow::on_browseButton_clicked);
     // Connect the Analyze button to the corresponding slot
     connect(ui->analyzeButton, &QPushButton::clicked, this, &MainWindow::on_analyzeButton_clicked);
+    // Connect the Open Saved Index button to the corresponding slot
+    connect(ui->openIndexButton, &QPushButton::clicked, this, &MainWindow::openSavedIndex);
 }
 
 /**
@@ -98,89 +182,468 @@ void MainWindow::on_analyzeButton_clicked()
         return;
     }
 
-    // Create a QDir object to list files in the directory
+    // Check if directory exists
     QDir dir(filePath);
-    QStringList htmlFiles;
+    if (!dir.exists()) {
+        QMessageBox::warning(this, "Input Error", "Invalid directory. Please select a folder that contains HTML files.");
+        return;
+    }
 
-    // Check if directory exists and filter for HTML files
-    if (dir.exists()) {
-        htmlFiles = dir.entryList(QStringList() << "*.html" << "*.htm" << "*.HTML" << "*.HTM", QDir::Files);
-    } else {
+    // Same folder with a different keyword: answer the new query from the corpus' inverted index
+    // instead of reading every file again
+    QString cleanDir = QDir::cleanPath(dir.absolutePath());
+    if (corpus && cleanDir == analysisDir && keyword != analysisKeyword) {
+        analysisKeyword = keyword;
+        corpus->setKeyword(keyword.toStdString());
+        refreshResults();
+        return;
+    }
+
+    // A folder opened from its saved index answers new keywords from the index as well
+    if (!corpus && store && cleanDir == analysisDir && keyword != analysisKeyword) {
+        analysisKeyword = keyword;
+        refreshResults();
+        return;
+    }
+
+    // Start a fresh analysis; pages are added to the corpus one at a time
+    stopWatching();
+    analysisDir = cleanDir;
+    analysisKeyword = keyword;
+    knownFiles.clear();
+    watchedDirectories.clear();
+    corpus.reset(); // releases the arena of the previous analysis in one go
+    peakRssBeforeKb = getPeakResidentSetKb();
+    corpus = std::make_unique<Corpus>(keyword.toStdString(), STOPWORDS);
+
+    // The saved index of the folder is rebuilt from scratch as well; its old segments are
+    // deleted without being opened
+    openStore(analysisDir, true);
+
+    ingestDirectory(analysisDir);
+
+    refreshResults();
+
+    if (ui->watchCheckBox->isChecked()) {
+        startWatching();
+    }
+}
+
+/**
+ * @brief Slot to handle the Open Saved Index button, shows the results of a previously analysed folder.
+ *
+ * The statistics and keyword matches are read from the folder's saved index, so no file is
+ * read or parsed. Watch mode is not available for a folder opened this way; analysing it again
+ * reads the files and resumes watching.
+ */
+void MainWindow::openSavedIndex()
+{
+    QString keyword = ui->keywordInput->text().trimmed();
+    QString filePath = ui->filePathInput->text().trimmed();
+
+    if (filePath.isEmpty()) {
+        QMessageBox::warning(this, "Input Error", "Please select a directory.");
+        return;
+    }
+
+    QDir dir(filePath);
+    if (!dir.exists()) {
         QMessageBox::warning(this, "Input Error", "Invalid directory. Please select a folder that contains HTML files.");
         return;
     }
 
-    // Vector to store Page objects corresponding to HTML files
-    std::vector<Page> pages;
-    for (const QString& fileName : htmlFiles) {
-        QString fullPath = dir.filePath(fileName);
-        pages.emplace_back(fileName.toStdString(), fullPath.toStdString(), keyword.toStdString());
-        pages.back().readPage();
+    stopWatching();
+    corpus.reset();
+    knownFiles.clear();
+    watchedDirectories.clear();
+    analysisDir = QDir::cleanPath(dir.absolutePath());
+    analysisKeyword = keyword;
+
+    openStore(analysisDir);
+    if (!store || store->isEmpty()) {
+        store.reset();
+        analysisDir.clear();
+        QMessageBox::information(this, "No Saved Index", "This folder has not been analysed yet. Click Analyze to build its index.");
+        return;
+    }
+    refreshResults();
+}
+
+/**
+ * @brief Opens the saved index of a folder, creating an empty one if the folder has no index yet.
+ *
+ * Every folder gets its own index directory in the application's data location, named after
+ * a hash of the folder path.
+ *
+ * @param dirPath The cleaned absolute path of the analysed folder.
+ * @param discard True to delete the existing index of the folder first, e.g. before it is rebuilt.
+ */
+void MainWindow::openStore(const QString& dirPath, bool discard)
+{
+    store.reset(); // waits for a running merge of the previous index
+
+    QString hash = QCryptographicHash::hash(dirPath.toUtf8(), QCryptographicHash::Sha1).toHex();
+    QString indexPath = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation) + "/index/" + hash;
+    if (discard) {
+        QDir(indexPath).removeRecursively();
+    }
+    if (!QDir().mkpath(indexPath)) {
+        qWarning() << "Unable to create index directory" << indexPath;
+        return;
+    }
+    store = std::make_unique<SegmentStore>(indexPath.toStdString());
+}
+
+/**
+ * @brief Writes the pages added or removed since the last call to the saved index.
+ */
+void MainWindow::persistChanges()
+{
+    if (!corpus || !store || !corpus->hasChanges()) {
+        return;
+    }
+    if (!store->addSegment(corpus->takeChanges())) {
+        qWarning() << "Unable to update the saved index of" << analysisDir;
     }
+}
 
-    std::map<std::string, Word> allWords;
-    std::vector<std::string> relevantTexts;
-    int totalKeywordOccurrences = 0;
-    int totalWords = 0;
-    int uniqueWords = 0;
+/**
+ * @brief Recursively finds the HTML files below a directory and merges them into the current corpus.
+ *
+ * The tree is enumerated by a DirectoryWalker on background threads while this thread ingests
+ * each file as soon as its path is discovered, so processing of large trees starts immediately.
+ *
+ * @param dirPath The directory to walk.
+ */
+void MainWindow::ingestDirectory(const QString& dirPath)
+{
+    BlockingQueue<std::string> discovered(DISCOVERY_QUEUE_CAPACITY);
+    DirectoryWalker walker;
+    walker.start(dirPath.toStdString(), discovered);
+
+    // Decoding of the next file is started before the current one is parsed, so decompression
+    // of file N+1 overlaps the tokenization of file N
+    std::string nextPath;
+    std::unique_ptr<ByteSource> next;
+    bool hasNext = discovered.pop(nextPath);
+    if (hasNext) {
+        next = openByteSource(nextPath, true);
+    }
+    while (hasNext) {
+        std::string path = std::move(nextPath);
+        std::unique_ptr<ByteSource> source = std::move(next);
 
-    // Loop through pages and extract words
-    for (const Page& page : pages) {
-        std::vector<Word> pageWords = page.getWords();
+        hasNext = discovered.pop(nextPath);
+        if (hasNext) {
+            next = openByteSource(nextPath, true);
+        }
+        ingestFile(QString::fromStdString(path), std::move(source));
+    }
+    walker.wait();
 
-        for (const Word& word : pageWords) {
-            std::string wordText = word.getWord();
-            std::string lowercaseWord = wordText;
-            std::transform(lowercaseWord.begin(), lowercaseWord.end(), lowercaseWord.begin(), ::tolower);
+    for (const std::string& directory : walker.getDirectories()) {
+        watchedDirectories << QDir::cleanPath(QString::fromStdString(directory));
+    }
+}
 
-            // Skip stopwords
-            if (STOPWORDS.count(lowercaseWord)) {
-                continue;
-            }
+/**
+ * @brief Reads a single input file and merges it into the current corpus.
+ *
+ * A file that was ingested before is replaced, so this is used both for the initial analysis
+ * and for files that are created or modified while watch mode is active. An HTML file becomes
+ * one page; every HTML record of a WARC archive becomes a page of its own.
+ *
+ * @param fullPath The path of the file.
+ * @param source An already opened stream of the file's (decompressed) content, or nullptr to open it here.
+ */
+void MainWindow::ingestFile(const QString& fullPath, std::unique_ptr<ByteSource> source)
+{
+    QFileInfo info(fullPath);
+    std::string path = fullPath.toStdString();
+    std::string keyword = analysisKeyword.toStdString();
+
+    corpus->removeFile(path);
+    knownFiles[fullPath] = info.lastModified();
+    if (!source) {
+        source = openByteSource(path);
+    }
 
-            // Update total words count
-            totalWords += word.getCount();
+    // Pages in nested folders are named relative to the analysed directory
+    QString pageName = QDir(analysisDir).relativeFilePath(fullPath);
 
-            // Update the map of all words and their occurrences
-            auto it = allWords.find(lowercaseWord);
-            if (it != allWords.end()) {
-                for (const auto& occurrence : word.getOccurrences()) {
-                    it->second.addOccurrence(occurrence);
+    if (isWarcFile(path)) {
+        if (!source) {
+            return;
+        }
+        WarcReader reader(*source);
+        std::string targetUri;
+        int recordIndex = 0;
+        while (reader.nextRecord(targetUri)) {
+            std::string key = path + "#" + std::to_string(recordIndex++);
+            Page page(targetUri.empty() ? pageName.toStdString() : targetUri, key, keyword, corpus->getAllocator(),
+                      corpus->getParagraphSpill());
+            page.readPage(reader.payload());
+            corpus->addPage(key, std::move(page));
+        }
+        return;
+    }
+
+    Page page(pageName.toStdString(), path, keyword, corpus->getAllocator(), corpus->getParagraphSpill());
+    if (source) {
+        page.readPage(*source);
+    }
+    corpus->addPage(path, std::move(page));
+}
+
+/**
+ * @brief Runs sentiment analysis on the keyword contexts of the pages that changed and stores the counts of each page in the corpus.
+ *
+ * Copies of a text are often spread over several pages or WARC records, so the corpus clusters
+ * near-duplicates over the contexts of all pages as they are added. Only pages added or replaced
+ * since the last refresh are classified, from the representatives of the clusters their contexts
+ * fall into, weighted by the number of their contexts in each; a representative shared by
+ * several pages is answered from the prediction cache after its first prediction.
+ */
+void MainWindow::analyzeCorpusSentiment()
+{
+    if (analysisKeyword.isEmpty()) {
+        return;
+    }
+
+    std::vector<std::string> representatives;
+    std::vector<int> weights;
+    for (const std::string& path : corpus->takeUnclassifiedPages()) {
+        corpus->getPageRepresentatives(path, representatives, weights);
+        corpus->setPageSentiment(path, representatives.empty() ? SentimentCounts()
+                                                               : classifyRepresentatives(representatives, weights));
+    }
+}
+
+/**
+ * @brief Starts watching the analysed directory tree and its HTML files for changes.
+ */
+void MainWindow::startWatching()
+{
+    if (watchedDirectories.isEmpty()) {
+        return;
+    }
+    watcher->addPaths(watchedDirectories);
+    if (!knownFiles.isEmpty()) {
+        watcher->addPaths(knownFiles.keys());
+    }
+}
+
+/**
+ * @brief Stops watching all directories and files.
+ */
+void MainWindow::stopWatching()
+{
+    if (!watcher->directories().isEmpty()) {
+        watcher->removePaths(watcher->directories());
+    }
+    if (!watcher->files().isEmpty()) {
+        watcher->removePaths(watcher->files());
+    }
+    refreshTimer->stop();
+}
+
+/**
+ * @brief Slot called when the watched directory changes; ingests new or modified HTML files.
+ *
+ * Files are compared against their last known modification time, so only files that are new
+ * or have changed since they were ingested are read again. Deleted files are removed from
+ * the corpus.
+ *
+ * @param path The directory that changed.
+ */
+void MainWindow::handleDirectoryChanged(const QString& path)
+{
+    if (!corpus) {
+        return;
+    }
+
+    QDir dir(path);
+    QSet<QString> present;
+    bool changed = false;
+
+    for (const QFileInfo& entry : dir.entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot)) {
+        QString fullPath = QDir::cleanPath(entry.absoluteFilePath());
+
+        // A new subfolder: ingest everything below it and start watching it too
+        if (entry.isDir()) {
+            if (!entry.isSymLink() && !watchedDirectories.contains(fullPath)) {
+                int watchedBefore = watchedDirectories.size();
+                ingestDirectory(fullPath);
+                watcher->addPaths(watchedDirectories.mid(watchedBefore));
+
+                // Known files are sorted by path, so the files of the new folder are contiguous
+                QString prefix = fullPath + '/';
+                for (auto it = knownFiles.lowerBound(prefix); it != knownFiles.end() && it.key().startsWith(prefix); ++it) {
+                    watcher->addPath(it.key());
                 }
-            } else {
-                Word lowercaseWordObj = word;
-                lowercaseWordObj.setWord(lowercaseWord);
-                allWords.insert({lowercaseWord, lowercaseWordObj});
-                uniqueWords++;
+                changed = true;
             }
+            continue;
+        }
 
-            // If keyword matches, track relevant occurrences
-            if (!keyword.isEmpty() && lowercaseWord == keyword.toLower().toStdString()) {
-                totalKeywordOccurrences += word.getCount();
-                for (const auto& occurrence : word.getOccurrences()) {
-                    relevantTexts.push_back(occurrence);
-                }
+        if (!isSupportedInputFile(fullPath.toStdString())) {
+            continue;
+        }
+        present.insert(fullPath);
+
+        QDateTime modified = entry.lastModified();
+        auto it = knownFiles.find(fullPath);
+        if (it == knownFiles.end() || it.value() != modified) {
+            bool isNew = (it == knownFiles.end());
+            ingestFile(fullPath);
+            if (isNew) {
+                watcher->addPath(fullPath);
             }
+            changed = true;
         }
     }
 
-    // Sort words based on occurrence count
-    std::vector<std::pair<std::string, Word>> sortedWords;
-    for (const auto& pair : allWords) {
-        sortedWords.emplace_back(pair.first, pair.second);
+    // Drop files that have been deleted or moved away
+    for (auto it = knownFiles.begin(); it != knownFiles.end();) {
+        if (QFileInfo(it.key()).absolutePath() == dir.absolutePath() && !present.contains(it.key())) {
+            corpus->removeFile(it.key().toStdString());
+            it = knownFiles.erase(it);
+            changed = true;
+        } else {
+            ++it;
+        }
+    }
+
+    if (changed) {
+        scheduleRefresh();
     }
+}
 
-    std::sort(sortedWords.begin(), sortedWords.end(),
-              [](const auto& a, const auto& b) {
-                  return a.second.getCount() > b.second.getCount();
-              });
+/**
+ * @brief Slot called when a watched file is modified or removed.
+ *
+ * @param path The file that changed.
+ */
+void MainWindow::handleFileChanged(const QString& path)
+{
+    if (!corpus) {
+        return;
+    }
+
+    if (QFileInfo::exists(path)) {
+        ingestFile(path);
+        // Some editors replace the file, which drops it from the watcher
+        if (!watcher->files().contains(path)) {
+            watcher->addPath(path);
+        }
+    } else {
+        corpus->removeFile(path.toStdString());
+        knownFiles.remove(path);
+    }
+    scheduleRefresh();
+}
+
+/**
+ * @brief Requests a refresh of the results, coalescing bursts of changes.
+ *
+ * The refresh runs at most once per REFRESH_INTERVAL_MS, no matter how many files arrive in between.
+ */
+void MainWindow::scheduleRefresh()
+{
+    if (!refreshTimer->isActive()) {
+        refreshTimer->start();
+    }
+}
+
+/**
+ * @brief Updates the results from the current corpus, or from the saved index if no corpus is loaded.
+ *
+ * Changes of the corpus are written to the saved index first, so the index always matches the
+ * results that were last shown.
+ */
+void MainWindow::refreshResults()
+{
+    ResultSummary summary;
+
+    if (corpus) {
+        persistChanges();
+
+        summary.columns = corpus->getColumnsSnapshot();
+        summary.phrases = corpus->getTopPhrases(PHRASE_DISPLAY_LIMIT);
+        summary.pageCount = corpus->getPageCount();
+        summary.keywordOccurrences = corpus->getKeywordOccurrences();
+        summary.relevantTextCount = corpus->getRelevantTextCount();
+        analyzeCorpusSentiment();
+        summary.sentiment = corpus->getSentiment();
+
+        const AnalysisArena& arena = corpus->getArena();
+        summary.memoryReport = QString("Arena allocations: %1\n"
+                                       "Arena heap blocks: %2 (%3 KiB)\n")
+                                   .arg(static_cast<qulonglong>(arena.getAllocationCount()))
+                                   .arg(static_cast<qulonglong>(arena.getBlockCount()))
+                                   .arg(static_cast<qulonglong>(arena.getReservedBytes() / 1024));
+
+        const Corpus& current = *corpus;
+        summary.writeOccurrences = [&current](std::string_view wordText, QTextStream& logStream) {
+            for (const std::string& context : current.getOccurrenceContexts(wordText)) {
+                logStream << "   - " << QString::fromStdString(context) << "\n";
+            }
+        };
+    } else if (store) {
+        summary.columns = store->getColumns();
+        summary.pageCount = store->getPageCount();
+
+        SegmentStore::QueryResult result = store->query(analysisKeyword.toStdString());
+        summary.keywordOccurrences = result.occurrences;
+        summary.relevantTextCount = static_cast<int>(result.contexts.size());
+        if (!result.contexts.empty()) {
+            summary.sentiment = analyzeSentiment(result.contexts);
+        }
+
+        summary.memoryReport = QString("Saved index segments: %1 (%2 KiB mapped)\n")
+                                   .arg(static_cast<qulonglong>(store->getSegmentCount()))
+                                   .arg(static_cast<qulonglong>(store->getMappedSize() / 1024));
+    } else {
+        return;
+    }
+
+    writeResults(summary);
+}
+
+/**
+ * @brief Writes the log file and updates the result view and word cloud.
+ *
+ * @param summary The statistics to show.
+ */
+void MainWindow::writeResults(const ResultSummary& summary)
+{
+    const QString& keyword = analysisKeyword;
+    const std::shared_ptr<const WordColumns>& columns = summary.columns;
+    int totalKeywordOccurrences = summary.keywordOccurrences;
+    int totalWords = static_cast<int>(columns->getTotalCount());
+    int uniqueWords = columns->getLiveCount();
+    int filesProcessed = summary.pageCount;
+    int relevantTextCount = summary.relevantTextCount;
+
+    // Sort words based on occurrence count; only the top entries are needed, and the counts
+    // are sorted in the column store rather than in a word map
+    std::vector<int> sortedWords = columns->sortByCount(100);
+    int displayLimit = static_cast<int>(sortedWords.size());
+
+    QStringList phraseListDisplay;
+    const std::shared_ptr<const WordColumns>& phrases = summary.phrases;
+    for (int id = 0; phrases && id < phrases->size(); ++id) {
+        std::string_view phraseText = phrases->getWord(id);
+        phraseListDisplay << QString("%1 appears %2 times")
+                                 .arg(QString::fromUtf8(phraseText.data(), static_cast<int>(phraseText.size())))
+                                 .arg(phrases->getCount(id));
+    }
 
     QStringList wordListDisplay;
-    int displayLimit = std::min(100, static_cast<int>(sortedWords.size()));
     for (int i = 0; i < displayLimit; ++i) {
-        const auto& wordPair = sortedWords[i];
-        QString word = QString::fromStdString(wordPair.first);
-        int count = wordPair.second.getCount();
+        std::string_view wordText = columns->getWord(sortedWords[i]);
+        QString word = QString::fromUtf8(wordText.data(), static_cast<int>(wordText.size()));
+        int count = columns->getCount(sortedWords[i]);
         wordListDisplay << QString("%1 appears %2 times").arg(word).arg(count);
     }
 
@@ -194,19 +657,32 @@ void MainWindow::on_analyzeButton_clicked()
 
     logStream << "General Statistics:\n";
     logStream << "==================\n";
-    logStream << "Files processed: " << pages.size() << "\n";
+    logStream << "Files processed: " << filesProcessed << "\n";
     logStream << "Total words: " << totalWords << "\n";
     logStream << "Unique words: " << uniqueWords << "\n\n";
 
+    logStream << "Memory Usage:\n";
+    logStream << "=============\n";
+    logStream << summary.memoryReport;
+    logStream << "Peak RSS before analysis: " << peakRssBeforeKb << " KiB\n";
+    logStream << "Peak RSS after analysis: " << getPeakResidentSetKb() << " KiB\n\n";
+
+    if (!phraseListDisplay.isEmpty()) {
+        logStream << "Phrase Frequencies (top " << static_cast<int>(PHRASE_DISPLAY_LIMIT) << "):\n";
+        logStream << "=============================\n";
+        logStream << phraseListDisplay.join("\n") << "\n\n";
+    }
+
     logStream << "Word Frequencies (top 100) with all occurrences:\n";
     logStream << "===============================================\n";
     for (int i = 0; i < displayLimit; i++) {
-        const auto& wordPair = sortedWords[i];
-        logStream << QString::fromStdString(wordPair.first) << ": "
-                  << wordPair.second.getCount() << " occurrences\n";
+        std::string_view wordText = columns->getWord(sortedWords[i]);
+        logStream << QString::fromUtf8(wordText.data(), static_cast<int>(wordText.size())) << ": "
+                  << columns->getCount(sortedWords[i]) << " occurrences in "
+                  << columns->getDocumentFrequency(sortedWords[i]) << " pages\n";
 
-        for (const auto& occurrence : wordPair.second.getOccurrences()) {
-            logStream << "   - " << QString::fromStdString(occurrence) << "\n";
+        if (summary.writeOccurrences) {
+            summary.writeOccurrences(wordText, logStream);
         }
         logStream << "\n";
     }
@@ -218,15 +694,19 @@ void MainWindow::on_analyzeButton_clicked()
         logStream << "================\n";
         logStream << "Keyword: " << keyword << "\n";
         logStream << "Total occurrences: " << totalKeywordOccurrences << "\n";
-        logStream << "Found in " << relevantTexts.size() << " contexts\n";
+        logStream << "Found in " << relevantTextCount << " contexts\n";
 
-        if (!relevantTexts.empty()) {
-            std::map<std::string, double> result = analyze_tweets_wrapper(keyword.toStdString(), relevantTexts);
+        if (relevantTextCount > 0) {
+            const SentimentCounts& sentiment = summary.sentiment;
+            int total = sentiment.positive + sentiment.negative + sentiment.neutral;
+            double positivePercent = total > 0 ? (sentiment.positive / (double)total) * 100 : 0;
+            double negativePercent = total > 0 ? (sentiment.negative / (double)total) * 100 : 0;
+            double neutralPercent = total > 0 ? (sentiment.neutral / (double)total) * 100 : 0;
 
             logStream << "\nSentiment Analysis:\n";
-            logStream << "Positive: " << result["positive_percent"] << "%\n";
-            logStream << "Negative: " << result["negative_percent"] << "%\n";
-            logStream << "Neutral: " << result["neutral_percent"] << "%\n";
+            logStream << "Positive: " << positivePercent << "%\n";
+            logStream << "Negative: " << negativePercent << "%\n";
+            logStream << "Neutral: " << neutralPercent << "%\n";
 
             output = QString(
                          "Analysis complete for %1 files\n\n"
@@ -235,14 +715,14 @@ void MainWindow::on_analyzeButton_clicked()
                          "Keyword '%4' found %5 times\n"
                          "Sentiment: Positive %6%, Negative %7%, Neutral %8%\n\n"
                          "Full results saved to word_analysis_log.txt"
-                         ).arg(pages.size())
+                         ).arg(filesProcessed)
                          .arg(totalWords)
                          .arg(uniqueWords)
                          .arg(keyword)
                          .arg(totalKeywordOccurrences)
-                         .arg(result["positive_percent"], 0, 'f', 2)
-                         .arg(result["negative_percent"], 0, 'f', 2)
-                         .arg(result["neutral_percent"], 0, 'f', 2);
+                         .arg(positivePercent, 0, 'f', 2)
+                         .arg(negativePercent, 0, 'f', 2)
+                         .arg(neutralPercent, 0, 'f', 2);
         } else {
             logStream << "Keyword not found in any files.\n";
             output = QString("Keyword '%1' not found in any files.\n\n").arg(keyword);
@@ -253,21 +733,24 @@ void MainWindow::on_analyzeButton_clicked()
                      "Total words: %2\n"
                      "Unique words: %3\n\n"
                      "Top 100 words with all occurrences saved to word_analysis_log.txt"
-                     ).arg(pages.size())
+                     ).arg(filesProcessed)
                      .arg(totalWords)
                      .arg(uniqueWords);
     }
 
     // Set the word frequencies for the word cloud widget
-    wordCloudWidget->setWordFrequencies(allWords);
+    wordCloudWidget->setWordFrequencies(columns, phrases);
 
     std::cout << "Generating Word Cloud..." << std::endl;
 
-    std::cout << "Words: " << allWords.size() << std::endl;
-    for (const auto& pair : allWords) {
-        std::cout << "Word: " << pair.first << ", Count: " << pair.second.getCount() << std::endl;
+    std::cout << "Words: " << uniqueWords << std::endl;
+    for (int id : columns->filterByCount(1)) {
+        std::cout << "Word: " << columns->getWord(id) << ", Count: " << columns->getCount(id) << std::endl;
     }
 
+    if (!phraseListDisplay.isEmpty()) {
+        output += "\n\nTop Phrases:\n------------\n" + phraseListDisplay.join("\n");
+    }
     output += "\n\nTop 100 Word Frequencies:\n-------------------------\n" + wordListDisplay.join("\n");
 
     // Display the results on the UI
@@ -3,6 +3,17 @@
 
 #include <QMainWindow>
 #include <QFileDialog>
+#include <QFileSystemWatcher>
+#include <QTimer>
+#include <QDateTime>
+#include <QMap>
+#include <QTextStream>
+#include <functional>
+#include <memory>
+#include <string_view>
+#include "bytesource.h"
+#include "corpus.h"
+#include "segmentstore.h"
 #include "word.h"
 #include "WordCloudWidget.h"
 
@@ -21,10 +32,44 @@ public:
 private slots:
     void on_analyzeButton_clicked();
     void on_browseButton_clicked();
+    void openSavedIndex();
+    void handleDirectoryChanged(const QString& path);
+    void handleFileChanged(const QString& path);
+    void refreshResults();
 
 private:
+    struct ResultSummary {
+        std::shared_ptr<const WordColumns> columns;
+        std::shared_ptr<const WordColumns> phrases; // most frequent phrases, ranked; nullptr if not available
+        int pageCount = 0;
+        int keywordOccurrences = 0;
+        int relevantTextCount = 0;
+        SentimentCounts sentiment;
+        QString memoryReport;
+        std::function<void(std::string_view word, QTextStream& log)> writeOccurrences;
+    };
+
+    void ingestDirectory(const QString& dirPath);
+    void ingestFile(const QString& fullPath, std::unique_ptr<ByteSource> source = nullptr);
+    void analyzeCorpusSentiment();
+    void openStore(const QString& dirPath, bool discard = false);
+    void persistChanges();
+    void writeResults(const ResultSummary& summary);
+    void scheduleRefresh();
+    void startWatching();
+    void stopWatching();
+
     Ui::MainWindow *ui;
     WordCloudWidget *wordCloudWidget;
+    QFileSystemWatcher *watcher;
+    QTimer *refreshTimer;
+    std::unique_ptr<Corpus> corpus;
+    std::unique_ptr<SegmentStore> store; // saved index of analysisDir
+    QString analysisDir;
+    QString analysisKeyword;
+    QStringList watchedDirectories;
+    QMap<QString, QDateTime> knownFiles;
+    long peakRssBeforeKb;
 
 };
 #endif // MAINWINDOW_H
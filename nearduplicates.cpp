@@ -0,0 +1,316 @@
+#include "nearduplicates.h"
+#include <algorithm>
+#include <cctype>
+
+/// Number of LSH bands the signature is split into; each band is MINHASH_SIZE / MINHASH_BANDS values
+const int MINHASH_BANDS = 8;
+
+/// Minimum number of equal signature values (of MINHASH_SIZE) for two texts to count as near-duplicates
+const int MIN_EQUAL_VALUES = 23;
+
+/// Upper limit for the number of buckets of each band table
+const std::size_t MAX_BUCKET_COUNT = 1 << 22;
+
+namespace {
+
+const int ROWS_PER_BAND = MINHASH_SIZE / MINHASH_BANDS;
+
+std::uint64_t mix(std::uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/**
+ * @brief Gets the odd multipliers of the multiply-shift hash functions of the signature.
+ *
+ * @return MINHASH_SIZE pseudo-random odd numbers, the same in every run.
+ */
+const std::array<std::uint64_t, MINHASH_SIZE>& hashMultipliers()
+{
+    static const std::array<std::uint64_t, MINHASH_SIZE> multipliers = [] {
+        std::array<std::uint64_t, MINHASH_SIZE> values;
+        for (int i = 0; i < MINHASH_SIZE; i++) {
+            values[i] = mix(0x9e3779b97f4a7c15ULL * (i + 1)) | 1;
+        }
+        return values;
+    }();
+    return multipliers;
+}
+
+std::size_t bandKey(const MinHashSignature& signature, int band)
+{
+    std::uint64_t key = band;
+    for (int row = 0; row < ROWS_PER_BAND; row++) {
+        key = mix(key ^ signature[band * ROWS_PER_BAND + row]);
+    }
+    return static_cast<std::size_t>(key);
+}
+
+bool areNearDuplicates(const MinHashSignature& a, const MinHashSignature& b)
+{
+    int equal = 0;
+    for (int value = 0; value < MINHASH_SIZE; value++) {
+        equal += a[value] == b[value];
+    }
+    return equal >= MIN_EQUAL_VALUES;
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Computes the MinHash signature of a text.
+ *
+ * The features of a text are its lowercase words (runs of letters and digits) and every pair
+ * of adjacent words. For two texts, the fraction of signature values that are equal estimates
+ * the Jaccard similarity of their feature sets, so a retweet prefix or a changed word leaves
+ * most of the signature intact.
+ *
+ * @param text The text.
+ * @param signature Receives the signature.
+ * @return False if the text contains no words; the signature is then meaningless.
+ */
+bool computeMinHash(std::string_view text, MinHashSignature& signature)
+{
+    const std::array<std::uint64_t, MINHASH_SIZE>& multipliers = hashMultipliers();
+    signature.fill(UINT32_MAX);
+
+    auto addFeature = [&](std::uint64_t feature) {
+        feature = mix(feature);
+        for (int i = 0; i < MINHASH_SIZE; i++) {
+            signature[i] = std::min(signature[i], static_cast<std::uint32_t>((feature * multipliers[i]) >> 32));
+        }
+    };
+
+    std::uint64_t word = 0xcbf29ce484222325ULL; // FNV-1a of the current word
+    std::uint64_t previous = 0;
+    bool inWord = false;
+    bool hasPrevious = false;
+    for (std::size_t i = 0; i <= text.size(); i++) {
+        if (i < text.size() && std::isalnum(static_cast<unsigned char>(text[i]))) {
+            word ^= static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(text[i])));
+            word *= 0x100000001b3ULL;
+            inWord = true;
+            continue;
+        }
+        if (!inWord) {
+            continue;
+        }
+        addFeature(word);
+        if (hasPrevious) {
+            addFeature(previous * 0x9e3779b97f4a7c15ULL + word);
+        }
+        previous = word;
+        hasPrevious = true;
+        word = 0xcbf29ce484222325ULL;
+        inWord = false;
+    }
+    return hasPrevious;
+}
+
+/**
+ * @brief Groups texts that are near-duplicates of each other.
+ *
+ * Two texts are near-duplicates if at least MIN_EQUAL_VALUES of their MinHash values are equal,
+ * i.e. if the Jaccard similarity of their words and word pairs is about 0.7 or more. Every text
+ * joins the first cluster whose representative is close enough, otherwise it starts a new
+ * cluster. Representatives are found by locality-sensitive hashing: the signature is split into
+ * MINHASH_BANDS bands and each band is the key of a hash table, so only representatives that
+ * share at least one whole band with the text are compared. Texts without words are never merged.
+ *
+ * @param texts The texts to group.
+ * @return The clusters in order of their first text.
+ */
+std::vector<TextCluster> clusterNearDuplicates(const std::vector<std::string_view>& texts)
+{
+    std::vector<TextCluster> clusters;
+    std::vector<MinHashSignature> signatures;             // signature of every cluster representative
+    std::vector<std::array<int, MINHASH_BANDS>> next;     // next cluster in the same bucket, per band
+
+    std::size_t bucketCount = 16;
+    while (bucketCount < texts.size() && bucketCount < MAX_BUCKET_COUNT) {
+        bucketCount *= 2;
+    }
+    std::vector<int> heads(MINHASH_BANDS * bucketCount, -1);
+    std::size_t mask = bucketCount - 1;
+
+    MinHashSignature signature;
+    std::array<std::size_t, MINHASH_BANDS> buckets;
+    for (std::size_t i = 0; i < texts.size(); i++) {
+        bool hasWords = computeMinHash(texts[i], signature);
+        int cluster = -1;
+        for (int band = 0; hasWords && band < MINHASH_BANDS; band++) {
+            buckets[band] = band * bucketCount + (bandKey(signature, band) & mask);
+            for (int candidate = heads[buckets[band]]; cluster < 0 && candidate >= 0; candidate = next[candidate][band]) {
+                if (areNearDuplicates(signatures[candidate], signature)) {
+                    cluster = candidate;
+                }
+            }
+            if (cluster >= 0) {
+                break;
+            }
+        }
+
+        if (cluster >= 0) {
+            clusters[cluster].size++;
+            continue;
+        }
+
+        cluster = static_cast<int>(clusters.size());
+        clusters.push_back({i, 1});
+        signatures.push_back(signature);
+        next.emplace_back();
+        next.back().fill(-1);
+        for (int band = 0; hasWords && band < MINHASH_BANDS; band++) {
+            int& head = heads[buckets[band]];
+            next[cluster][band] = head;
+            head = cluster;
+        }
+    }
+    return clusters;
+}
+
+/**
+ * @brief Groups texts that are near-duplicates of each other.
+ *
+ * @param texts The texts to group.
+ * @return The clusters in order of their first text.
+ */
+std::vector<TextCluster> clusterNearDuplicates(const std::vector<std::string>& texts)
+{
+    return clusterNearDuplicates(std::vector<std::string_view>(texts.begin(), texts.end()));
+}
+
+/**
+ * @brief Adds a text to the cluster of its near-duplicates, or starts a new cluster.
+ *
+ * Texts are compared as in clusterNearDuplicates(): the text joins the first cluster found
+ * whose representative shares a whole LSH band with it and is close enough. Unlike there, the
+ * band buckets are kept between calls, so adding a text costs the same however many texts have
+ * been added before, and texts can be removed again.
+ *
+ * @param text The text.
+ * @return The id of the cluster of the text; stays valid until the cluster becomes empty.
+ */
+int NearDuplicateIndex::add(std::string_view text)
+{
+    MinHashSignature signature;
+    bool hasWords = computeMinHash(text, signature);
+    std::array<std::size_t, MINHASH_BANDS> keys;
+    for (int band = 0; hasWords && band < MINHASH_BANDS; band++) {
+        keys[band] = bandKey(signature, band);
+        auto it = buckets.find(keys[band]);
+        if (it == buckets.end()) {
+            continue;
+        }
+        for (int candidate : it->second) {
+            if (areNearDuplicates(clusters[candidate].signature, signature)) {
+                clusters[candidate].size++;
+                return candidate;
+            }
+        }
+    }
+
+    int cluster;
+    if (!freeClusters.empty()) {
+        cluster = freeClusters.back();
+        freeClusters.pop_back();
+    } else {
+        cluster = static_cast<int>(clusters.size());
+        clusters.emplace_back();
+    }
+    Cluster& added = clusters[cluster];
+    added.signature = signature;
+    added.representative.assign(text.data(), text.size());
+    added.size = 1;
+    added.hasWords = hasWords;
+    for (int band = 0; hasWords && band < MINHASH_BANDS; band++) {
+        buckets[keys[band]].push_back(cluster);
+    }
+    liveCount++;
+    return cluster;
+}
+
+/**
+ * @brief Removes one text from its cluster.
+ *
+ * The representative of a cluster stays the same while the cluster has texts, even if the text
+ * it was taken from is removed, so the clusters of the remaining texts never change. An empty
+ * cluster is taken out of the band buckets and its id is reused.
+ *
+ * @param cluster The id add() returned for the text.
+ */
+void NearDuplicateIndex::remove(int cluster)
+{
+    Cluster& removed = clusters[cluster];
+    if (--removed.size > 0) {
+        return;
+    }
+    for (int band = 0; removed.hasWords && band < MINHASH_BANDS; band++) {
+        auto it = buckets.find(bandKey(removed.signature, band));
+        if (it == buckets.end()) {
+            continue; // two bands of a signature may share a key
+        }
+        std::vector<int>& bucket = it->second;
+        auto position = std::find(bucket.begin(), bucket.end(), cluster);
+        if (position != bucket.end()) {
+            *position = bucket.back();
+            bucket.pop_back();
+        }
+        if (bucket.empty()) {
+            buckets.erase(it);
+        }
+    }
+    removed.representative.clear();
+    removed.representative.shrink_to_fit();
+    freeClusters.push_back(cluster);
+    liveCount--;
+}
+
+/**
+ * @brief Removes every text and cluster.
+ */
+void NearDuplicateIndex::clear()
+{
+    clusters.clear();
+    freeClusters.clear();
+    buckets.clear();
+    liveCount = 0;
+}
+
+/**
+ * @brief Gets the text a cluster is classified by.
+ *
+ * @param cluster The id of a cluster that has texts.
+ * @return The first text added to the cluster.
+ */
+const std::string& NearDuplicateIndex::getRepresentative(int cluster) const
+{
+    return clusters[cluster].representative;
+}
+
+/**
+ * @brief Gets the number of texts in a cluster.
+ *
+ * @param cluster The id of a cluster.
+ * @return The number of texts added to the cluster and not removed since.
+ */
+int NearDuplicateIndex::getSize(int cluster) const
+{
+    return clusters[cluster].size;
+}
+
+/**
+ * @brief Gets the number of clusters that have texts.
+ *
+ * @return The cluster count.
+ */
+std::size_t NearDuplicateIndex::getClusterCount() const
+{
+    return liveCount;
+}
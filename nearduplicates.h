@@ -0,0 +1,51 @@
+#ifndef NEARDUPLICATES_H
+#define NEARDUPLICATES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+/// Number of hash functions of a MinHash signature
+const int MINHASH_SIZE = 32;
+
+using MinHashSignature = std::array<std::uint32_t, MINHASH_SIZE>;
+
+struct TextCluster {
+    std::size_t representative; // index of the first text of the cluster
+    int size;                   // number of texts in the cluster
+};
+
+bool computeMinHash(std::string_view text, MinHashSignature& signature);
+std::vector<TextCluster> clusterNearDuplicates(const std::vector<std::string_view>& texts);
+std::vector<TextCluster> clusterNearDuplicates(const std::vector<std::string>& texts);
+
+/// Clusters of near-duplicate texts that are kept up to date as single texts come and go
+class NearDuplicateIndex {
+public:
+    int add(std::string_view text);
+    void remove(int cluster);
+    void clear();
+
+    const std::string& getRepresentative(int cluster) const;
+    int getSize(int cluster) const;
+    std::size_t getClusterCount() const;
+
+private:
+    struct Cluster {
+        MinHashSignature signature;
+        std::string representative; // the first text of the cluster
+        int size = 0;               // 0 once the cluster is free for reuse
+        bool hasWords = false;      // only clusters with words are in the band buckets
+    };
+
+    std::vector<Cluster> clusters;
+    std::vector<int> freeClusters;
+    std::unordered_map<std::size_t, std::vector<int>> buckets; // clusters by the key of each of their bands
+    std::size_t liveCount = 0;
+};
+
+#endif // NEARDUPLICATES_H
@@ -1,11 +1,18 @@
 #include "page.h"
+#include "phrasecounter.h"
 #include <algorithm>
 #include <cctype>
-#include <iostream>
-#include <sstream>
-#include <fstream>
 #include <regex>
 
+/// Number of bytes requested from the byte source at a time
+const std::size_t READ_CHUNK_SIZE = 64 * 1024;
+
+/// Number of characters of a tag that are kept to recognise <p> and </p>
+const std::size_t TAG_HEAD_LENGTH = 3;
+
+/// Number of slots of the phrase table of a page before it first grows; a power of two
+const std::size_t INITIAL_PHRASE_SLOTS = 1024;
+
 /**
  * @author Leon Pinto
  * @author Teagan Martins
@@ -15,82 +22,280 @@
  * @param name The name of the page (usually the file name).
  * @param path The file path to the page's HTML content.
  * @param keyword The keyword to track (can be used in filtering or analysis).
+ * @param alloc The allocator for the words of the page; passing the corpus allocator lets the
+ *              corpus take the words over without copying them.
+ * @param paragraphSpill Receives the cleaned text of every paragraph while the page is read, so
+ *                       the text is not kept in memory; null if the text is not needed. Only one
+ *                       page may be read into a spill at a time.
  */
-Page::Page(const std::string& name, const std::string& path, const std::string& keyword)
-    : pageName(name), path(path), keyword(keyword) {}
+Page::Page(const std::string& name, const std::string& path, const std::string& keyword,
+           const Word::allocator_type& alloc, TextSpill* paragraphSpill)
+    : pageName(name), path(path), keyword(keyword), wordList(alloc), paragraphSpill(paragraphSpill),
+      textEndsWithSpace(true), recentWords{-1, -1}, recentCount(0), recentBigramKey(0) {}
 
 /**
  * @brief Reads the HTML page content, extracts text within <p> tags, cleans it, and extracts words.
  *
- * This function opens the file at the specified path, reads its content, and processes only the
- * content inside <p> HTML tags. It removes nested tags and extracts words from the cleaned text.
+ * This function opens the file at the specified path (decompressing .gz and .zst files on the fly)
+ * and processes its content as described in readPage(ByteSource&).
  */
 void Page::readPage() {
-    std::ifstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "Error: Unable to open file " << path << std::endl;
-        return;
+    std::unique_ptr<ByteSource> source = openByteSource(path);
+    if (!source) {
+        return; // openByteSource() already reported the error
+    }
+    readPage(*source);
+}
+
+/**
+ * @brief Reads the HTML content from a byte source, extracts text within <p> tags, cleans it, and extracts words.
+ *
+ * Only the content inside <p> HTML tags is processed. Nested tags are replaced by a space and words
+ * are extracted from the cleaned text.
+ *
+ * The document is scanned in fixed-size chunks by a small state machine instead of being loaded
+ * into memory first. Tags and paragraphs that are split across chunk boundaries are carried over
+ * to the next chunk, and long paragraphs are handed to extractWords() in pieces, so the text of
+ * the page is never held in memory. What remains is the word list: a count and a four-byte
+ * paragraph number per occurrence, and one text range per paragraph. No context strings are
+ * kept; they are derived from the spilled paragraph text when needed.
+ *
+ * @param source The stream to read the HTML document from, e.g. a decompressed file or a WARC record.
+ */
+void Page::readPage(ByteSource& source) {
+    std::vector<char> chunk(READ_CHUNK_SIZE);
+    std::string paragraph;  // cleaned text of the current <p> that has not been tokenized yet
+    bool started = false;   // the current <p> has been numbered and its text range opened
+    std::string tagHead;    // first characters of the tag currently being read
+    bool inTag = false;
+    bool inParagraph = false;
+
+    std::size_t count;
+    while ((count = source.read(chunk.data(), chunk.size())) > 0) {
+        for (std::size_t i = 0; i < count; i++) {
+            char c = chunk[i];
+
+            if (inTag) {
+                if (c != '>') {
+                    if (tagHead.size() < TAG_HEAD_LENGTH) {
+                        tagHead += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+                    }
+                    continue;
+                }
+                inTag = false;
+
+                if (!inParagraph && isTagNamed(tagHead, "p")) {
+                    inParagraph = true;
+                    paragraph.clear();
+                    started = false;
+                } else if (inParagraph && isTagNamed(tagHead, "/p")) {
+                    inParagraph = false;
+                    flushParagraph(paragraph, started, true);
+                } else if (inParagraph) {
+                    // Strip any nested tags inside the <p> (like <b>, <a>, etc.)
+                    paragraph += ' ';
+                }
+            } else if (c == '<') {
+                inTag = true;
+                tagHead.clear();
+            } else if (inParagraph) {
+                paragraph += c;
+                if (paragraph.size() >= READ_CHUNK_SIZE) {
+                    flushParagraph(paragraph, started, false);
+                }
+            }
+        }
     }
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    std::string htmlContent = buffer.str();
-    file.close();
+    // A paragraph that is still open at the end of the document is kept as well
+    if (inParagraph) {
+        flushParagraph(paragraph, started, true);
+    }
+}
 
-    // First remove HTML tags
-    // Extract only <p> tag content
-    std::regex pTagRegex(R"(<p[^>]*>((.|\n)*?)<\/p>)", std::regex::icase);
-    std::sregex_iterator iter(htmlContent.begin(), htmlContent.end(), pTagRegex);
-    std::sregex_iterator end;
+/**
+ * @brief Checks whether the beginning of a tag names the given element.
+ *
+ * @param tagHead The lowercased characters following '<', up to TAG_HEAD_LENGTH of them.
+ * @param name The element name, with a leading '/' for closing tags.
+ * @return True if the tag is exactly that element, optionally followed by attributes.
+ */
+bool Page::isTagNamed(const std::string& tagHead, const std::string& name) {
+    if (tagHead.compare(0, name.size(), name) != 0) {
+        return false;
+    }
+    if (tagHead.size() == name.size()) {
+        return true;
+    }
+    char next = tagHead[name.size()];
+    return std::isspace(static_cast<unsigned char>(next)) || next == '/';
+}
 
-    while (iter != end) {
-        std::string paragraph = iter->str(1);  // group(1) is the inner text of <p>
+/**
+ * @brief Extracts the words of the buffered paragraph text and removes them from the buffer.
+ *
+ * Unless the paragraph is complete, text after the last character that cannot be part of a word
+ * is kept in the buffer, because the word may continue in the next chunk.
+ *
+ * @param paragraph The buffered, cleaned paragraph text. Consumed text is erased.
+ * @param started False for the first piece of a paragraph, which numbers the paragraph; set to true.
+ * @param complete True if the closing </p> has been reached.
+ */
+void Page::flushParagraph(std::string& paragraph, bool& started, bool complete) {
+    if (!started) {
+        started = true;
+        TextSpill::Range range;
+        range.offset = paragraphSpill ? paragraphSpill->getSize() : 0;
+        paragraphs.push_back(range);
+        textEndsWithSpace = true; // leading whitespace is dropped
+        recentCount = 0; // phrases do not span paragraphs
+    }
 
-        // Strip any nested tags inside the <p> (like <b>, <a>, etc.)
-        std::regex innerTags(R"(<[^>]*>)");
-        std::string cleanParagraph = std::regex_replace(paragraph, innerTags, " ");
+    std::size_t end = paragraph.size();
+    if (!complete) {
+        while (end > 0 && (std::isalpha(static_cast<unsigned char>(paragraph[end - 1]))
+                           || paragraph[end - 1] == '\'' || paragraph[end - 1] == '-')) {
+            end--;
+        }
+        if (end == 0) {
+            end = paragraph.size(); // a single huge token; split it rather than buffering forever
+        }
+    }
 
-        extractWords(cleanParagraph);
-        ++iter;
+    // Spill the text for keyword-in-context windows, with runs of whitespace collapsed
+    if (paragraphSpill) {
+        std::string text;
+        text.reserve(end);
+        for (std::size_t i = 0; i < end; i++) {
+            char c = paragraph[i];
+            if (!std::isspace(static_cast<unsigned char>(c))) {
+                text += c;
+                textEndsWithSpace = false;
+            } else if (!textEndsWithSpace) {
+                text += ' ';
+                textEndsWithSpace = true;
+            }
+        }
+        paragraphSpill->append(text);
+        paragraphs.back().length += text.size();
     }
 
+    extractWords(paragraph.substr(0, end));
+    paragraph.erase(0, end);
 }
 
 /**
  * @brief Adds a word to the word list, or updates its occurrence if it already exists.
  *
+ * The occurrence is attributed to the paragraph that is currently being read.
+ *
  * @param word The word to be added or updated.
- * @param context A short excerpt or description indicating where the word appeared.
  */
-void Page::addWord(const std::string& word, const std::string& context) {
+void Page::addWord(const std::string& word) {
     // Skip empty words
     if (word.empty()) return;
 
-    for (auto& w : wordList) {
-        if (w.getWord() == word) {
-            w.addOccurrence(context);
+    int paragraph = static_cast<int>(paragraphs.size()) - 1;
+    auto it = wordIndex.find(word);
+    int index;
+    if (it != wordIndex.end()) {
+        index = static_cast<int>(it->second);
+        wordList[index].addOccurrence(paragraph);
+    } else {
+        index = static_cast<int>(wordList.size());
+        wordIndex.emplace(word, wordList.size());
+        wordList.emplace_back(word);
+        wordList.back().addOccurrence(paragraph);
+        wordHashes.push_back(PhraseCounter::hashWord(word));
+    }
+
+    // The keys of the bigram and trigram ending here are rolled forward from the previous word
+    std::uint64_t hash = wordHashes[index];
+    if (recentCount == 2) {
+        int words[3] = {recentWords[0], recentWords[1], index};
+        addPhrase(PhraseCounter::extendKey(recentBigramKey, hash), words, 3);
+    }
+    if (recentCount >= 1) {
+        int words[2] = {recentWords[1], index};
+        recentBigramKey = PhraseCounter::extendKey(PhraseCounter::startKey(wordHashes[recentWords[1]]), hash);
+        addPhrase(recentBigramKey, words, 2);
+    }
+    recentWords[0] = recentWords[1];
+    recentWords[1] = index;
+    recentCount = std::min(recentCount + 1, 2);
+}
+
+/**
+ * @brief Counts one occurrence of a bigram or trigram of the page.
+ *
+ * Every n-gram of the page goes through here, so the phrases are kept in a flat open-addressing
+ * table instead of a node-based map. The words of a phrase are compared whenever its key is seen
+ * again, so two phrases whose keys collide are never merged; the later one is not counted.
+ *
+ * @param key The phrase key.
+ * @param words The indices of the words of the phrase in the word list.
+ * @param length The number of words (2 or 3).
+ */
+void Page::addPhrase(std::uint64_t key, const int* words, int length) {
+    // Keep the table at most half full so probe sequences stay short
+    if ((phrases.size() + 1) * 2 > phraseSlots.size()) {
+        phraseSlots.assign(std::max(INITIAL_PHRASE_SLOTS, phraseSlots.size() * 2), -1);
+        std::size_t mask = phraseSlots.size() - 1;
+        for (std::size_t i = 0; i < phrases.size(); i++) {
+            std::size_t slot = (phrases[i].key ^ (phrases[i].key >> 32)) & mask;
+            while (phraseSlots[slot] >= 0) {
+                slot = (slot + 1) & mask;
+            }
+            phraseSlots[slot] = static_cast<int>(i);
+        }
+    }
+
+    std::size_t mask = phraseSlots.size() - 1;
+    std::size_t slot = (key ^ (key >> 32)) & mask;
+    while (phraseSlots[slot] >= 0) {
+        Phrase& phrase = phrases[phraseSlots[slot]];
+        if (phrase.key == key) {
+            if (phrase.length == length && std::equal(words, words + length, phrase.words)) {
+                phrase.count++;
+            }
             return;
         }
+        slot = (slot + 1) & mask;
     }
-    Word newWord(word);
-    newWord.addOccurrence(context);
-    wordList.push_back(newWord);
+
+    phraseSlots[slot] = static_cast<int>(phrases.size());
+    Phrase phrase{key, {-1, -1, -1}, length, 1};
+    std::copy(words, words + length, phrase.words);
+    phrases.push_back(phrase);
 }
 
 /**
  * @brief Extracts words from a string of text and stores them in the word list.
  *
+ * @param text The text string to process for word extraction.
+ */
+void Page::extractWords(const std::string& text) {
+    for (const std::string& word : splitWords(text)) {
+        addWord(word);
+    }
+}
+
+/**
+ * @brief Splits a string of text into the words that pages are counted by.
+ *
  * This function uses a regex to handle apostrophes and hyphens inside words.
  * It also strips punctuation and converts words to lowercase.
  *
  * @param text The text string to process for word extraction.
+ * @return The lowercase words in text order.
  */
-void Page::extractWords(const std::string& text) {
+std::vector<std::string> Page::splitWords(const std::string& text) {
     // Enhanced regex pattern that handles:
     // - Apostrophes in words (e.g., "don't")
     // - Hyphens in words (e.g., "state-of-the-art")
-    std::regex wordRegex(R"((?:[a-zA-Z]+(?:['-][a-zA-Z]+)*))");
+    static const std::regex wordRegex(R"((?:[a-zA-Z]+(?:['-][a-zA-Z]+)*))");
 
+    std::vector<std::string> words;
     std::sregex_iterator iter(text.begin(), text.end(), wordRegex);
     std::sregex_iterator end;
 
@@ -112,20 +317,53 @@ void Page::extractWords(const std::string& text) {
         std::string lowerWord = word;
         std::transform(lowerWord.begin(), lowerWord.end(), lowerWord.begin(), ::tolower);
 
-        std::string context = "File: " + pageName + " | Context: " + text.substr(0, 100) + "...";
-        addWord(lowerWord, context);
+        words.push_back(std::move(lowerWord));
     }
+    return words;
 }
 
 /**
  * @brief Returns the list of words found on the page.
  *
- * @return A vector of Word objects representing unique words and their occurrences.
+ * @return A const reference to the Word objects representing unique words and their occurrences.
  */
-std::vector<Word> Page::getWords() const {
+const std::pmr::vector<Word>& Page::getWords() const {
     return wordList;
 }
 
+/**
+ * @brief Moves the words found on the page out of the page, leaving it empty.
+ *
+ * @return The Word objects representing unique words and their occurrences.
+ */
+std::pmr::vector<Word> Page::takeWords() {
+    std::pmr::vector<Word> words(std::move(wordList));
+    wordList.clear();
+    wordIndex.clear();
+    wordHashes.clear();
+    return words;
+}
+
+/**
+ * @brief Moves the positions of the page's paragraph texts out of the page.
+ *
+ * @return The range of the cleaned text of every <p> element in the paragraph spill, indexed by
+ *         paragraph number; empty ranges if the page was read without a spill.
+ */
+std::vector<TextSpill::Range> Page::takeParagraphs() {
+    return std::move(paragraphs);
+}
+
+/**
+ * @brief Moves the bigrams and trigrams found on the page out of the page.
+ *
+ * @return Every distinct phrase with its number of occurrences; phrases never span paragraphs.
+ */
+std::vector<Page::Phrase> Page::takePhrases() {
+    phraseSlots.clear();
+    return std::move(phrases);
+}
+
 /**
  * @brief Gets the name of the page.
  *
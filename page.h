@@ -1,25 +1,56 @@
 #ifndef PAGE_H
 #define PAGE_H
 
+#include <cstdint>
+#include <memory_resource>
 #include <string>
+#include <unordered_map>
 #include <vector>
+#include "bytesource.h"
+#include "textspill.h"
 #include "word.h"
 
 class Page {
 public:
-    Page(const std::string& name, const std::string& path, const std::string& keyword);
+    struct Phrase {
+        std::uint64_t key;  // see PhraseCounter::extendKey()
+        int words[3];       // indices into getWords()
+        int length;         // 2 or 3
+        int count;
+    };
+
+    Page(const std::string& name, const std::string& path, const std::string& keyword,
+         const Word::allocator_type& alloc = {}, TextSpill* paragraphSpill = nullptr);
     void readPage();
-    std::vector<Word> getWords() const;
+    void readPage(ByteSource& source);
+    const std::pmr::vector<Word>& getWords() const;
+    std::pmr::vector<Word> takeWords();
+    std::vector<TextSpill::Range> takeParagraphs();
+    std::vector<Phrase> takePhrases();
     std::string getName() const;
+    static std::vector<std::string> splitWords(const std::string& text);
 
 private:
-    void addWord(const std::string& word, const std::string& context);
+    void addWord(const std::string& word);
+    void addPhrase(std::uint64_t key, const int* words, int length);
     void extractWords(const std::string& text);
+    void flushParagraph(std::string& paragraph, bool& started, bool complete);
+    static bool isTagNamed(const std::string& tagHead, const std::string& name);
 
     std::string pageName;
     std::string path;
     std::string keyword;
-    std::vector<Word> wordList;
+    std::pmr::vector<Word> wordList;
+    std::unordered_map<std::string, std::size_t> wordIndex; // position of each word in wordList
+    TextSpill* paragraphSpill;                             // receives the cleaned text of every <p>; may be null
+    std::vector<TextSpill::Range> paragraphs;              // position of every paragraph's text in paragraphSpill
+    bool textEndsWithSpace;                                // the spilled text of the current paragraph ends in a space
+    std::vector<std::uint64_t> wordHashes;                 // PhraseCounter::hashWord() of every word, parallel to wordList
+    std::vector<Phrase> phrases;                           // distinct bigrams and trigrams of the page
+    std::vector<int> phraseSlots;                          // open-addressing table of indices into phrases, -1 if empty
+    int recentWords[2];            // indices of the last two words of the current paragraph
+    int recentCount;               // number of valid entries in recentWords (0 to 2)
+    std::uint64_t recentBigramKey; // key of the phrase formed by recentWords
 };
 
 #endif // PAGE_H
@@ -0,0 +1,306 @@
+#include "phrasecounter.h"
+#include <algorithm>
+#include <cmath>
+
+/// Bound on how far a sketch estimate exceeds the true count, as a fraction of all counted occurrences
+const double SKETCH_ERROR_RATE = 2e-5;
+
+/// Probability that a sketch estimate exceeds the true count by more than SKETCH_ERROR_RATE
+const double SKETCH_ERROR_PROBABILITY = 0.01;
+
+/// Number of occurrences from which a phrase is counted individually and reported
+const int MIN_PHRASE_COUNT = 2;
+
+/// Maximum number of individually counted phrases; the least frequent half is dropped beyond this
+const std::size_t MAX_TRACKED_PHRASES = 1 << 16;
+
+/// Multiplier of the polynomial rolling hash over word hashes
+const std::uint64_t PHRASE_HASH_BASE = 0x100000001b3ULL;
+
+/// Key of the empty phrase, so that phrases of different lengths do not share keys
+const std::uint64_t PHRASE_HASH_SEED = 0x9e3779b97f4a7c15ULL;
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs an empty counter for multi-word phrases (bigrams and trigrams).
+ *
+ * Most phrases of a large corpus occur only once, so storing every phrase with its spelling
+ * would use more memory than the words themselves. Every occurrence is therefore first added
+ * to a count-min sketch, which can only overestimate counts. The sketch is sized so that, with
+ * probability 1 - SKETCH_ERROR_PROBABILITY, an estimate exceeds the true count by at most
+ * SKETCH_ERROR_RATE times the number of counted occurrences: e / SKETCH_ERROR_RATE counters per
+ * row and ln(1 / SKETCH_ERROR_PROBABILITY) rows. A phrase is counted individually, with its
+ * spelling, once its estimate minus that bound reaches MIN_PHRASE_COUNT, so phrases that only
+ * share counters with frequent ones are not tracked. At most MAX_TRACKED_PHRASES phrases are
+ * tracked at a time.
+ *
+ * The count of a tracked phrase starts from its sketch estimate and is an upper bound of the
+ * true count. Its exact count is kept from the document it was tracked in on; getTop() counts
+ * the occurrences in earlier documents once, when the phrase is about to be reported, so no
+ * phrase needs to be stored per document.
+ *
+ * Phrases are identified by a 64-bit key derived from the hashes of their words (see
+ * startKey() and extendKey()), so callers only have to spell out phrases that are tracked.
+ */
+PhraseCounter::PhraseCounter()
+    : depth(static_cast<int>(std::ceil(std::log(1.0 / SKETCH_ERROR_PROBABILITY)))), width(1), totalCount(0)
+{
+    while (width < std::exp(1.0) / SKETCH_ERROR_RATE) {
+        width *= 2;
+    }
+    sketch.assign(depth * width, 0);
+}
+
+/**
+ * @brief Hashes a single word with 64-bit FNV-1a.
+ *
+ * @param word The lowercase word.
+ * @return The word hash.
+ */
+std::uint64_t PhraseCounter::hashWord(std::string_view word)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (char c : word) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+/**
+ * @brief Gets the key of the phrase that consists of one word.
+ *
+ * @param wordHash The hash of the word.
+ * @return The key, to be extended by the following words.
+ */
+std::uint64_t PhraseCounter::startKey(std::uint64_t wordHash)
+{
+    return extendKey(PHRASE_HASH_SEED, wordHash);
+}
+
+/**
+ * @brief Appends a word to a phrase key.
+ *
+ * The key of (a, b, c) is the key of (a, b) extended by c, so the keys of all phrases ending at
+ * a word are computed from the keys ending at the previous word in constant time.
+ *
+ * @param key The key of the phrase so far.
+ * @param wordHash The hash of the next word.
+ * @return The key of the longer phrase.
+ */
+std::uint64_t PhraseCounter::extendKey(std::uint64_t key, std::uint64_t wordHash)
+{
+    return key * PHRASE_HASH_BASE + wordHash;
+}
+
+/**
+ * @brief Adds occurrences of a phrase.
+ *
+ * @param key The phrase key.
+ * @param count The number of occurrences.
+ * @return True if the phrase has become frequent enough to be tracked; the caller must then
+ *         pass its spelling to track().
+ */
+bool PhraseCounter::add(std::uint64_t key, int count)
+{
+    for (int row = 0; row < depth; row++) {
+        sketch[cell(row, key)] += static_cast<std::uint32_t>(count);
+    }
+    totalCount += count;
+
+    auto it = candidates.find(key);
+    if (it != candidates.end()) {
+        it->second.count += count;
+        it->second.exactCount += count;
+        return false;
+    }
+    return estimate(key) - errorBound() >= MIN_PHRASE_COUNT;
+}
+
+/**
+ * @brief Starts counting a phrase individually after add() has asked for it.
+ *
+ * @param key The phrase key.
+ * @param phrase The words of the phrase separated by single spaces.
+ * @param count The occurrences just passed to add().
+ * @param document The number of the document they belong to; documents are numbered in the
+ *                 order they are added.
+ */
+void PhraseCounter::track(std::uint64_t key, std::string phrase, int count, int document)
+{
+    // If the estimate is no higher than these occurrences, no earlier document contains the phrase
+    int bound = estimate(key);
+    candidates.emplace(key, Candidate{std::move(phrase), bound, count, bound > count ? document : 0});
+    if (candidates.size() > MAX_TRACKED_PHRASES) {
+        prune();
+    }
+}
+
+/**
+ * @brief Removes occurrences that were added before, e.g. when a page is removed.
+ *
+ * @param key The phrase key.
+ * @param count The number of occurrences to remove.
+ * @param document The number of the document they were added with.
+ */
+void PhraseCounter::remove(std::uint64_t key, int count, int document)
+{
+    for (int row = 0; row < depth; row++) {
+        std::uint32_t& counter = sketch[cell(row, key)];
+        counter -= std::min(counter, static_cast<std::uint32_t>(count));
+    }
+    totalCount -= std::min(totalCount, static_cast<std::uint64_t>(count));
+
+    auto it = candidates.find(key);
+    if (it != candidates.end()) {
+        it->second.count -= count;
+        if (document >= it->second.firstDocument) {
+            it->second.exactCount -= count;
+        }
+        if (it->second.count <= 0) {
+            candidates.erase(it);
+        }
+    }
+}
+
+/**
+ * @brief Estimates the number of occurrences of a phrase from the sketch.
+ *
+ * @param key The phrase key.
+ * @return An upper bound of the occurrence count.
+ */
+int PhraseCounter::estimate(std::uint64_t key) const
+{
+    std::uint32_t minimum = sketch[cell(0, key)];
+    for (int row = 1; row < depth; row++) {
+        minimum = std::min(minimum, sketch[cell(row, key)]);
+    }
+    return static_cast<int>(minimum);
+}
+
+/**
+ * @brief Gets the amount by which a sketch estimate may exceed the true count.
+ *
+ * @return SKETCH_ERROR_RATE times the number of counted occurrences, rounded down since counts are whole.
+ */
+int PhraseCounter::errorBound() const
+{
+    return static_cast<int>(SKETCH_ERROR_RATE * static_cast<double>(totalCount));
+}
+
+/**
+ * @brief Gets the number of phrases that are currently counted individually.
+ *
+ * @return The number of tracked phrases.
+ */
+std::size_t PhraseCounter::getTrackedCount() const
+{
+    return candidates.size();
+}
+
+/**
+ * @brief Gets the most frequent phrases with their exact counts.
+ *
+ * The tracked counts are upper bounds, so the phrases are checked in order of their bound: the
+ * exact counts of the 2 * limit highest bounds are completed, and the range is doubled until
+ * the limit-th exact count is no lower than the bound of the first unchecked phrase. A checked
+ * phrase that was tracked after some of its occurrences had been added has those counted by
+ * countEarlier, once; from then on its count is exact. Only phrases that occur at least
+ * MIN_PHRASE_COUNT times are returned. Phrases with the same count are ordered alphabetically.
+ *
+ * @param limit The maximum number of phrases to return.
+ * @param countEarlier Counts the occurrences of a phrase in the documents before a given one.
+ * @return A column store of the phrases and their counts; ids are ranks, most frequent first.
+ */
+std::shared_ptr<const WordColumns> PhraseCounter::getTop(std::size_t limit, const ExactCounter& countEarlier)
+{
+    std::vector<std::pair<const std::uint64_t, Candidate>*> bounded;
+    for (auto& pair : candidates) {
+        if (pair.second.count >= MIN_PHRASE_COUNT) {
+            bounded.push_back(&pair);
+        }
+    }
+    std::sort(bounded.begin(), bounded.end(), [](const auto* a, const auto* b) { return a->second.count > b->second.count; });
+
+    std::vector<Candidate> ranked;
+    auto byCount = [](const Candidate& a, const Candidate& b) {
+        return a.count != b.count ? a.count > b.count : a.phrase < b.phrase;
+    };
+    std::size_t checked = std::min(bounded.size(), 2 * limit);
+    while (limit > 0) {
+        ranked.clear();
+        for (std::size_t i = 0; i < checked; i++) {
+            Candidate& candidate = bounded[i]->second;
+            if (candidate.firstDocument > 0) {
+                candidate.exactCount += countEarlier(candidate.phrase, candidate.firstDocument);
+                candidate.firstDocument = 0;
+                candidate.count = candidate.exactCount; // the tightest bound there is
+            }
+            if (candidate.exactCount >= MIN_PHRASE_COUNT) {
+                ranked.push_back({candidate.phrase, candidate.exactCount, candidate.exactCount, 0});
+            }
+        }
+        std::size_t kept = std::min(limit, ranked.size());
+        std::partial_sort(ranked.begin(), ranked.begin() + kept, ranked.end(), byCount);
+        ranked.resize(kept);
+
+        if (checked == bounded.size() || (kept == limit && ranked.back().count >= bounded[checked]->second.count)) {
+            break;
+        }
+        checked = std::min(bounded.size(), 2 * checked);
+    }
+
+    auto top = std::make_shared<WordColumns>();
+    for (const Candidate& candidate : ranked) {
+        top->addOccurrences(top->intern(candidate.phrase), candidate.count, 0, 0);
+    }
+    return top;
+}
+
+/**
+ * @brief Gets the position of the counter of a phrase in one row of the sketch.
+ *
+ * The rows use the two halves of the mixed key as the two hashes of double hashing.
+ *
+ * @param row The row.
+ * @param key The phrase key.
+ * @return The index into sketch.
+ */
+std::size_t PhraseCounter::cell(int row, std::uint64_t key) const
+{
+    // Final mixing step of SplitMix64, so that the low bits depend on every word of the phrase
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ULL;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebULL;
+    key ^= key >> 31;
+
+    std::uint64_t low = key & 0xffffffffULL;
+    std::uint64_t high = (key >> 32) | 1;
+    return row * width + ((low + row * high) & (width - 1));
+}
+
+/**
+ * @brief Drops the less frequent half of the tracked phrases.
+ *
+ * A dropped phrase is tracked again, starting from its sketch estimate, once it occurs again.
+ */
+void PhraseCounter::prune()
+{
+    std::vector<int> counts;
+    counts.reserve(candidates.size());
+    for (const auto& pair : candidates) {
+        counts.push_back(pair.second.count);
+    }
+    auto median = counts.begin() + counts.size() / 2;
+    std::nth_element(counts.begin(), median, counts.end());
+    int threshold = *median;
+
+    for (auto it = candidates.begin(); it != candidates.end();) {
+        if (it->second.count <= threshold && candidates.size() > MAX_TRACKED_PHRASES / 2) {
+            it = candidates.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
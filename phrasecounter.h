@@ -0,0 +1,52 @@
+#ifndef PHRASECOUNTER_H
+#define PHRASECOUNTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "wordcolumns.h"
+
+class PhraseCounter {
+public:
+    /// Counts the occurrences of a phrase in the documents numbered below a limit
+    using ExactCounter = std::function<int(const std::string& phrase, int beforeDocument)>;
+
+    PhraseCounter();
+
+    static std::uint64_t hashWord(std::string_view word);
+    static std::uint64_t startKey(std::uint64_t wordHash);
+    static std::uint64_t extendKey(std::uint64_t key, std::uint64_t wordHash);
+
+    bool add(std::uint64_t key, int count);
+    void track(std::uint64_t key, std::string phrase, int count, int document);
+    void remove(std::uint64_t key, int count, int document);
+    int estimate(std::uint64_t key) const;
+
+    std::size_t getTrackedCount() const;
+    std::shared_ptr<const WordColumns> getTop(std::size_t limit, const ExactCounter& countEarlier);
+
+private:
+    struct Candidate {
+        std::string phrase;
+        int count;         // upper bound of the occurrences
+        int exactCount;    // occurrences in the documents from firstDocument on
+        int firstDocument; // documents before this one are not part of exactCount yet
+    };
+
+    std::size_t cell(int row, std::uint64_t key) const;
+    int errorBound() const;
+    void prune();
+
+    int depth;                                               // number of rows (hash functions) of the sketch
+    std::size_t width;                                       // number of counters per row; a power of two
+    std::vector<std::uint32_t> sketch;                       // count-min sketch, one row of counters per hash function
+    std::uint64_t totalCount;                                // occurrences currently counted in the sketch
+    std::unordered_map<std::uint64_t, Candidate> candidates; // phrases tracked individually, with an upper bound of their count
+};
+
+#endif // PHRASECOUNTER_H
@@ -0,0 +1,250 @@
+#include "predictioncache.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+
+/// Identifies a saved prediction cache and its format version
+const char PREDICTION_CACHE_MAGIC[8] = {'M', 'M', 'P', 'C', '0', '0', '0', '2'};
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs an empty cache of predicted labels.
+ *
+ * Entries are evicted with the CLOCK algorithm: every slot has a reference bit that is set when
+ * the entry is looked up, and a hand sweeps the slots, clearing set bits and evicting the first
+ * entry whose bit is already clear. Frequently repeated texts therefore stay cached while
+ * one-off texts are replaced, at the cost of a single bit per entry instead of a recency list.
+ *
+ * Lookups only take a shared lock and update the reference bit atomically, so several threads
+ * can look up predictions at the same time; insertions take an exclusive lock.
+ *
+ * @param capacity The maximum number of cached predictions.
+ */
+PredictionCache::PredictionCache(std::size_t capacity)
+    : capacity(capacity), referenced(capacity), hand(0), hits(0), misses(0)
+{
+    keys.reserve(capacity);
+    labels.reserve(capacity);
+    slots.reserve(capacity);
+}
+
+/**
+ * @brief Hashes the token sequence of a text, from which the input of the model is built.
+ *
+ * Texts that normalise to the same words get the same key, whatever their original spelling.
+ *
+ * @param tokens The 32-bit hashes (or ids) of the words.
+ * @return A 64-bit key (FNV-1a over the tokens, followed by a SplitMix64 mixing step).
+ */
+std::uint64_t PredictionCache::hashTokens(const std::vector<std::int32_t>& tokens)
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+    for (std::int32_t token : tokens) {
+        hash ^= static_cast<std::uint32_t>(token);
+        hash *= 0x100000001b3ULL;
+    }
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ULL;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebULL;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+/**
+ * @brief Looks up a cached prediction.
+ *
+ * @param key The key of the token sequence.
+ * @param label Receives the predicted label index if the key is cached.
+ * @return True on a hit.
+ */
+bool PredictionCache::lookup(std::uint64_t key, std::int32_t& label)
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    auto it = slots.find(key);
+    if (it == slots.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    referenced[it->second].store(true, std::memory_order_relaxed);
+    label = labels[it->second];
+    hits.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+/**
+ * @brief Caches a prediction, evicting another one if the cache is full.
+ *
+ * @param key The key of the token sequence.
+ * @param label The predicted label index, or -1 if the model returned no prediction.
+ */
+void PredictionCache::insert(std::uint64_t key, std::int32_t label)
+{
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    insertLocked(key, label);
+}
+
+/**
+ * @brief Replaces the cache contents with predictions saved by a previous run.
+ *
+ * Nothing is loaded if the file was saved for a different model.
+ *
+ * @param file The cache file.
+ * @param modelFingerprint Identifies the model the predictions must have been made with.
+ * @return True if predictions were loaded.
+ */
+bool PredictionCache::load(const std::string& file, std::uint64_t modelFingerprint)
+{
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+
+    char magic[sizeof(PREDICTION_CACHE_MAGIC)];
+    std::uint64_t fingerprint = 0;
+    std::uint64_t count = 0;
+    in.read(magic, sizeof(magic));
+    in.read(reinterpret_cast<char*>(&fingerprint), sizeof(fingerprint));
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || std::memcmp(magic, PREDICTION_CACHE_MAGIC, sizeof(magic)) != 0) {
+        std::cerr << "Error: " << file << " is not a valid prediction cache" << std::endl;
+        return false;
+    }
+    if (fingerprint != modelFingerprint) {
+        return false;
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex);
+    keys.clear();
+    labels.clear();
+    slots.clear();
+    hand = 0;
+    for (std::uint64_t i = 0; i < count && in; i++) {
+        std::uint64_t key;
+        std::int32_t label;
+        in.read(reinterpret_cast<char*>(&key), sizeof(key));
+        in.read(reinterpret_cast<char*>(&label), sizeof(label));
+        if (in) {
+            insertLocked(key, label);
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Saves the cached predictions for the next run.
+ *
+ * The file is written under a temporary name and renamed into place, so an interrupted save
+ * leaves the previous file intact.
+ *
+ * @param file The cache file.
+ * @param modelFingerprint Identifies the model the predictions were made with.
+ * @return True on success.
+ */
+bool PredictionCache::save(const std::string& file, std::uint64_t modelFingerprint) const
+{
+    std::string temporary = file + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::uint64_t count = keys.size();
+        out.write(PREDICTION_CACHE_MAGIC, sizeof(PREDICTION_CACHE_MAGIC));
+        out.write(reinterpret_cast<const char*>(&modelFingerprint), sizeof(modelFingerprint));
+        out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+        for (std::size_t i = 0; i < keys.size(); i++) {
+            out.write(reinterpret_cast<const char*>(&keys[i]), sizeof(keys[i]));
+            out.write(reinterpret_cast<const char*>(&labels[i]), sizeof(labels[i]));
+        }
+        if (!out) {
+            std::cerr << "Error: Unable to write prediction cache " << temporary << std::endl;
+            return false;
+        }
+    }
+    if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+        std::cerr << "Error: Unable to rename prediction cache to " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the number of cached predictions.
+ *
+ * @return The number of entries.
+ */
+std::size_t PredictionCache::getSize() const
+{
+    std::shared_lock<std::shared_mutex> lock(mutex);
+    return keys.size();
+}
+
+/**
+ * @brief Gets the number of lookups that found a cached prediction.
+ *
+ * @return The number of hits since construction.
+ */
+std::uint64_t PredictionCache::getHits() const
+{
+    return hits.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the number of lookups that had to be answered by the model.
+ *
+ * @return The number of misses since construction.
+ */
+std::uint64_t PredictionCache::getMisses() const
+{
+    return misses.load(std::memory_order_relaxed);
+}
+
+/**
+ * @brief Gets the fraction of lookups that were hits.
+ *
+ * @return The hit rate between 0 and 1, or 0 before the first lookup.
+ */
+double PredictionCache::getHitRate() const
+{
+    std::uint64_t hitCount = getHits();
+    std::uint64_t total = hitCount + getMisses();
+    return total > 0 ? static_cast<double>(hitCount) / total : 0.0;
+}
+
+/**
+ * @brief Inserts an entry while the exclusive lock is held.
+ *
+ * @param key The key of the token sequence.
+ * @param label The predicted label index.
+ */
+void PredictionCache::insertLocked(std::uint64_t key, std::int32_t label)
+{
+    if (capacity == 0) {
+        return;
+    }
+    auto it = slots.find(key);
+    if (it != slots.end()) {
+        labels[it->second] = label;
+        return;
+    }
+
+    std::size_t slot;
+    if (keys.size() < capacity) {
+        slot = keys.size();
+        keys.push_back(key);
+        labels.push_back(label);
+    } else {
+        // Give every referenced entry a second chance until an unreferenced one is found
+        while (referenced[hand].exchange(false, std::memory_order_relaxed)) {
+            hand = (hand + 1) % capacity;
+        }
+        slot = hand;
+        hand = (hand + 1) % capacity;
+        slots.erase(keys[slot]);
+        keys[slot] = key;
+        labels[slot] = label;
+    }
+    referenced[slot].store(false, std::memory_order_relaxed);
+    slots.emplace(key, slot);
+}
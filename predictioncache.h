@@ -0,0 +1,43 @@
+#ifndef PREDICTIONCACHE_H
+#define PREDICTIONCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class PredictionCache {
+public:
+    explicit PredictionCache(std::size_t capacity);
+
+    static std::uint64_t hashTokens(const std::vector<std::int32_t>& tokens);
+
+    bool lookup(std::uint64_t key, std::int32_t& label);
+    void insert(std::uint64_t key, std::int32_t label);
+
+    bool load(const std::string& file, std::uint64_t modelFingerprint);
+    bool save(const std::string& file, std::uint64_t modelFingerprint) const;
+
+    std::size_t getSize() const;
+    std::uint64_t getHits() const;
+    std::uint64_t getMisses() const;
+    double getHitRate() const;
+
+private:
+    void insertLocked(std::uint64_t key, std::int32_t label);
+
+    mutable std::shared_mutex mutex;
+    std::size_t capacity;
+    std::vector<std::uint64_t> keys;                 // key of every used slot
+    std::vector<std::int32_t> labels;                // predicted label of every used slot
+    std::vector<std::atomic<bool>> referenced;       // CLOCK reference bit of every slot
+    std::unordered_map<std::uint64_t, std::size_t> slots; // slot of every cached key
+    std::size_t hand;                                // next slot the CLOCK hand inspects
+    std::atomic<std::uint64_t> hits;
+    std::atomic<std::uint64_t> misses;
+};
+
+#endif // PREDICTIONCACHE_H
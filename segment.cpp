@@ -0,0 +1,660 @@
+#include "segment.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+/// Identifies a segment file and its format version
+const char SEGMENT_MAGIC[8] = {'M', 'M', 'S', 'E', 'G', '0', '0', '1'};
+
+/// Written as a native integer so that files from a machine with a different byte order are rejected
+const std::uint32_t BYTE_ORDER_MARK = 0x01020304;
+
+enum Section {
+    TERM_OFFSETS,
+    TERM_BLOB,
+    TERM_COUNTS,
+    DOCUMENT_FREQUENCIES,
+    POSTING_OFFSETS,
+    POSTINGS,
+    DOCUMENT_OFFSETS,
+    DOCUMENT_BLOB,
+    PARAGRAPH_STARTS,
+    PARAGRAPH_OFFSETS,
+    PARAGRAPH_BLOB,
+    TOMBSTONE_OFFSETS,
+    TOMBSTONE_BLOB,
+    SECTION_COUNT
+};
+
+struct Header {
+    char magic[8];
+    std::uint32_t byteOrderMark;
+    std::uint32_t termCount;
+    std::uint32_t documentCount;
+    std::uint32_t paragraphCount;
+    std::uint32_t tombstoneCount;
+    std::uint32_t reserved;
+    std::uint64_t sections[SECTION_COUNT + 1]; // start of every section, followed by the file size
+};
+
+/// Bytes of a section kept in memory before they are moved to a temporary file
+const std::size_t SECTION_BUFFER_SIZE = 1 << 20;
+
+/**
+ * @brief Rounds a file position up to the 8-byte alignment of every section.
+ */
+std::uint64_t alignSection(std::uint64_t position)
+{
+    return (position + 7) & ~std::uint64_t(7);
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Writes an immutable segment file.
+ *
+ * The file holds the sorted vocabulary with per-term occurrence counts and document
+ * frequencies, the posting list of every term in the encoding used by InvertedIndex, the
+ * document paths with the text of their paragraphs, and the tombstones. All sections are
+ * arrays that a reader can use directly from a memory mapping. The file is written under a
+ * temporary name and renamed into place, so a segment is either complete or absent.
+ *
+ * @param file The path of the segment file to create.
+ * @param data The documents and tombstones to store; documents are sorted by path.
+ * @return True on success, false if the file could not be written.
+ */
+bool writeSegment(const std::string& file, SegmentData data)
+{
+    std::sort(data.documents.begin(), data.documents.end(),
+              [](const SegmentData::Document& a, const SegmentData::Document& b) { return a.path < b.path; });
+    std::sort(data.tombstones.begin(), data.tombstones.end());
+    data.tombstones.erase(std::unique(data.tombstones.begin(), data.tombstones.end()), data.tombstones.end());
+
+    // Encode the postings with the same code as the in-memory index
+    InvertedIndex index;
+    std::map<std::string, std::pair<std::uint32_t, std::uint32_t>> termStats; // count, document frequency
+    for (SegmentData::Document& document : data.documents) {
+        int id = index.addDocument();
+        for (const auto& term : document.terms) {
+            index.addTerm(id, term.first, term.second.data(), term.second.size());
+            auto& stats = termStats[term.first];
+            stats.first += static_cast<std::uint32_t>(term.second.size());
+            stats.second++;
+        }
+    }
+
+    SegmentWriter writer(file);
+    index.forEachTerm([&writer, &termStats](const std::string& term, const std::string& encoded) {
+        const auto& stats = termStats[term];
+        writer.addTerm(term, encoded, stats.first, stats.second);
+    });
+    for (const SegmentData::Document& document : data.documents) {
+        writer.addDocument(document.path);
+        for (const TextSpill::Range& paragraph : document.paragraphs) {
+            writer.addParagraph(data.paragraphTexts ? data.paragraphTexts->read(paragraph) : std::string());
+        }
+    }
+    for (const std::string& tombstone : data.tombstones) {
+        writer.addTombstone(tombstone);
+    }
+    return writer.finish();
+}
+
+/**
+ * @brief Starts an empty segment file.
+ *
+ * Each section is collected in a buffer of its own; a section that outgrows
+ * SECTION_BUFFER_SIZE is moved to a temporary file piece by piece, so writing a segment of any
+ * size, e.g. while merging, takes bounded memory. Nothing is written to the segment file itself
+ * before finish().
+ *
+ * @param file The path of the segment file to create.
+ */
+SegmentWriter::SegmentWriter(const std::string& file)
+    : file(file), sections(SECTION_COUNT), termCount(0), documentCount(0), paragraphCount(0), tombstoneCount(0)
+{
+    // Offset tables start at 0 and have one entry more than they have strings
+    for (int section : {TERM_OFFSETS, POSTING_OFFSETS, DOCUMENT_OFFSETS, PARAGRAPH_OFFSETS, TOMBSTONE_OFFSETS}) {
+        appendValue<std::uint64_t>(section, 0);
+    }
+    appendValue<std::uint32_t>(PARAGRAPH_STARTS, 0);
+}
+
+/**
+ * @brief Adds the next term of the vocabulary.
+ *
+ * @param term The term; larger than every term added before.
+ * @param postings The posting list of the term, encoded with InvertedIndex::encodePostings().
+ * @param count The number of occurrences of the term in all documents.
+ * @param documentFrequency The number of documents that contain the term.
+ */
+void SegmentWriter::addTerm(std::string_view term, std::string_view postings, std::uint32_t count,
+                            std::uint32_t documentFrequency)
+{
+    append(TERM_BLOB, term.data(), term.size());
+    appendValue(TERM_OFFSETS, sections[TERM_BLOB].size);
+    appendValue(TERM_COUNTS, count);
+    appendValue(DOCUMENT_FREQUENCIES, documentFrequency);
+    append(POSTINGS, postings.data(), postings.size());
+    appendValue(POSTING_OFFSETS, sections[POSTINGS].size);
+    termCount++;
+}
+
+/**
+ * @brief Adds the next document; its paragraphs are added next.
+ *
+ * @param path The path of the document; larger than every path added before. Postings refer to
+ *             documents by the order in which they are added.
+ */
+void SegmentWriter::addDocument(std::string_view path)
+{
+    if (documentCount > 0) {
+        appendValue(PARAGRAPH_STARTS, paragraphCount); // end of the previous document
+    }
+    append(DOCUMENT_BLOB, path.data(), path.size());
+    appendValue(DOCUMENT_OFFSETS, sections[DOCUMENT_BLOB].size);
+    documentCount++;
+}
+
+/**
+ * @brief Adds the next paragraph of the most recently added document.
+ *
+ * @param text The text of the paragraph.
+ */
+void SegmentWriter::addParagraph(std::string_view text)
+{
+    append(PARAGRAPH_BLOB, text.data(), text.size());
+    appendValue(PARAGRAPH_OFFSETS, sections[PARAGRAPH_BLOB].size);
+    paragraphCount++;
+}
+
+/**
+ * @brief Adds the path of a document deleted from older segments.
+ *
+ * @param path The path; larger than every tombstone added before.
+ */
+void SegmentWriter::addTombstone(std::string_view path)
+{
+    append(TOMBSTONE_BLOB, path.data(), path.size());
+    appendValue(TOMBSTONE_OFFSETS, sections[TOMBSTONE_BLOB].size);
+    tombstoneCount++;
+}
+
+/**
+ * @brief Writes the segment file from the collected sections.
+ *
+ * The file is written under a temporary name and renamed into place, so a segment is either
+ * complete or absent.
+ *
+ * @return True on success, false (after printing an error) if the file could not be written.
+ */
+bool SegmentWriter::finish()
+{
+    if (documentCount > 0) {
+        appendValue(PARAGRAPH_STARTS, paragraphCount);
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC));
+    header.byteOrderMark = BYTE_ORDER_MARK;
+    header.termCount = termCount;
+    header.documentCount = documentCount;
+    header.paragraphCount = paragraphCount;
+    header.tombstoneCount = tombstoneCount;
+    std::uint64_t position = sizeof(Header);
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        header.sections[i] = alignSection(position);
+        position = header.sections[i] + sections[i].size;
+    }
+    header.sections[SECTION_COUNT] = alignSection(position);
+
+    std::string temporary = file + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+        position = sizeof(Header);
+        const char padding[8] = {};
+        for (int i = 0; i <= SECTION_COUNT && out; i++) {
+            out.write(padding, static_cast<std::streamsize>(header.sections[i] - position));
+            if (i == SECTION_COUNT) {
+                break;
+            }
+            const SectionBuffer& section = sections[i];
+            std::uint64_t spilled = section.spill ? section.spill->getSize() : 0;
+            if (spilled + section.pending.size() != section.size) {
+                out.setstate(std::ios::failbit); // the temporary file lost bytes
+            }
+            for (TextSpill::Range piece{0, 0}; piece.offset < spilled && out; piece.offset += piece.length) {
+                piece.length = std::min<std::uint64_t>(SECTION_BUFFER_SIZE, spilled - piece.offset);
+                std::string bytes = section.spill->read(piece);
+                if (bytes.size() != piece.length) {
+                    out.setstate(std::ios::failbit);
+                }
+                out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            }
+            out.write(section.pending.data(), static_cast<std::streamsize>(section.pending.size()));
+            position = header.sections[i] + section.size;
+        }
+        if (!out) {
+            std::cerr << "Error: Unable to write segment " << temporary << std::endl;
+            out.close();
+            std::remove(temporary.c_str());
+            return false;
+        }
+    }
+    std::remove(file.c_str());
+    if (std::rename(temporary.c_str(), file.c_str()) != 0) {
+        std::cerr << "Error: Unable to rename segment to " << file << std::endl;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Appends bytes to a section, moving the buffered part to a temporary file when it is full.
+ */
+void SegmentWriter::append(int section, const void* bytes, std::size_t size)
+{
+    SectionBuffer& buffer = sections[section];
+    buffer.pending.append(static_cast<const char*>(bytes), size);
+    buffer.size += size;
+    if (buffer.pending.size() >= SECTION_BUFFER_SIZE) {
+        if (!buffer.spill) {
+            buffer.spill = std::make_unique<TextSpill>();
+        }
+        buffer.spill->append(buffer.pending);
+        buffer.pending.clear();
+    }
+}
+
+/**
+ * @brief Appends one array element to a section.
+ */
+template <typename T>
+void SegmentWriter::appendValue(int section, T value)
+{
+    append(section, &value, sizeof(T));
+}
+
+/**
+ * @brief Opens a segment file written by writeSegment().
+ *
+ * The file is memory-mapped. Opening reads the header and the offset tables (see load()), but no
+ * posting list; those are read from disk and checked when a query or merge first decodes them.
+ * On Windows the file is read into memory instead.
+ *
+ * @param file The path of the segment file.
+ * @return The segment, or nullptr (after printing an error) if the file is missing or invalid.
+ */
+std::shared_ptr<Segment> Segment::open(const std::string& file)
+{
+    std::shared_ptr<Segment> segment(new Segment());
+    segment->file = file;
+
+#ifdef _WIN32
+    std::ifstream in(file, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Unable to open segment " << file << std::endl;
+        return nullptr;
+    }
+    segment->buffer.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    segment->data = segment->buffer.data();
+    segment->size = segment->buffer.size();
+#else
+    int fd = ::open(file.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Error: Unable to open segment " << file << std::endl;
+        return nullptr;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        std::cerr << "Error: Unable to read segment " << file << std::endl;
+        return nullptr;
+    }
+    void* mapping = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Error: Unable to map segment " << file << std::endl;
+        return nullptr;
+    }
+    segment->data = static_cast<const char*>(mapping);
+    segment->size = static_cast<std::size_t>(info.st_size);
+#endif
+
+    if (!segment->load()) {
+        std::cerr << "Error: " << file << " is not a valid segment" << std::endl;
+        return nullptr;
+    }
+    return segment;
+}
+
+/**
+ * @brief Unmaps the segment file.
+ */
+Segment::~Segment()
+{
+#ifndef _WIN32
+    if (data) {
+        munmap(const_cast<char*>(data), size);
+    }
+#endif
+}
+
+/**
+ * @brief Validates the header and locates the sections of the mapped file.
+ *
+ * The sections must follow the header in order, and every array must fit into its section, so
+ * that no accessor reads past the end of the mapping. Every offset table must also be
+ * non-decreasing and end within its section. The posting lists, which make up most of a
+ * segment, are not read here; decodePostings() checks each list it decodes.
+ *
+ * @return True if the file is a complete segment of the supported version.
+ */
+bool Segment::load()
+{
+    if (size < sizeof(Header)) {
+        return false;
+    }
+    Header header;
+    std::memcpy(&header, data, sizeof(Header));
+    if (std::memcmp(header.magic, SEGMENT_MAGIC, sizeof(SEGMENT_MAGIC)) != 0
+        || header.byteOrderMark != BYTE_ORDER_MARK || header.sections[SECTION_COUNT] != size
+        || header.sections[0] < sizeof(Header)) {
+        return false;
+    }
+    for (int i = 0; i < SECTION_COUNT; i++) {
+        if (header.sections[i] > header.sections[i + 1] || header.sections[i] % 8 != 0) {
+            return false;
+        }
+    }
+
+    // Counts are returned as int; the products cannot overflow in 64 bits
+    auto fits = [&header](Section index, std::uint64_t count, std::uint64_t entrySize) {
+        return count <= static_cast<std::uint64_t>(std::numeric_limits<int>::max())
+               && count * entrySize <= header.sections[index + 1] - header.sections[index];
+    };
+    std::uint64_t termCount = header.termCount;
+    std::uint64_t documentCount = header.documentCount;
+    if (!fits(TERM_OFFSETS, termCount + 1, sizeof(std::uint64_t))
+        || !fits(TERM_COUNTS, termCount, sizeof(std::uint32_t))
+        || !fits(DOCUMENT_FREQUENCIES, termCount, sizeof(std::uint32_t))
+        || !fits(POSTING_OFFSETS, termCount + 1, sizeof(std::uint64_t))
+        || !fits(DOCUMENT_OFFSETS, documentCount + 1, sizeof(std::uint64_t))
+        || !fits(PARAGRAPH_STARTS, documentCount + 1, sizeof(std::uint32_t))
+        || !fits(PARAGRAPH_OFFSETS, header.paragraphCount + std::uint64_t(1), sizeof(std::uint64_t))
+        || !fits(TOMBSTONE_OFFSETS, header.tombstoneCount + std::uint64_t(1), sizeof(std::uint64_t))) {
+        return false;
+    }
+
+    auto section = [this, &header](Section index) { return data + header.sections[index]; };
+    terms = {reinterpret_cast<const std::uint64_t*>(section(TERM_OFFSETS)), section(TERM_BLOB), header.termCount};
+    termCounts = reinterpret_cast<const std::uint32_t*>(section(TERM_COUNTS));
+    documentFrequencies = reinterpret_cast<const std::uint32_t*>(section(DOCUMENT_FREQUENCIES));
+    postingOffsets = reinterpret_cast<const std::uint64_t*>(section(POSTING_OFFSETS));
+    postings = section(POSTINGS);
+    documents = {reinterpret_cast<const std::uint64_t*>(section(DOCUMENT_OFFSETS)), section(DOCUMENT_BLOB), header.documentCount};
+    paragraphStarts = reinterpret_cast<const std::uint32_t*>(section(PARAGRAPH_STARTS));
+    paragraphs = {reinterpret_cast<const std::uint64_t*>(section(PARAGRAPH_OFFSETS)), section(PARAGRAPH_BLOB), header.paragraphCount};
+    tombstones = {reinterpret_cast<const std::uint64_t*>(section(TOMBSTONE_OFFSETS)), section(TOMBSTONE_BLOB), header.tombstoneCount};
+
+    // Entry i spans offsets[i] to offsets[i + 1], so every entry lies within the last offset
+    auto ascending = [](const auto* offsets, std::uint64_t count, std::uint64_t limit) {
+        for (std::uint64_t i = 0; i < count; i++) {
+            if (offsets[i] > offsets[i + 1]) {
+                return false;
+            }
+        }
+        return offsets[count] <= limit;
+    };
+    auto sectionSize = [&header](Section index) { return header.sections[index + 1] - header.sections[index]; };
+    if (!ascending(terms.offsets, terms.size, sectionSize(TERM_BLOB))
+        || !ascending(documents.offsets, documents.size, sectionSize(DOCUMENT_BLOB))
+        || !ascending(paragraphs.offsets, paragraphs.size, sectionSize(PARAGRAPH_BLOB))
+        || !ascending(tombstones.offsets, tombstones.size, sectionSize(TOMBSTONE_BLOB))
+        || !ascending(postingOffsets, termCount, sectionSize(POSTINGS))
+        || !ascending(paragraphStarts, documentCount, header.paragraphCount)) {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief Gets the path of the segment file.
+ *
+ * @return The file path.
+ */
+const std::string& Segment::getFile() const
+{
+    return file;
+}
+
+/**
+ * @brief Gets the size of the mapped file.
+ *
+ * @return The size in bytes.
+ */
+std::size_t Segment::getMappedSize() const
+{
+    return size;
+}
+
+/**
+ * @brief Gets the number of distinct terms in the segment.
+ *
+ * @return The term count; terms are numbered 0 to count - 1 in alphabetical order.
+ */
+int Segment::getTermCount() const
+{
+    return static_cast<int>(terms.size);
+}
+
+/**
+ * @brief Gets the spelling of a term.
+ *
+ * @param term The term number.
+ * @return A view into the mapped file.
+ */
+std::string_view Segment::getTerm(int term) const
+{
+    return terms.get(term);
+}
+
+/**
+ * @brief Looks up a term by binary search.
+ *
+ * @param term The lowercase term.
+ * @return The term number, or -1 if the segment does not contain the term.
+ */
+int Segment::findTerm(std::string_view term) const
+{
+    int index = terms.lowerBound(term);
+    return index < getTermCount() && terms.get(index) == term ? index : -1;
+}
+
+/**
+ * @brief Finds the first term that is not smaller than a prefix.
+ *
+ * The terms starting with the prefix follow from there on.
+ *
+ * @param prefix The prefix.
+ * @return The term number, or getTermCount() if every term is smaller.
+ */
+int Segment::findPrefix(std::string_view prefix) const
+{
+    return terms.lowerBound(prefix);
+}
+
+/**
+ * @brief Gets the number of occurrences of a term in all documents of the segment.
+ *
+ * @param term The term number.
+ * @return The occurrence count.
+ */
+int Segment::getCount(int term) const
+{
+    return static_cast<int>(termCounts[term]);
+}
+
+/**
+ * @brief Gets the number of documents of the segment that contain a term.
+ *
+ * @param term The term number.
+ * @return The document frequency.
+ */
+int Segment::getDocumentFrequency(int term) const
+{
+    return static_cast<int>(documentFrequencies[term]);
+}
+
+/**
+ * @brief Decodes the posting list of a term.
+ *
+ * Every posting must decode within the list and refer to an existing document and paragraph.
+ * The check is made on every call rather than remembered per term: it costs a comparison per
+ * posting next to the decoding itself, and keeps the segment free of state shared by threads.
+ *
+ * @param term The term number.
+ * @param decoded Receives the postings; document numbers are local to this segment.
+ * @return False (after printing an error) if the list is corrupt; nothing is appended then.
+ */
+bool Segment::decodePostings(int term, std::vector<InvertedIndex::Posting>& decoded) const
+{
+    std::size_t start = decoded.size();
+    bool valid = InvertedIndex::decodePostings(postings + postingOffsets[term],
+                                               postingOffsets[term + 1] - postingOffsets[term], -1, decoded);
+    for (std::size_t i = start; valid && i < decoded.size(); i++) {
+        const InvertedIndex::Posting& posting = decoded[i];
+        valid = posting.document >= 0 && posting.document < getDocumentCount()
+                && posting.paragraph >= 0 && posting.paragraph < getParagraphCount(posting.document);
+    }
+    if (!valid) {
+        decoded.resize(start);
+        std::cerr << "Error: " << file << " has a corrupt posting list for \"" << getTerm(term) << "\"" << std::endl;
+    }
+    return valid;
+}
+
+/**
+ * @brief Gets the number of documents stored in the segment.
+ *
+ * @return The document count; documents are numbered in path order.
+ */
+int Segment::getDocumentCount() const
+{
+    return static_cast<int>(documents.size);
+}
+
+/**
+ * @brief Gets the path of a document.
+ *
+ * @param document The document number.
+ * @return A view into the mapped file.
+ */
+std::string_view Segment::getDocumentPath(int document) const
+{
+    return documents.get(document);
+}
+
+/**
+ * @brief Looks up a document by its path.
+ *
+ * @param path The document path.
+ * @return The document number, or -1 if the segment does not contain the document.
+ */
+int Segment::findDocument(std::string_view path) const
+{
+    int index = documents.lowerBound(path);
+    return index < getDocumentCount() && documents.get(index) == path ? index : -1;
+}
+
+/**
+ * @brief Gets the number of paragraphs of a document.
+ *
+ * @param document The document number.
+ * @return The paragraph count.
+ */
+int Segment::getParagraphCount(int document) const
+{
+    return static_cast<int>(paragraphStarts[document + 1] - paragraphStarts[document]);
+}
+
+/**
+ * @brief Gets the text of a paragraph.
+ *
+ * @param document The document number.
+ * @param paragraph The paragraph number within the document.
+ * @return A view into the mapped file.
+ */
+std::string_view Segment::getParagraph(int document, int paragraph) const
+{
+    return paragraphs.get(paragraphStarts[document] + paragraph);
+}
+
+/**
+ * @brief Gets the number of documents this segment deletes from older segments.
+ *
+ * @return The tombstone count.
+ */
+int Segment::getTombstoneCount() const
+{
+    return static_cast<int>(tombstones.size);
+}
+
+/**
+ * @brief Gets the path of a deleted document.
+ *
+ * @param index The tombstone number.
+ * @return A view into the mapped file.
+ */
+std::string_view Segment::getTombstone(int index) const
+{
+    return tombstones.get(index);
+}
+
+/**
+ * @brief Checks whether this segment deletes a document of older segments.
+ *
+ * @param path The document path.
+ * @return True if the segment has a tombstone for the path.
+ */
+bool Segment::hasTombstone(std::string_view path) const
+{
+    int index = tombstones.lowerBound(path);
+    return index < getTombstoneCount() && tombstones.get(index) == path;
+}
+
+std::string_view Segment::StringTable::get(std::uint32_t index) const
+{
+    return std::string_view(blob + offsets[index], offsets[index + 1] - offsets[index]);
+}
+
+int Segment::StringTable::lowerBound(std::string_view value) const
+{
+    std::uint32_t low = 0;
+    std::uint32_t high = size;
+    while (low < high) {
+        std::uint32_t middle = low + (high - low) / 2;
+        if (get(middle) < value) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return static_cast<int>(low);
+}
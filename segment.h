@@ -0,0 +1,131 @@
+#ifndef SEGMENT_H
+#define SEGMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "invertedindex.h"
+#include "textspill.h"
+
+/**
+ * @brief The contents of a segment before it is written to disk.
+ *
+ * Every document lists, for each of its terms, the paragraph number of every occurrence in
+ * ascending order. The text of its paragraphs is kept in paragraphTexts. Tombstones name
+ * documents of older segments that have been deleted.
+ */
+struct SegmentData {
+    struct Document {
+        std::string path;
+        std::vector<TextSpill::Range> paragraphs;
+        std::map<std::string, std::vector<int>> terms;
+    };
+
+    std::vector<Document> documents;
+    std::vector<std::string> tombstones;
+    const TextSpill* paragraphTexts = nullptr; // holds the paragraphs of all documents; may be null without paragraphs
+};
+
+bool writeSegment(const std::string& file, SegmentData data);
+
+/**
+ * @brief Writes a segment file entry by entry, keeping only a bounded part of it in memory.
+ */
+class SegmentWriter {
+public:
+    explicit SegmentWriter(const std::string& file);
+
+    SegmentWriter(const SegmentWriter&) = delete;
+    SegmentWriter& operator=(const SegmentWriter&) = delete;
+
+    void addTerm(std::string_view term, std::string_view postings, std::uint32_t count,
+                 std::uint32_t documentFrequency);
+    void addDocument(std::string_view path);
+    void addParagraph(std::string_view text);
+    void addTombstone(std::string_view path);
+    bool finish();
+
+private:
+    struct SectionBuffer {
+        std::string pending;              // the most recent bytes of the section
+        std::unique_ptr<TextSpill> spill; // the bytes before them, once the section has grown large
+        std::uint64_t size = 0;
+    };
+
+    void append(int section, const void* bytes, std::size_t size);
+    template <typename T>
+    void appendValue(int section, T value);
+
+    std::string file;
+    std::vector<SectionBuffer> sections;
+    std::uint32_t termCount;
+    std::uint32_t documentCount;
+    std::uint32_t paragraphCount;
+    std::uint32_t tombstoneCount;
+};
+
+class Segment {
+public:
+    static std::shared_ptr<Segment> open(const std::string& file);
+    ~Segment();
+
+    Segment(const Segment&) = delete;
+    Segment& operator=(const Segment&) = delete;
+
+    const std::string& getFile() const;
+    std::size_t getMappedSize() const;
+
+    int getTermCount() const;
+    std::string_view getTerm(int term) const;
+    int findTerm(std::string_view term) const;
+    int findPrefix(std::string_view prefix) const;
+    int getCount(int term) const;
+    int getDocumentFrequency(int term) const;
+    bool decodePostings(int term, std::vector<InvertedIndex::Posting>& decoded) const;
+
+    int getDocumentCount() const;
+    std::string_view getDocumentPath(int document) const;
+    int findDocument(std::string_view path) const;
+    int getParagraphCount(int document) const;
+    std::string_view getParagraph(int document, int paragraph) const;
+
+    int getTombstoneCount() const;
+    std::string_view getTombstone(int index) const;
+    bool hasTombstone(std::string_view path) const;
+
+private:
+    struct StringTable {
+        const std::uint64_t* offsets = nullptr;
+        const char* blob = nullptr;
+        std::uint32_t size = 0;
+
+        std::string_view get(std::uint32_t index) const;
+        int lowerBound(std::string_view value) const;
+    };
+
+    Segment() = default;
+    bool load();
+
+    std::string file;
+    const char* data = nullptr;
+    std::size_t size = 0;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+
+    StringTable terms;
+    const std::uint32_t* termCounts = nullptr;
+    const std::uint32_t* documentFrequencies = nullptr;
+    const std::uint64_t* postingOffsets = nullptr;
+    const char* postings = nullptr;
+    StringTable documents;
+    const std::uint32_t* paragraphStarts = nullptr;
+    StringTable paragraphs;
+    StringTable tombstones;
+};
+
+#endif // SEGMENT_H
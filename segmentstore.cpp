@@ -0,0 +1,644 @@
+#include "segmentstore.h"
+#include "keywordcontext.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <set>
+#include <string_view>
+
+/// Number of segments of one size tier that are merged into one segment of the next tier
+const std::size_t MERGE_FACTOR = 4;
+
+/// Size up to which segments belong to the lowest tier
+const std::uint64_t TIER_BASE_SIZE = 256 * 1024;
+
+/// Number of segments above which the newest ones are merged even if their tiers differ
+const std::size_t MAX_SEGMENT_COUNT = 16;
+
+/// Name of the file listing the segments of the store, oldest first
+const char* const MANIFEST_NAME = "MANIFEST";
+
+namespace {
+
+/**
+ * @brief Visits the strings of several sorted string lists in ascending order.
+ *
+ * @param sizes The length of every list.
+ * @param get Returns string j of list i as get(i, j); the view must stay valid.
+ * @param visit Called as visit(string, matches) once per distinct string, where matches lists the
+ *              (list, index) pairs that hold it in ascending list order.
+ */
+template <typename Get, typename Visit>
+void mergeSortedLists(const std::vector<int>& sizes, const Get& get, const Visit& visit)
+{
+    using Cursor = std::pair<std::string_view, std::size_t>; // current string, list
+    std::priority_queue<Cursor, std::vector<Cursor>, std::greater<Cursor>> heap;
+    std::vector<int> position(sizes.size(), 0);
+    for (std::size_t list = 0; list < sizes.size(); list++) {
+        if (sizes[list] > 0) {
+            heap.push({get(list, 0), list});
+        }
+    }
+
+    std::vector<std::pair<std::size_t, int>> matches;
+    while (!heap.empty()) {
+        std::string_view value = heap.top().first;
+        matches.clear();
+        while (!heap.empty() && heap.top().first == value) {
+            std::size_t list = heap.top().second;
+            heap.pop();
+            matches.emplace_back(list, position[list]);
+            if (++position[list] < sizes[list]) {
+                heap.push({get(list, position[list]), list});
+            }
+        }
+        visit(value, matches);
+    }
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Opens the persistent index stored in a directory.
+ *
+ * The index is a log-structured set of immutable segment files. Every batch of changed pages
+ * is written as a new segment in which a page replaces the page with the same path in older
+ * segments, and deleted pages are recorded as tombstones. A MANIFEST file lists the segments
+ * that make up the index; it is replaced atomically, so the index stays consistent if the
+ * application stops at any point. A background thread merges runs of segments of similar size
+ * into larger segments that only contain the live pages (see selectMerge()).
+ *
+ * Segment and temporary files that are not listed in the manifest are left-overs of an
+ * interrupted write or merge and are deleted.
+ *
+ * @param directory An existing directory that holds the index files.
+ */
+SegmentStore::SegmentStore(const std::string& directory)
+    : directory(directory), nextSequence(1), generation(0), mergeFailed(false), stopping(false)
+{
+    std::vector<std::shared_ptr<Segment>> segments;
+    std::set<std::string> listed;
+    std::ifstream manifest(directory + "/" + MANIFEST_NAME);
+    std::string name;
+    while (std::getline(manifest, name)) {
+        if (name.empty()) {
+            continue;
+        }
+        listed.insert(name);
+        // Names are "segment-<sequence>.seg"
+        nextSequence = std::max<std::uint64_t>(nextSequence, std::strtoull(name.c_str() + 8, nullptr, 10) + 1);
+        if (std::shared_ptr<Segment> segment = Segment::open(directory + "/" + name)) {
+            segments.push_back(std::move(segment));
+        }
+    }
+
+    std::error_code error;
+    for (std::filesystem::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        std::string file = it->path().filename().string();
+        std::string extension = it->path().extension().string();
+        if ((extension == ".seg" || extension == ".tmp") && !listed.count(file)) {
+            std::filesystem::remove(it->path(), error);
+        }
+    }
+
+    current = makeSnapshot(std::move(segments));
+    mergeThread = std::thread(&SegmentStore::mergeLoop, this);
+}
+
+/**
+ * @brief Waits for a running merge to finish and closes the segments.
+ */
+SegmentStore::~SegmentStore()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    mergeRequested.notify_all();
+    mergeThread.join();
+}
+
+/**
+ * @brief Writes a batch of added, replaced and deleted pages as a new segment.
+ *
+ * @param data The pages to store and the paths of deleted pages.
+ * @return True on success (or if there is nothing to store), false if the segment could not be written.
+ */
+bool SegmentStore::addSegment(SegmentData data)
+{
+    if (data.documents.empty() && data.tombstones.empty()) {
+        return true;
+    }
+
+    std::string file;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        file = segmentFile(nextSequence++);
+    }
+    if (!writeSegment(file, std::move(data))) {
+        return false;
+    }
+    std::shared_ptr<Segment> segment = Segment::open(file);
+    if (!segment) {
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<std::shared_ptr<Segment>> segments = current->segments;
+        segments.push_back(std::move(segment));
+        install(std::move(segments));
+        mergeFailed = false;
+    }
+    mergeRequested.notify_all();
+    return true;
+}
+
+/**
+ * @brief Deletes every segment, e.g. before a folder is analysed from scratch.
+ */
+void SegmentStore::clear()
+{
+    std::vector<std::shared_ptr<Segment>> obsolete;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        generation++;
+        obsolete = current->segments;
+        install({});
+    }
+
+    // Readers that still hold a snapshot keep their mappings; the files are gone from the directory
+    std::error_code error;
+    for (const std::shared_ptr<Segment>& segment : obsolete) {
+        std::filesystem::remove(segment->getFile(), error);
+    }
+}
+
+/**
+ * @brief Checks whether the store contains no segments.
+ *
+ * @return True if nothing has been stored yet.
+ */
+bool SegmentStore::isEmpty() const
+{
+    return snapshot()->segments.empty();
+}
+
+/**
+ * @brief Counts the pages that are currently stored.
+ *
+ * @return The number of pages that have neither been replaced nor deleted.
+ */
+int SegmentStore::getPageCount() const
+{
+    std::shared_ptr<const Snapshot> view = snapshot();
+    int count = 0;
+    for (const std::vector<bool>& live : view->live) {
+        count += static_cast<int>(std::count(live.begin(), live.end(), true));
+    }
+    return count;
+}
+
+/**
+ * @brief Computes the per-word statistics of all stored pages.
+ *
+ * The counts of segments whose pages are all live are read directly from the segment;
+ * only segments with replaced or deleted pages have their posting lists decoded.
+ *
+ * @return A new column store with the counts and document frequencies of every word.
+ */
+std::shared_ptr<const WordColumns> SegmentStore::getColumns() const
+{
+    std::shared_ptr<const Snapshot> view = snapshot();
+    auto columns = std::make_shared<WordColumns>();
+    long long position = 0;
+    std::vector<InvertedIndex::Posting> postings;
+
+    for (std::size_t s = 0; s < view->segments.size(); s++) {
+        const Segment& segment = *view->segments[s];
+        const std::vector<bool>& live = view->live[s];
+        long long segmentStart = position;
+        for (int term = 0; term < segment.getTermCount(); term++) {
+            int count = 0;
+            int documents = 0;
+            if (view->complete[s]) {
+                count = segment.getCount(term);
+                documents = segment.getDocumentFrequency(term);
+            } else {
+                postings.clear();
+                segment.decodePostings(term, postings);
+                int lastDocument = -1;
+                for (const InvertedIndex::Posting& posting : postings) {
+                    if (!live[posting.document]) {
+                        continue;
+                    }
+                    count += posting.frequency;
+                    documents += posting.document != lastDocument;
+                    lastDocument = posting.document;
+                }
+            }
+            if (count > 0) {
+                columns->addOccurrences(columns->intern(segment.getTerm(term)), count, segmentStart, documents);
+                position += count;
+            }
+        }
+    }
+    return columns;
+}
+
+/**
+ * @brief Finds the paragraphs of all stored pages that match a keyword query.
+ *
+ * The query syntax is the one of InvertedIndex::search(). Every match contributes the sentence
+ * around it (see extractKeywordContexts()); windows that occur several times in the store are
+ * returned once.
+ *
+ * @param query The keyword query.
+ * @return The number of keyword occurrences and the distinct keyword-in-context windows.
+ */
+SegmentStore::QueryResult SegmentStore::query(const std::string& query) const
+{
+    std::shared_ptr<const Snapshot> view = snapshot();
+    std::vector<InvertedIndex::QueryTerm> terms = InvertedIndex::parseQuery(query);
+    ContextDeduplicator seen;
+    QueryResult result;
+
+    for (std::size_t s = 0; s < view->segments.size(); s++) {
+        const Segment& segment = *view->segments[s];
+        std::vector<InvertedIndex::Posting> matches = InvertedIndex::evaluateQuery(
+            query, [&segment](const std::string& term, bool prefix, std::vector<InvertedIndex::Posting>& postings) {
+                if (!prefix) {
+                    int id = segment.findTerm(term);
+                    if (id >= 0) {
+                        segment.decodePostings(id, postings);
+                    }
+                    return;
+                }
+                for (int id = segment.findPrefix(term);
+                     id < segment.getTermCount() && segment.getTerm(id).substr(0, term.size()) == term; id++) {
+                    segment.decodePostings(id, postings);
+                }
+            });
+
+        for (const InvertedIndex::Posting& match : matches) {
+            if (!view->live[s][match.document]) {
+                continue;
+            }
+            result.occurrences += match.frequency;
+            for (std::string& context : extractKeywordContexts(segment.getParagraph(match.document, match.paragraph), terms)) {
+                if (seen.insert(context)) {
+                    result.contexts.push_back(std::move(context));
+                }
+            }
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Gets the number of segments the index currently consists of.
+ *
+ * @return The segment count.
+ */
+std::size_t SegmentStore::getSegmentCount() const
+{
+    return snapshot()->segments.size();
+}
+
+/**
+ * @brief Gets the total size of the mapped segment files.
+ *
+ * @return The size in bytes.
+ */
+std::size_t SegmentStore::getMappedSize() const
+{
+    std::size_t size = 0;
+    for (const std::shared_ptr<Segment>& segment : snapshot()->segments) {
+        size += segment->getMappedSize();
+    }
+    return size;
+}
+
+/**
+ * @brief Determines which documents of each segment are live.
+ *
+ * A document is shadowed by a document with the same path or a tombstone in any newer segment.
+ *
+ * @param segments The segments, oldest first.
+ * @return The new snapshot.
+ */
+std::shared_ptr<const SegmentStore::Snapshot> SegmentStore::makeSnapshot(std::vector<std::shared_ptr<Segment>> segments)
+{
+    auto view = std::make_shared<Snapshot>();
+    view->live.resize(segments.size());
+    view->complete.resize(segments.size());
+
+    std::set<std::string_view> newer; // paths stored or deleted by the segments visited so far
+    for (std::size_t s = segments.size(); s-- > 0;) {
+        const Segment& segment = *segments[s];
+        std::vector<bool>& live = view->live[s];
+        live.resize(segment.getDocumentCount());
+        bool complete = true;
+        for (int document = 0; document < segment.getDocumentCount(); document++) {
+            live[document] = !newer.count(segment.getDocumentPath(document));
+            complete = complete && live[document];
+        }
+        view->complete[s] = complete;
+
+        for (int document = 0; document < segment.getDocumentCount(); document++) {
+            newer.insert(segment.getDocumentPath(document));
+        }
+        for (int i = 0; i < segment.getTombstoneCount(); i++) {
+            newer.insert(segment.getTombstone(i));
+        }
+    }
+    view->segments = std::move(segments);
+    return view;
+}
+
+/**
+ * @brief Chooses the segments to merge next.
+ *
+ * Segments are assigned to size tiers, each holding segments MERGE_FACTOR times larger than the
+ * tier below. The newest run of MERGE_FACTOR consecutive segments of one tier is merged into a
+ * segment of the next tier, so every page is rewritten about once per tier rather than on
+ * every merge. Should the sizes not line up into such runs, the smallest run of MERGE_FACTOR
+ * consecutive segments is merged once there are more than MAX_SEGMENT_COUNT. A segment in
+ * which most documents have been replaced or deleted is rewritten on its own. Only consecutive
+ * segments are merged, so the merged segment can take their place in the order of the snapshot.
+ *
+ * @param snapshot The current segments.
+ * @return The range [first, last) of segments to merge; empty if no merge is needed.
+ */
+std::pair<std::size_t, std::size_t> SegmentStore::selectMerge(const Snapshot& snapshot)
+{
+    const std::vector<std::shared_ptr<Segment>>& segments = snapshot.segments;
+    auto tier = [&segments](std::size_t s) {
+        int level = 0;
+        for (std::uint64_t limit = TIER_BASE_SIZE; segments[s]->getMappedSize() > limit && level < 32;
+             limit *= MERGE_FACTOR) {
+            level++;
+        }
+        return level;
+    };
+
+    std::size_t runEnd = segments.size();
+    for (std::size_t s = segments.size(); s-- > 0;) {
+        if (s + 1 < runEnd && tier(s) != tier(s + 1)) {
+            runEnd = s + 1;
+        }
+        if (runEnd - s == MERGE_FACTOR) {
+            return {s, runEnd};
+        }
+    }
+    if (segments.size() > MAX_SEGMENT_COUNT) {
+        // The run of MERGE_FACTOR segments that is cheapest to rewrite
+        std::size_t best = 0;
+        std::uint64_t bestSize = 0;
+        for (std::size_t s = 0; s + MERGE_FACTOR <= segments.size(); s++) {
+            std::uint64_t size = 0;
+            for (std::size_t i = s; i < s + MERGE_FACTOR; i++) {
+                size += segments[i]->getMappedSize();
+            }
+            if (s == 0 || size < bestSize) {
+                best = s;
+                bestSize = size;
+            }
+        }
+        return {best, best + MERGE_FACTOR};
+    }
+    for (std::size_t s = 0; s < segments.size(); s++) {
+        std::size_t live = std::count(snapshot.live[s].begin(), snapshot.live[s].end(), true);
+        if (live * 2 < snapshot.live[s].size()) {
+            return {s, s + 1};
+        }
+    }
+    return {0, 0};
+}
+
+/**
+ * @brief Merges consecutive segments of a snapshot into one segment file.
+ *
+ * The segments are read in a k-way merge of their sorted document paths and term dictionaries
+ * and the result is streamed to a SegmentWriter, so only the postings of one term are held in
+ * memory. Documents that are not live in the snapshot are dropped. Tombstones are kept only for
+ * paths that are stored in a segment older than the range, which they still delete.
+ *
+ * @param file The path of the merged segment file.
+ * @param snapshot The snapshot the segments belong to.
+ * @param first The first segment to merge.
+ * @param last One past the last segment to merge.
+ * @return True on success, false if the file could not be written or a segment has a corrupt
+ *         posting list.
+ */
+bool SegmentStore::writeMergedSegment(const std::string& file, const Snapshot& snapshot, std::size_t first,
+                                      std::size_t last)
+{
+    std::vector<const Segment*> segments;
+    for (std::size_t s = first; s < last; s++) {
+        segments.push_back(snapshot.segments[s].get());
+    }
+    auto sizes = [&segments](int (Segment::*count)() const) {
+        std::vector<int> result;
+        for (const Segment* segment : segments) {
+            result.push_back((segment->*count)());
+        }
+        return result;
+    };
+    SegmentWriter writer(file);
+
+    // A path is live in at most one segment; documents are renumbered in path order
+    std::vector<std::vector<int>> merged(segments.size()); // new number of every live document, -1 if dropped
+    for (std::size_t i = 0; i < segments.size(); i++) {
+        merged[i].assign(segments[i]->getDocumentCount(), -1);
+    }
+    int documentCount = 0;
+    mergeSortedLists(
+        sizes(&Segment::getDocumentCount),
+        [&segments](std::size_t i, int document) { return segments[i]->getDocumentPath(document); },
+        [&](std::string_view path, const std::vector<std::pair<std::size_t, int>>& matches) {
+            for (const auto& match : matches) {
+                const Segment& segment = *segments[match.first];
+                if (!snapshot.live[first + match.first][match.second]) {
+                    continue;
+                }
+                merged[match.first][match.second] = documentCount++;
+                writer.addDocument(path);
+                for (int paragraph = 0; paragraph < segment.getParagraphCount(match.second); paragraph++) {
+                    writer.addParagraph(segment.getParagraph(match.second, paragraph));
+                }
+            }
+        });
+
+    std::vector<InvertedIndex::Posting> decoded;
+    std::vector<InvertedIndex::Posting> postings;
+    std::string encoded;
+    bool corrupt = false; // a posting list failed its check; the merged segment would lose it
+    mergeSortedLists(
+        sizes(&Segment::getTermCount), [&segments](std::size_t i, int term) { return segments[i]->getTerm(term); },
+        [&](std::string_view term, const std::vector<std::pair<std::size_t, int>>& matches) {
+            postings.clear();
+            for (const auto& match : matches) {
+                decoded.clear();
+                if (!segments[match.first]->decodePostings(match.second, decoded)) {
+                    corrupt = true;
+                }
+                for (InvertedIndex::Posting posting : decoded) {
+                    posting.document = merged[match.first][posting.document];
+                    if (posting.document >= 0) {
+                        postings.push_back(posting);
+                    }
+                }
+            }
+            if (postings.empty()) {
+                return;
+            }
+            // Renumbering keeps the order within a segment; documents of different segments interleave
+            if (matches.size() > 1) {
+                std::stable_sort(postings.begin(), postings.end(),
+                                 [](const InvertedIndex::Posting& a, const InvertedIndex::Posting& b) {
+                                     return a.document < b.document;
+                                 });
+            }
+            std::uint32_t count = 0;
+            std::uint32_t documentFrequency = 0;
+            for (std::size_t i = 0; i < postings.size(); i++) {
+                count += static_cast<std::uint32_t>(postings[i].frequency);
+                documentFrequency += i == 0 || postings[i].document != postings[i - 1].document;
+            }
+            InvertedIndex::encodePostings(postings, encoded);
+            writer.addTerm(term, encoded, count, documentFrequency);
+        });
+
+    mergeSortedLists(
+        sizes(&Segment::getTombstoneCount),
+        [&segments](std::size_t i, int index) { return segments[i]->getTombstone(index); },
+        [&](std::string_view path, const std::vector<std::pair<std::size_t, int>>&) {
+            for (std::size_t s = 0; s < first; s++) {
+                if (snapshot.segments[s]->findDocument(path) >= 0) {
+                    writer.addTombstone(path);
+                    return;
+                }
+            }
+        });
+
+    return !corrupt && writer.finish();
+}
+
+/**
+ * @brief Gets the current set of segments.
+ *
+ * The snapshot stays valid while a merge or clear() replaces the segments.
+ *
+ * @return The snapshot.
+ */
+std::shared_ptr<const SegmentStore::Snapshot> SegmentStore::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return current;
+}
+
+/**
+ * @brief Builds the path of a segment file.
+ *
+ * @param sequence The sequence number of the segment.
+ * @return The path inside the store directory.
+ */
+std::string SegmentStore::segmentFile(std::uint64_t sequence) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "segment-%06llu.seg", static_cast<unsigned long long>(sequence));
+    return directory + "/" + name;
+}
+
+/**
+ * @brief Makes a list of segments the current state and records it in the manifest.
+ *
+ * Must be called with the mutex held.
+ *
+ * @param segments The segments, oldest first.
+ */
+void SegmentStore::install(std::vector<std::shared_ptr<Segment>> segments)
+{
+    std::string manifest = directory + "/" + MANIFEST_NAME;
+    std::string temporary = manifest + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::trunc);
+        for (const std::shared_ptr<Segment>& segment : segments) {
+            out << std::filesystem::path(segment->getFile()).filename().string() << "\n";
+        }
+        if (!out) {
+            std::cerr << "Error: Unable to write " << temporary << std::endl;
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(temporary, manifest, error);
+    if (error) {
+        std::cerr << "Error: Unable to replace " << manifest << ": " << error.message() << std::endl;
+    }
+
+    current = makeSnapshot(std::move(segments));
+}
+
+/**
+ * @brief Body of the merge thread: merges the segments chosen by selectMerge() until none are left to merge.
+ *
+ * The merged segment is written without holding the lock, so pages can be added and queries
+ * answered meanwhile. Segments are only ever appended until clear() is called, so the merged
+ * range is still at the same position when the merge is installed.
+ */
+void SegmentStore::mergeLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    std::pair<std::size_t, std::size_t> range;
+    while (true) {
+        mergeRequested.wait(lock, [this, &range] {
+            if (stopping || mergeFailed) {
+                return stopping;
+            }
+            range = selectMerge(*current);
+            return range.first < range.second;
+        });
+        if (stopping) {
+            return;
+        }
+
+        std::shared_ptr<const Snapshot> base = current;
+        std::uint64_t baseGeneration = generation;
+        std::string file = segmentFile(nextSequence++);
+        lock.unlock();
+
+        std::shared_ptr<Segment> merged;
+        if (writeMergedSegment(file, *base, range.first, range.second)) {
+            merged = Segment::open(file);
+        }
+
+        lock.lock();
+        std::error_code error;
+        if (!merged || generation != baseGeneration) {
+            mergeFailed = !merged;
+            merged.reset();
+            std::filesystem::remove(file, error);
+            continue;
+        }
+
+        std::vector<std::shared_ptr<Segment>> segments(current->segments.begin(),
+                                                       current->segments.begin() + range.first);
+        if (merged->getDocumentCount() > 0 || merged->getTombstoneCount() > 0) {
+            segments.push_back(merged);
+        } else {
+            std::filesystem::remove(file, error);
+        }
+        segments.insert(segments.end(), current->segments.begin() + range.second, current->segments.end());
+        install(std::move(segments));
+        for (std::size_t s = range.first; s < range.second; s++) {
+            std::filesystem::remove(base->segments[s]->getFile(), error);
+        }
+    }
+}
@@ -0,0 +1,67 @@
+#ifndef SEGMENTSTORE_H
+#define SEGMENTSTORE_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "segment.h"
+#include "wordcolumns.h"
+
+class SegmentStore {
+public:
+    struct QueryResult {
+        int occurrences = 0;
+        std::vector<std::string> contexts;
+    };
+
+    explicit SegmentStore(const std::string& directory);
+    ~SegmentStore();
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    bool addSegment(SegmentData data);
+    void clear();
+
+    bool isEmpty() const;
+    int getPageCount() const;
+    std::shared_ptr<const WordColumns> getColumns() const;
+    QueryResult query(const std::string& query) const;
+    std::size_t getSegmentCount() const;
+    std::size_t getMappedSize() const;
+
+private:
+    struct Snapshot {
+        std::vector<std::shared_ptr<Segment>> segments; // oldest first
+        std::vector<std::vector<bool>> live;            // live[segment][document]: not replaced or deleted by a newer segment
+        std::vector<bool> complete;                     // every document of the segment is live
+    };
+
+    static std::shared_ptr<const Snapshot> makeSnapshot(std::vector<std::shared_ptr<Segment>> segments);
+    static std::pair<std::size_t, std::size_t> selectMerge(const Snapshot& snapshot);
+    static bool writeMergedSegment(const std::string& file, const Snapshot& snapshot, std::size_t first,
+                                   std::size_t last);
+    std::shared_ptr<const Snapshot> snapshot() const;
+    std::string segmentFile(std::uint64_t sequence) const;
+    void install(std::vector<std::shared_ptr<Segment>> segments);
+    void mergeLoop();
+
+    std::string directory;
+
+    mutable std::mutex mutex;
+    std::condition_variable mergeRequested;
+    std::shared_ptr<const Snapshot> current;
+    std::uint64_t nextSequence;
+    std::uint64_t generation; // incremented by clear() so that a running merge is discarded
+    bool mergeFailed;         // no retry until the next segment is added
+    bool stopping;
+    std::thread mergeThread;
+};
+
+#endif // SEGMENTSTORE_H
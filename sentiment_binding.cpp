@@ -1,12 +1,20 @@
 #include <string>
 #include <QString>
 #include <QCoreApplication>
+#include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QStandardPaths>
 #include <vector>
 #include <map>
 #include <iostream>
-#include <sstream>
-#include <algorithm>
+#include <string_view>
+#include <cctype>
 #include "fasttext.h"
+#include "predictioncache.h"
+
+/// Maximum number of predictions kept in the cache of the sentiment analyzer
+const std::size_t PREDICTION_CACHE_CAPACITY = 1 << 18;
 
 /**
  * @author Rawad Alharastani
@@ -19,8 +27,10 @@ public:
     /**
      * @brief Constructor that loads a FastText model from the specified path.
      * @param modelPath Path to the FastText model file.
+     * @param cachePath File in which predictions are kept between runs; empty to keep them in memory only.
      */
-    SentimentAnalyzer(const std::string& modelPath) {
+    SentimentAnalyzer(const std::string& modelPath, const std::string& cachePath = "")
+        : cache_(PREDICTION_CACHE_CAPACITY), cachePath_(cachePath) {
         model_ = std::make_unique<fasttext::FastText>();
         try {
             model_->loadModel(modelPath);
@@ -30,52 +40,47 @@ public:
         } catch (const std::exception& e) {
             std::cerr << "Failed to load model: " << e.what() << std::endl; // debug code
         }
+
+        // A retrained model replaces the file, which changes its size or modification time
+        QFileInfo modelInfo(QString::fromStdString(modelPath));
+        modelFingerprint_ = static_cast<uint64_t>(modelInfo.size()) * 0x9e3779b97f4a7c15ULL
+                            ^ static_cast<uint64_t>(modelInfo.lastModified().toMSecsSinceEpoch());
+        if (!cachePath_.empty()) {
+            cache_.load(cachePath_, modelFingerprint_);
+        }
+    }
+
+    /**
+     * @brief Destructor that saves the cached predictions for the next run.
+     */
+    ~SentimentAnalyzer() {
+        if (!cachePath_.empty()) {
+            cache_.save(cachePath_, modelFingerprint_);
+        }
     }
 
     /**
      * @brief Analyzes the sentiment of a list of tweets containing a specific keyword.
      * @param keyword Keyword to filter tweets.
      * @param tweets A vector of tweet strings to analyze.
-     * @return A map containing percentages of positive, negative, and neutral sentiments, and total tweets analyzed.
+     * @param weights Number of tweets each entry of tweets stands for; empty if every entry counts once.
+     * @return A map containing percentages and counts of positive, negative, and neutral sentiments, and total tweets analyzed.
      */
-    std::map<std::string, double> analyze_tweets(const std::string& keyword, const std::vector<std::string>& tweets) {
+    std::map<std::string, double> analyze_tweets(const std::string& keyword, const std::vector<std::string>& tweets,
+                                                 const std::vector<int>& weights = {}) {
         int positive = 0, negative = 0, neutral = 0;
-        for (const auto& tweet : tweets) {
-            std::string clean_tweet = tweet;
-            clean_tweet.erase(std::remove_if(clean_tweet.begin(), clean_tweet.end(), [](char c) {
-                                  return c == '@';
-                              }), clean_tweet.end());
-            std::string normalized_tweet;
-            std::transform(clean_tweet.begin(), clean_tweet.end(), clean_tweet.begin(), ::tolower);
-            bool last_space = true;
-            for (char c : clean_tweet) {
-                if (std::isspace(c)) {
-                    if (!last_space) {
-                        normalized_tweet += ' ';
-                        last_space = true;
-                    }
-                } else {
-                    normalized_tweet += c;
-                    last_space = false;
-                }
-            }
+        // Reused for every tweet, so that normalizing a tweet does not allocate once the buffers have grown
+        thread_local std::string normalized_tweet;
+        thread_local std::vector<std::pair<size_t, size_t>> words;
+        thread_local std::vector<int32_t> word_hashes;
+        thread_local std::vector<int32_t> features;
+        thread_local std::vector<int32_t> ngram_hashes;
+        for (size_t i = 0; i < tweets.size(); i++) {
+            const std::string& tweet = tweets[i];
+            int weight = i < weights.size() ? weights[i] : 1;
+            normalize_tweet(tweet, normalized_tweet, words, word_hashes);
             if (normalized_tweet.find(keyword) != std::string::npos || keyword.empty()) {
-                std::vector<std::string> words;
-                std::istringstream iss(normalized_tweet);
-                std::string word;
-                while (iss >> word) {
-                    words.push_back(word);
-                }
-                std::vector<int32_t> word_indices;
-                for (const auto& w : words) {
-                    int32_t word_id = model_->getWordId(w);
-                    std::cout << "Word: " << w << ", Word ID: " << word_id << std::endl; // debug code
-                    if (word_id >= 0) {
-                        word_indices.push_back(word_id);
-                    }
-                }
-                if (word_indices.empty()) {
-                    std::cerr << "Warning: No valid word indices for text: " << normalized_tweet << std::endl; // debug code
+                if (words.empty()) {
                     continue;
                 }
 
@@ -84,13 +89,18 @@ public:
                 fasttext::real threshold = 0.0;
                 std::string label;
                 try {
-                    std::cout << "Predicting on text: " << normalized_tweet << std::endl; // debug code
-                    std::cout << "Number of word indices: " << word_indices.size() << std::endl; // debug code
-                    model_->predict(k, word_indices, predictions, threshold);
-                    if (!predictions.empty()) {
-                        int32_t label_idx = predictions[0].second;
-                        fasttext::real confidence = predictions[0].first;
-                        std::cout << "Debug: Raw label index = " << label_idx << ", Confidence = " << confidence << std::endl; // debug code
+                    // Repeated texts are answered from the cache before any features are built
+                    int32_t label_idx = -1;
+                    uint64_t cache_key = PredictionCache::hashTokens(word_hashes);
+                    if (!cache_.lookup(cache_key, label_idx)) {
+                        build_features(normalized_tweet, words, word_hashes, features, ngram_hashes);
+                        model_->predict(k, features, predictions, threshold);
+                        if (!predictions.empty()) {
+                            label_idx = predictions[0].second;
+                        }
+                        cache_.insert(cache_key, label_idx);
+                    }
+                    if (label_idx != -1) {
                         if (label_idx >= 0 && label_idx < model_->getDictionary()->nlabels()) {
                             label = model_->getDictionary()->getLabel(label_idx);
                             if (label.find("__label__") == 0) {
@@ -100,20 +110,18 @@ public:
                             std::cerr << "Label index out of range: " << label_idx << ", expected [0, " << model_->getDictionary()->nlabels() << ")" << std::endl; // debug code
                             label = "neutral";
                         }
-                        std::cout << "Debug: Predicted label = " << label << std::endl; // debug code
-                        if (label == "positive") positive++;
-                        else if (label == "negative") negative++;
-                        else if (label == "neutral") neutral++;
-                        else neutral++;
+                        if (label == "positive") positive += weight;
+                        else if (label == "negative") negative += weight;
+                        else if (label == "neutral") neutral += weight;
+                        else neutral += weight;
                     } else {
                         label = "neutral";
-                        neutral++;
+                        neutral += weight;
                     }
-                    std::cout << "Text: " << normalized_tweet << " | Predicted: " << label << std::endl; // debug code
                 } catch (const std::exception& e) {
                     std::cerr << "Prediction error: " << e.what() << std::endl; // debug code
                     label = "neutral";
-                    neutral++;
+                    neutral += weight;
                 }
             }
         }
@@ -122,12 +130,102 @@ public:
         double pos_percent = total > 0 ? (positive / (double)total) * 100 : 0;
         double neg_percent = total > 0 ? (negative / (double)total) * 100 : 0;
         double neu_percent = total > 0 ? (neutral / (double)total) * 100 : 0;
-        return {{"positive_percent", pos_percent}, {"negative_percent", neg_percent}, {"neutral_percent", neu_percent}, {"total_tweets_analyzed", static_cast<double>(total)}};
+        return {{"positive_percent", pos_percent}, {"negative_percent", neg_percent}, {"neutral_percent", neu_percent},
+                {"positive_count", static_cast<double>(positive)}, {"negative_count", static_cast<double>(negative)},
+                {"neutral_count", static_cast<double>(neutral)}, {"total_tweets_analyzed", static_cast<double>(total)},
+                {"cache_hit_rate", cache_.getHitRate()}};
     }
 
 private:
+    /**
+     * @brief Normalizes a tweet and splits it into words in a single pass.
+     *
+     * '@' characters are dropped, letters are lowercased and whitespace runs become single spaces.
+     * Every word is hashed with FNV-1a while it is written, exactly like Dictionary::hash(), so the
+     * dictionary can look it up later from the hash and a view of the buffer.
+     *
+     * @param tweet The tweet text.
+     * @param normalized Receives the normalized text; its capacity is reused.
+     * @param words Receives the offset and length of every word in normalized; its capacity is reused.
+     * @param word_hashes Receives the hash of every word; its capacity is reused.
+     */
+    static void normalize_tweet(const std::string& tweet, std::string& normalized,
+                                std::vector<std::pair<size_t, size_t>>& words, std::vector<int32_t>& word_hashes) {
+        normalized.clear();
+        words.clear();
+        word_hashes.clear();
+
+        size_t word_start = 0;
+        uint32_t word_hash = 2166136261;
+        bool last_space = true;
+        auto end_word = [&]() {
+            words.emplace_back(word_start, normalized.size() - word_start);
+            word_hashes.push_back(static_cast<int32_t>(word_hash));
+        };
+        for (char c : tweet) {
+            if (c == '@') {
+                continue;
+            }
+            if (std::isspace(static_cast<unsigned char>(c))) {
+                if (!last_space) {
+                    end_word();
+                    normalized += ' ';
+                    last_space = true;
+                }
+                continue;
+            }
+            if (last_space) {
+                word_start = normalized.size();
+                word_hash = 2166136261;
+                last_space = false;
+            }
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+            normalized += c;
+            word_hash = (word_hash ^ uint32_t(int8_t(c))) * 16777619;
+        }
+        if (!last_space) {
+            end_word();
+        }
+    }
+
+    /**
+     * @brief Builds the input features of a normalized tweet the same way fastText does during training.
+     *
+     * Every word contributes its own id (if it is in the vocabulary) and its character n-gram buckets,
+     * which the dictionary precomputes for vocabulary words and hashes in place for unknown words; the
+     * line then gets the end-of-sentence token and the word n-gram buckets. Without these, unknown
+     * words were dropped and a model trained with subwords or word n-grams saw different input.
+     *
+     * @param normalized The normalized text.
+     * @param words The offset and length of every word in normalized.
+     * @param word_hashes The hash of every word.
+     * @param features Receives the feature ids; its capacity is reused.
+     * @param ngram_hashes Scratch buffer for the hashes of the word n-grams; its capacity is reused.
+     */
+    void build_features(const std::string& normalized, const std::vector<std::pair<size_t, size_t>>& words,
+                        const std::vector<int32_t>& word_hashes, std::vector<int32_t>& features,
+                        std::vector<int32_t>& ngram_hashes) const {
+        const fasttext::Dictionary& dictionary = *model_->getDictionary();
+        features.clear();
+        ngram_hashes.clear();
+        for (size_t i = 0; i < words.size(); i++) {
+            std::string_view word(normalized.data() + words[i].first, words[i].second);
+            dictionary.addToken(features, ngram_hashes, word, static_cast<uint32_t>(word_hashes[i]));
+        }
+        dictionary.endLine(features, ngram_hashes);
+    }
+
     /// Pointer to the FastText model instance.
     std::unique_ptr<fasttext::FastText> model_;
+
+    /// Predicted labels of recently seen token sequences.
+    PredictionCache cache_;
+
+    /// File the cache is kept in between runs; empty if the cache is not persisted.
+    std::string cachePath_;
+
+    /// Identifies the loaded model, so that predictions of another model are not reused.
+    uint64_t modelFingerprint_ = 0;
 };
 
 /**
@@ -138,9 +236,12 @@ private:
  *
  * @param keyword Keyword to filter tweets.
  * @param tweets A vector of tweet strings.
+ * @param weights Number of tweets each entry of tweets stands for, e.g. the size of a cluster of
+ *                near-duplicates; empty if every entry counts once.
  * @return A map containing sentiment analysis results.
  */
-std::map<std::string, double> analyze_tweets_wrapper(const std::string& keyword, const std::vector<std::string>& tweets) {
+std::map<std::string, double> analyze_weighted_tweets_wrapper(const std::string& keyword, const std::vector<std::string>& tweets,
+                                                              const std::vector<int>& weights) {
     // Get the working directory from which the app was launched
     QString appDirPath = QCoreApplication::applicationDirPath();
 
@@ -156,6 +257,21 @@ std::map<std::string, double> analyze_tweets_wrapper(const std::string& keyword,
         return {};
     }
 
-    static SentimentAnalyzer analyzer("/Users/elizabethd/Downloads/cs3307group41-mediaminercode-c2477d7bc7d9/model/model.bin");
-    return analyzer.analyze_tweets(keyword, tweets);
+    // Predictions are kept next to the saved indexes, so repeated texts are not predicted again in the next run
+    QString cacheDir = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(cacheDir);
+    static SentimentAnalyzer analyzer("/Users/elizabethd/Downloads/cs3307group41-mediaminercode-c2477d7bc7d9/model/model.bin",
+                                      (cacheDir + "/predictions.cache").toStdString());
+    return analyzer.analyze_tweets(keyword, tweets, weights);
+}
+
+/**
+ * @brief Wrapper function for sentiment analysis of tweets that all count once.
+ *
+ * @param keyword Keyword to filter tweets.
+ * @param tweets A vector of tweet strings.
+ * @return A map containing sentiment analysis results.
+ */
+std::map<std::string, double> analyze_tweets_wrapper(const std::string& keyword, const std::vector<std::string>& tweets) {
+    return analyze_weighted_tweets_wrapper(keyword, tweets, {});
 }
@@ -0,0 +1,364 @@
+#include "corpus.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+/**
+ * @date 2026-10-19
+ * @brief Checks that Corpus::addPage() hands the words of a page over without copying them, that
+ * keyword contexts are read back from the spilled paragraph texts, that the phrase counter
+ * reports exact counts, that near-duplicate clusters follow added and removed pages, and that
+ * segments with inconsistent headers are rejected on open and corrupt posting lists when decoded.
+ *
+ * The arena of the corpus counts every allocation it serves, so copying a word or its list of
+ * occurrences shows up as allocations that grow with the number of occurrences.
+ */
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const char* what)
+{
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+/// Serves a page from memory
+class StringSource : public ByteSource {
+public:
+    explicit StringSource(std::string data) : data(std::move(data)), position(0) {}
+
+    std::size_t read(char* buffer, std::size_t size) override
+    {
+        size = std::min(size, data.size() - position);
+        std::memcpy(buffer, data.data() + position, size);
+        position += size;
+        return size;
+    }
+
+private:
+    std::string data;
+    std::size_t position;
+};
+
+/**
+ * @brief Spells a number in letters, since words never contain digits.
+ */
+std::string letters(int number)
+{
+    std::string text = "w";
+    do {
+        text += static_cast<char>('a' + number % 26);
+        number /= 26;
+    } while (number > 0);
+    return text;
+}
+
+/**
+ * @brief Builds a page of the given words, each repeated in that many identical paragraphs.
+ */
+Page makePage(Corpus& corpus, int words, int repeats)
+{
+    std::string html;
+    for (int r = 0; r < repeats; r++) {
+        html += "<p>";
+        for (int w = 0; w < words; w++) {
+            html += letters(w) + " ";
+        }
+        html += "in one of the paragraphs of a page about apples</p>\n";
+    }
+    Page page("page", "page.html", "apples", corpus.getAllocator(), corpus.getParagraphSpill());
+    StringSource source(html);
+    page.readPage(source);
+    return page;
+}
+
+/**
+ * @brief Counts the arena allocations made while adding one page to an empty corpus.
+ */
+std::size_t countAddPageAllocations(int repeats)
+{
+    const std::unordered_set<std::string> stopwords;
+    Corpus corpus("apples", stopwords);
+    Page page = makePage(corpus, 50, repeats);
+    std::size_t before = corpus.getArena().getAllocationCount();
+    corpus.addPage("page.html", std::move(page));
+    return corpus.getArena().getAllocationCount() - before;
+}
+
+void testAllocationsDoNotGrowWithOccurrences()
+{
+    std::size_t once = countAddPageAllocations(1);
+    std::size_t often = countAddPageAllocations(40);
+    std::cout << "addPage arena allocations: " << once << " for 1 occurrence per word, " << often
+              << " for 40" << std::endl;
+    check(once == often, "addPage allocates per occurrence, so it copies contexts");
+}
+
+void testMergedWordsShareThePageRecords()
+{
+    const std::unordered_set<std::string> stopwords;
+    Corpus corpus("apples", stopwords);
+    Page first = makePage(corpus, 5, 3);
+    Page second = makePage(corpus, 5, 2);
+    const int* firstOccurrences = first.getWords().front().getOccurrences().data();
+    std::string wordText(first.getWords().front().getWord());
+    corpus.addPage("first.html", std::move(first));
+    corpus.addPage("second.html", std::move(second));
+
+    const WordSources& sources = corpus.getWords().find(wordText)->second;
+    check(sources.getWords().size() == 2, "merged word lists both pages");
+    check(sources.getCount() == 5, "merged word counts the occurrences of both pages");
+    check(sources.getWords().front()->getOccurrences().data() == firstOccurrences,
+          "merged word refers to the page's own occurrences");
+
+    Page third = makePage(corpus, 5, 4);
+    const int* thirdOccurrences = third.getWords().front().getOccurrences().data();
+    corpus.addPage("third.html", std::move(third));
+
+    // The last record takes the place of the removed first one, and must still be found later
+    corpus.removePage("first.html");
+    const WordSources& remaining = corpus.getWords().find(wordText)->second;
+    check(remaining.getWords().size() == 2 && remaining.getCount() == 6, "removed page leaves the merged word");
+    check(remaining.getWords().front()->getOccurrences().data() == thirdOccurrences,
+          "last record moves into the place of the removed one");
+    corpus.removePage("third.html");
+    check(remaining.getWords().size() == 1 && remaining.getCount() == 2, "moved record is removed from its new place");
+    corpus.removePage("second.html");
+    check(corpus.getWords().empty(), "removing every page empties the merged words");
+}
+
+void testKeywordContextsComeFromTheSpill()
+{
+    const std::unordered_set<std::string> stopwords;
+    Corpus corpus("apples", stopwords);
+    Page page("page", "page.html", "apples", corpus.getAllocator(), corpus.getParagraphSpill());
+    StringSource source("<p>Nothing   to see here.</p>\n<p>Green apples are sour. Pears are not.</p>\n"
+                        "<p>Ripe pears are sweet.</p>\n");
+    page.readPage(source);
+    corpus.addPage("page.html", std::move(page));
+    check(corpus.getParagraphSpill()->getSize() > 0, "paragraph texts are spilled");
+
+    const std::vector<std::string>& apples = corpus.getPageRelevantTexts("page.html");
+    check(apples.size() == 1 && apples.front().find("Green apples are sour.") != std::string::npos,
+          "keyword context is read from the spilled paragraph");
+
+    corpus.setKeyword("pears");
+    const std::vector<std::string>& pears = corpus.getPageRelevantTexts("page.html");
+    check(pears.size() == 2, "a new keyword finds the contexts of every spilled paragraph");
+    for (const std::string& context : pears) {
+        check(context.find("Nothing") == std::string::npos, "spilled paragraphs do not run together");
+    }
+
+    std::vector<std::string> occurrences = corpus.getOccurrenceContexts("are");
+    check(occurrences.size() == 3, "every occurrence of a word has a context");
+    check(occurrences.front() == "File: page | Context: Green apples are sour. Pears are not....",
+          "occurrence contexts are built from the spilled paragraph");
+    check(corpus.getOccurrenceContexts("see") == std::vector<std::string>{"File: page | Context: Nothing to see here...."},
+          "occurrence contexts have their whitespace collapsed");
+}
+
+void testPhraseCountsAreExact()
+{
+    // Four million phrases that occur once share the sketch's counters with twenty that occur
+    // 150 to 169 times, late in the input; only the latter are spelled out. Every occurrence is
+    // a document of its own, so the occurrences before tracking have to be counted again.
+    PhraseCounter counter;
+    std::unordered_map<std::string, std::vector<int>> frequentDocuments;
+    for (int i = 0; i < 4000000; i++) {
+        int frequent = i % 20000;
+        bool isFrequent = frequent < 20 && i / 20000 >= 50 - frequent;
+        std::string phrase = isFrequent ? "frequent " + letters(frequent) : letters(i);
+        std::uint64_t key = PhraseCounter::startKey(PhraseCounter::hashWord(isFrequent ? "frequent" + letters(frequent) : letters(i)));
+        if (isFrequent) {
+            frequentDocuments[phrase].push_back(i);
+        }
+        if (counter.add(key, 1)) {
+            counter.track(key, phrase, 1, i);
+        }
+    }
+
+    int recounted = 0;
+    std::shared_ptr<const WordColumns> top = counter.getTop(10, [&](const std::string& phrase, int beforeDocument) {
+        recounted++;
+        auto it = frequentDocuments.find(phrase);
+        if (it == frequentDocuments.end()) {
+            return 0;
+        }
+        return static_cast<int>(std::lower_bound(it->second.begin(), it->second.end(), beforeDocument) - it->second.begin());
+    });
+    check(top->size() == 10, "the ten most frequent phrases are reported");
+    for (int id = 0; id < top->size(); id++) {
+        check(top->getWord(id) == "frequent " + letters(19 - id), "phrases are ranked by their true count");
+        check(top->getCount(id) == 169 - id, "reported phrase counts are exact");
+    }
+    int firstRecount = recounted;
+    counter.getTop(10, [&](const std::string&, int) { return recounted++, 0; });
+    check(recounted == firstRecount, "completed counts are not recounted");
+}
+
+void testPagePhraseCountsFollowPages()
+{
+    const std::unordered_set<std::string> stopwords = {"the"};
+    Corpus corpus("apples", stopwords);
+    auto addPage = [&corpus](const std::string& path, const std::string& html) {
+        Page page("page", path, "apples", corpus.getAllocator(), corpus.getParagraphSpill());
+        StringSource source(html);
+        page.readPage(source);
+        corpus.addPage(path, std::move(page));
+    };
+    auto countOf = [&corpus](const std::string& phrase) {
+        std::shared_ptr<const WordColumns> top = corpus.getTopPhrases(10);
+        for (int id = 0; id < top->size(); id++) {
+            if (top->getWord(id) == phrase) {
+                return top->getCount(id);
+            }
+        }
+        return 0;
+    };
+
+    // The phrase is only tracked from the second page on, so the first is counted again later
+    addPage("first.html", "<p>Green apples and the red apples.</p>\n");
+    addPage("second.html", "<p>Green apples, green apples.</p>\n");
+    addPage("third.html", "<p>A basket of green apples.</p>\n");
+    check(countOf("green apples") == 4, "phrase count includes the pages added before it was tracked");
+    check(countOf("the red") == 0 && countOf("red apples") == 0, "phrases with stopwords or single occurrences are not reported");
+
+    corpus.removePage("first.html");
+    check(countOf("green apples") == 3, "removing a page removes its phrase occurrences");
+    addPage("second.html", "<p>Green apples.</p>\n");
+    check(countOf("green apples") == 2, "replacing a page replaces its phrase occurrences");
+}
+
+void testOnlyChangedPagesAreReclassified()
+{
+    const std::unordered_set<std::string> stopwords;
+    Corpus corpus("apples", stopwords);
+    auto addPage = [&corpus](const std::string& path, const std::string& html) {
+        Page page("page", path, "apples", corpus.getAllocator(), corpus.getParagraphSpill());
+        StringSource source(html);
+        page.readPage(source);
+        corpus.addPage(path, std::move(page));
+    };
+    const std::string syndicated = "<p>Local farmers say the apples harvested this autumn are the sweetest in a decade.</p>\n";
+    addPage("first.html", syndicated);
+    addPage("second.html", "<p>RT " + syndicated.substr(3));
+    check(corpus.takeUnclassifiedPages() == std::vector<std::string>{"first.html", "second.html"},
+          "added pages are unclassified");
+
+    std::vector<std::string> first, second;
+    std::vector<int> weights;
+    corpus.getPageRepresentatives("first.html", first, weights);
+    corpus.getPageRepresentatives("second.html", second, weights);
+    check(first.size() == 1 && second == first, "near-duplicates on different pages share a representative");
+
+    addPage("third.html", "<p>Green apples are sour.</p>\n");
+    corpus.removePage("first.html");
+    check(corpus.takeUnclassifiedPages() == std::vector<std::string>{"third.html"},
+          "only the added page is classified again");
+    corpus.getPageRepresentatives("second.html", second, weights);
+    check(second == first, "removing the first copy keeps the cluster of the other");
+
+    corpus.setKeyword("sour");
+    check(corpus.takeUnclassifiedPages().size() == 2, "a new keyword makes every page unclassified");
+}
+
+/**
+ * @brief Overwrites bytes of a file in place.
+ */
+template <typename T>
+void patchFile(const std::string& file, std::streamoff offset, T value)
+{
+    std::fstream stream(file, std::ios::in | std::ios::out | std::ios::binary);
+    stream.seekp(offset);
+    stream.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void testCorruptSegmentsAreRejected()
+{
+    const std::unordered_set<std::string> stopwords;
+    Corpus corpus("apples", stopwords);
+    corpus.addPage("page.html", makePage(corpus, 20, 3));
+    std::string file = (std::filesystem::temp_directory_path() / "corpustest.seg").string();
+    check(writeSegment(file, corpus.takeChanges()), "segment is written");
+    check(Segment::open(file) != nullptr, "valid segment is opened");
+
+    std::ifstream in(file, std::ios::binary);
+    std::string original((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    auto restore = [&file, &original]() {
+        std::ofstream(file, std::ios::binary | std::ios::trunc) << original;
+    };
+
+    // Header: magic[8], byte order mark, term, document, paragraph and tombstone counts,
+    // reserved, then the start of every section
+    const std::streamoff termCount = 12, paragraphCount = 20, sections = 32;
+    patchFile<std::uint32_t>(file, termCount, 1000000);
+    check(Segment::open(file) == nullptr, "segment with too many terms for its sections is rejected");
+    restore();
+    patchFile<std::uint32_t>(file, paragraphCount, 0);
+    check(Segment::open(file) == nullptr, "segment whose documents have more paragraphs than stored is rejected");
+    restore();
+    patchFile<std::uint64_t>(file, sections + 8, 8);
+    check(Segment::open(file) == nullptr, "segment with decreasing section offsets is rejected");
+    restore();
+
+    // Section 4 holds the posting offsets of the terms, section 5 their postings
+    std::uint64_t postingOffsets, postings;
+    std::memcpy(&postingOffsets, original.data() + sections + 4 * 8, sizeof(postingOffsets));
+    std::memcpy(&postings, original.data() + sections + 5 * 8, sizeof(postings));
+    patchFile<std::uint64_t>(file, postingOffsets + 8, std::uint64_t(1) << 40);
+    check(Segment::open(file) == nullptr, "segment with a posting offset past its section is rejected");
+    restore();
+
+    // Posting lists are only checked when they are decoded
+    std::vector<InvertedIndex::Posting> decoded;
+    patchFile<std::uint64_t>(file, postingOffsets + 8, 1);
+    std::shared_ptr<Segment> segment = Segment::open(file);
+    check(segment && !segment->decodePostings(0, decoded) && decoded.empty(),
+          "posting list that ends within a posting is rejected when decoded");
+    restore();
+    // The first posting is delta-encoded against document -1, so 127 refers to document 126
+    patchFile<std::uint8_t>(file, postings, 127);
+    segment = Segment::open(file);
+    check(segment && !segment->decodePostings(0, decoded) && decoded.empty(),
+          "posting of a missing document is rejected when decoded");
+    check(segment && segment->decodePostings(1, decoded) && !decoded.empty(), "intact posting lists still decode");
+    restore();
+
+    // Varints of 0xff bytes never end, so no posting list decodes; opening must not notice
+    std::uint64_t postingsEnd;
+    std::memcpy(&postingsEnd, original.data() + sections + 6 * 8, sizeof(postingsEnd));
+    std::string garbage(postingsEnd - postings, '\xff');
+    {
+        std::fstream stream(file, std::ios::in | std::ios::out | std::ios::binary);
+        stream.seekp(static_cast<std::streamoff>(postings));
+        stream.write(garbage.data(), static_cast<std::streamsize>(garbage.size()));
+    }
+    segment = Segment::open(file);
+    check(segment != nullptr, "opening a segment does not decode its posting lists");
+    check(segment && !segment->decodePostings(segment->getTermCount() - 1, decoded), "garbage postings fail when decoded");
+    std::filesystem::remove(file);
+}
+
+} // namespace
+
+int main()
+{
+    testAllocationsDoNotGrowWithOccurrences();
+    testMergedWordsShareThePageRecords();
+    testKeywordContextsComeFromTheSpill();
+    testPhraseCountsAreExact();
+    testPagePhraseCountsFollowPages();
+    testOnlyChangedPagesAreReclassified();
+    testCorruptSegmentsAreRejected();
+    if (failures == 0) {
+        std::cout << "All corpus tests passed" << std::endl;
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,30 @@
+QT -= core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = corpustest
+TEMPLATE = app
+
+INCLUDEPATH += $$PWD/..
+
+SOURCES += \
+    corpustest.cpp \
+    ../analysisarena.cpp \
+    ../bytesource.cpp \
+    ../corpus.cpp \
+    ../invertedindex.cpp \
+    ../keywordcontext.cpp \
+    ../nearduplicates.cpp \
+    ../page.cpp \
+    ../phrasecounter.cpp \
+    ../segment.cpp \
+    ../textspill.cpp \
+    ../word.cpp \
+    ../wordcolumns.cpp
+
+LIBS += -lz
+packagesExist(libzstd) {
+    DEFINES += MEDIAMINER_HAVE_ZSTD
+    LIBS += -lzstd
+}
@@ -0,0 +1,99 @@
+#include "textspill.h"
+#include <iostream>
+
+namespace {
+
+/**
+ * @brief Moves the position of a file, with 64-bit offsets on every platform.
+ */
+bool seek(std::FILE* file, std::uint64_t offset, int origin)
+{
+#ifdef _WIN32
+    return _fseeki64(file, static_cast<long long>(offset), origin) == 0;
+#else
+    return fseeko(file, static_cast<off_t>(offset), origin) == 0;
+#endif
+}
+
+} // namespace
+
+/**
+ * @date 2026-10-19
+ * @brief Creates an empty spill in an anonymous temporary file.
+ *
+ * Texts that are needed again only occasionally, such as the paragraphs of every page that
+ * keyword queries read back, are appended to the file instead of being kept in memory; callers
+ * remember the Range of each text. The file is deleted automatically when the spill is destroyed.
+ * If no temporary file can be created, texts are dropped and read back as empty.
+ */
+TextSpill::TextSpill() : file(std::tmpfile()), size(0), atEnd(true)
+{
+    if (!file) {
+        std::cerr << "Error: Unable to create a temporary file" << std::endl;
+    }
+}
+
+/**
+ * @brief Closes and thereby deletes the temporary file.
+ */
+TextSpill::~TextSpill()
+{
+    if (file) {
+        std::fclose(file);
+    }
+}
+
+/**
+ * @brief Appends text at the end of the spill.
+ *
+ * Consecutive calls write adjacent bytes, so a text may be appended in pieces; its range starts
+ * at getSize() before the first piece.
+ *
+ * @param text The text to append.
+ */
+void TextSpill::append(std::string_view text)
+{
+    if (!file || text.empty()) {
+        return;
+    }
+    if (!atEnd && !seek(file, 0, SEEK_END)) {
+        return;
+    }
+    atEnd = true;
+    if (std::fwrite(text.data(), 1, text.size(), file) != text.size()) {
+        std::cerr << "Error: Unable to write to a temporary file" << std::endl;
+        std::fclose(file);
+        file = nullptr;
+        return;
+    }
+    size += text.size();
+}
+
+/**
+ * @brief Gets the number of bytes appended so far.
+ *
+ * @return The offset at which the next text starts.
+ */
+std::uint64_t TextSpill::getSize() const
+{
+    return size;
+}
+
+/**
+ * @brief Reads a text back from the spill.
+ *
+ * @param range The position of the text.
+ * @return The text, or an empty string if it cannot be read.
+ */
+std::string TextSpill::read(const Range& range) const
+{
+    if (!file || range.length == 0 || range.offset + range.length > size) {
+        return std::string();
+    }
+    atEnd = false;
+    std::string text(range.length, '\0');
+    if (!seek(file, range.offset, SEEK_SET) || std::fread(&text[0], 1, text.size(), file) != text.size()) {
+        return std::string();
+    }
+    return text;
+}
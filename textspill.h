@@ -0,0 +1,33 @@
+#ifndef TEXTSPILL_H
+#define TEXTSPILL_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+class TextSpill {
+public:
+    /// Position of one text in the spill
+    struct Range {
+        std::uint64_t offset = 0;
+        std::uint64_t length = 0;
+    };
+
+    TextSpill();
+    ~TextSpill();
+
+    TextSpill(const TextSpill&) = delete;
+    TextSpill& operator=(const TextSpill&) = delete;
+
+    void append(std::string_view text);
+    std::uint64_t getSize() const;
+    std::string read(const Range& range) const;
+
+private:
+    std::FILE* file;
+    std::uint64_t size;
+    mutable bool atEnd; // the file position is at the end, so append() need not seek
+};
+
+#endif // TEXTSPILL_H
@@ -0,0 +1,45 @@
+#ifndef VARINT_H
+#define VARINT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Appends an unsigned integer in LEB128 varint form (7 bits per byte, low bits first).
+ *
+ * @param bytes The buffer to append to.
+ * @param value The value to encode.
+ */
+inline void appendVarint(std::string& bytes, std::uint32_t value)
+{
+    while (value >= 0x80) {
+        bytes += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    bytes += static_cast<char>(value);
+}
+
+/**
+ * @brief Reads a varint written by appendVarint().
+ *
+ * @param bytes The encoded data.
+ * @param size The number of bytes of encoded data; the varint must end before it.
+ * @param pos The position of the varint; advanced past it.
+ * @param value Receives the decoded value.
+ * @return False if the varint runs past size or is longer than a 32-bit value can be.
+ */
+inline bool readVarint(const char* bytes, std::size_t size, std::size_t& pos, std::uint32_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 35 && pos < size; shift += 7) {
+        std::uint8_t byte = static_cast<std::uint8_t>(bytes[pos++]);
+        value |= static_cast<std::uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif // VARINT_H
@@ -1,4 +1,5 @@
 #include "word.h"
+#include <algorithm>
 
 /**
  * @author Teagan Martins
@@ -8,22 +9,54 @@
  * Initializes the word and sets the initial count to 1.
  *
  * @param w The word as a string.
+ * @param alloc The allocator for the word and its occurrences, e.g. the arena of an analysis.
  */
-Word::Word(const std::string& w) : word(w), count(1) {}
+Word::Word(const std::string& w, const allocator_type& alloc)
+    : word(w.data(), w.size(), alloc), count(1), occurrences(alloc) {}
+
+/**
+ * @brief Copies a Word into memory from the given allocator.
+ *
+ * Used by allocator-aware containers so that a Word stored in them lives in the container's arena.
+ *
+ * @param other The Word to copy.
+ * @param alloc The allocator for the copy.
+ */
+Word::Word(const Word& other, const allocator_type& alloc)
+    : word(other.word, alloc), count(other.count), occurrences(other.occurrences, alloc) {}
+
+/**
+ * @brief Moves a Word into memory from the given allocator.
+ *
+ * The word and its occurrences are taken over without copying if the allocator uses the same
+ * memory resource as the source, and copied otherwise.
+ *
+ * @param other The Word to move from.
+ * @param alloc The allocator for the new Word.
+ */
+Word::Word(Word&& other, const allocator_type& alloc)
+    : word(std::move(other.word), alloc), count(other.count), occurrences(std::move(other.occurrences), alloc) {}
+
+/**
+ * @brief Gets the allocator the word and its occurrences are stored with.
+ *
+ * @return The allocator.
+ */
+Word::allocator_type Word::get_allocator() const { return occurrences.get_allocator(); }
 
 /**
  * @brief Sets the word value.
  *
  * @param w The word to set.
  */
-void Word::setWord(const std::string& w) { word = w; }
+void Word::setWord(const std::string& w) { word.assign(w.data(), w.size()); }
 
 /**
  * @brief Gets the word value.
  *
- * @return The stored word as a string.
+ * @return A view of the stored word, valid while the Word is alive and unchanged.
  */
-std::string Word::getWord() const { return word; }
+std::string_view Word::getWord() const { return word; }
 
 /**
  * @brief Sets the count of occurrences manually.
@@ -40,22 +73,101 @@ void Word::setCount(int c) { count = c; }
 int Word::getCount() const { return count; }
 
 /**
- * @brief Adds a new context in which the word occurred.
+ * @brief Adds a new occurrence of the word.
+ *
+ * Only the paragraph is recorded; the context of an occurrence is derived from the text of its
+ * paragraph when it is needed (see Corpus::getOccurrenceContexts()), so an occurrence takes four
+ * bytes rather than a copy of its context.
  *
  * Also updates the internal count to match the number of occurrences.
  *
- * @param context A string representing the context where the word appeared.
+ * @param paragraph The number of the paragraph of the page the word appeared in.
  */
-void Word::addOccurrence(const std::string& context) {
-    occurrences.push_back(context);
+void Word::addOccurrence(int paragraph) {
+    occurrences.push_back(paragraph);
     count = occurrences.size(); // Ensure count matches occurrences
 }
 
 /**
- * @brief Gets all recorded contexts in which the word appeared.
+ * @brief Gets the paragraphs of all recorded occurrences of the word.
  *
- * @return A const reference to a vector of context strings.
+ * @return The paragraph number of every occurrence, in ascending order.
  */
-const std::vector<std::string>& Word::getOccurrences() const {
+const Word::Occurrences& Word::getOccurrences() const {
     return occurrences;
 }
+
+/**
+ * @brief Constructs an empty list of word records.
+ *
+ * @param alloc The allocator for the list, e.g. the arena of an analysis.
+ */
+WordSources::WordSources(const allocator_type& alloc) : words(alloc), positions(alloc), count(0) {}
+
+/**
+ * @brief Copies a list of word records into memory from the given allocator.
+ *
+ * Only the references are copied; the records still belong to their pages.
+ *
+ * @param other The list to copy.
+ * @param alloc The allocator for the copy.
+ */
+WordSources::WordSources(const WordSources& other, const allocator_type& alloc)
+    : words(other.words, alloc), positions(other.positions, alloc), count(other.count) {}
+
+/**
+ * @brief Moves a list of word records into memory from the given allocator.
+ *
+ * @param other The list to move from.
+ * @param alloc The allocator for the new list.
+ */
+WordSources::WordSources(WordSources&& other, const allocator_type& alloc)
+    : words(std::move(other.words), alloc), positions(std::move(other.positions), alloc), count(other.count) {}
+
+/**
+ * @brief Adds the record of the word in one more page.
+ *
+ * @param word The record. Must stay at the same address until it is removed again.
+ * @param position Receives the position of the record in the list and is kept up to date while
+ *                 other records are removed. Must stay at the same address as the record.
+ */
+void WordSources::add(const Word& word, std::size_t& position) {
+    position = words.size();
+    words.push_back(&word);
+    positions.push_back(&position);
+    count += word.getCount();
+}
+
+/**
+ * @brief Removes a record previously passed to add(), e.g. because its page was removed.
+ *
+ * The last record takes the place of the removed one.
+ *
+ * @param position The current position of the record, as maintained by add().
+ */
+void WordSources::remove(std::size_t position) {
+    count -= words[position]->getCount();
+    words[position] = words.back();
+    positions[position] = positions.back();
+    *positions[position] = position;
+    words.pop_back();
+    positions.pop_back();
+}
+
+/**
+ * @brief Gets the total number of occurrences over all records.
+ *
+ * @return The count as an integer.
+ */
+int WordSources::getCount() const {
+    return count;
+}
+
+/**
+ * @brief Gets the records of the word, in no particular order.
+ *
+ * @return The records; their occurrences are the occurrences of the word.
+ */
+const std::pmr::vector<const Word*>& WordSources::getWords() const {
+    return words;
+}
@@ -1,26 +1,70 @@
 #ifndef WORD_H
 #define WORD_H
 
+#include <cstddef>
+#include <map>
+#include <memory_resource>
 #include <string>
+#include <string_view>
 #include <vector>
 
 class Word {
 public:
-    Word(const std::string& w);
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+    using Occurrences = std::pmr::vector<int>; // paragraph of every occurrence within its page
+
+    Word(const std::string& w, const allocator_type& alloc = {});
+    Word(const Word& other) = default;
+    Word(Word&& other) = default;
+    Word(const Word& other, const allocator_type& alloc);
+    Word(Word&& other, const allocator_type& alloc);
+    Word& operator=(const Word& other) = default;
+    Word& operator=(Word&& other) = default;
+    allocator_type get_allocator() const;
 
     void setWord(const std::string& w);
-    std::string getWord() const;
+    std::string_view getWord() const;
 
     void setCount(int c);
     int getCount() const;
 
-    void addOccurrence(const std::string& context);
-    const std::vector<std::string>& getOccurrences() const;
+    void addOccurrence(int paragraph);
+    const Occurrences& getOccurrences() const;
 
 private:
-    std::string word;
+    std::pmr::string word;
     int count;
-    std::vector<std::string> occurrences;
+    Occurrences occurrences;
+};
+
+/// Orders words by spelling and allows lookups with any string type
+struct WordLess {
+    using is_transparent = void;
+    bool operator()(std::string_view a, std::string_view b) const { return a < b; }
 };
 
+/// The records of one word in every page that contains it. The records stay owned by their
+/// pages and are only referenced here, so merging a page never copies a word or its occurrences.
+/// Every page keeps the position of its record in the list, so removing it takes constant time.
+class WordSources {
+public:
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    explicit WordSources(const allocator_type& alloc = {});
+    WordSources(const WordSources& other, const allocator_type& alloc);
+    WordSources(WordSources&& other, const allocator_type& alloc);
+
+    void add(const Word& word, std::size_t& position);
+    void remove(std::size_t position);
+    int getCount() const;
+    const std::pmr::vector<const Word*>& getWords() const;
+
+private:
+    std::pmr::vector<const Word*> words;
+    std::pmr::vector<std::size_t*> positions; // where the page of each record keeps its position
+    int count;
+};
+
+using WordMap = std::pmr::map<std::pmr::string, WordSources, WordLess>;
+
 #endif // WORD_H
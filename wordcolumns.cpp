@@ -0,0 +1,265 @@
+#include "wordcolumns.h"
+#include <algorithm>
+#include <functional>
+
+/// Number of hash slots allocated for an empty store; always a power of two
+const std::size_t INITIAL_SLOT_COUNT = 1024;
+
+/**
+ * @date 2026-10-19
+ * @brief Constructs an empty column store for per-word statistics.
+ *
+ * Every distinct word gets a dense integer id. Its statistics are kept in parallel arrays
+ * indexed by that id (count, document frequency, first-seen position) and its spelling in a
+ * single character blob, so sorting, filtering and aggregating scan contiguous memory instead
+ * of following map nodes. Ids are never reused; a word whose count drops to zero stays in the
+ * store with a zero count.
+ */
+WordColumns::WordColumns()
+    : offsets(1, 0), slots(INITIAL_SLOT_COUNT, -1) {}
+
+/**
+ * @brief Gets the id of a word, adding the word with zero statistics if it is not stored yet.
+ *
+ * @param word The word spelling.
+ * @return The id of the word.
+ */
+int WordColumns::intern(std::string_view word)
+{
+    int id = find(word);
+    if (id >= 0) {
+        return id;
+    }
+
+    // Keep the table at most half full so probe sequences stay short
+    if ((counts.size() + 1) * 2 > slots.size()) {
+        rehash(slots.size() * 2);
+    }
+
+    id = size();
+    blob.append(word.data(), word.size());
+    offsets.push_back(static_cast<std::uint32_t>(blob.size()));
+    counts.push_back(0);
+    documentFrequencies.push_back(0);
+    firstSeen.push_back(-1);
+
+    std::size_t mask = slots.size() - 1;
+    std::size_t slot = std::hash<std::string_view>()(word) & mask;
+    while (slots[slot] >= 0) {
+        slot = (slot + 1) & mask;
+    }
+    slots[slot] = id;
+    return id;
+}
+
+/**
+ * @brief Looks up the id of a word.
+ *
+ * @param word The word spelling.
+ * @return The id of the word, or -1 if it has never been stored.
+ */
+int WordColumns::find(std::string_view word) const
+{
+    std::size_t mask = slots.size() - 1;
+    std::size_t slot = std::hash<std::string_view>()(word) & mask;
+    while (slots[slot] >= 0) {
+        if (getWord(slots[slot]) == word) {
+            return slots[slot];
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+/**
+ * @brief Adds the occurrences of a word in one or more documents (pages).
+ *
+ * @param id The id of the word.
+ * @param count The number of occurrences in the documents.
+ * @param position The corpus word position at which the first of the documents starts.
+ * @param documents The number of documents the occurrences come from.
+ */
+void WordColumns::addOccurrences(int id, int count, long long position, int documents)
+{
+    if (counts[id] == 0) {
+        firstSeen[id] = position;
+    }
+    counts[id] += count;
+    documentFrequencies[id] += documents;
+}
+
+/**
+ * @brief Removes the occurrences of a word in one document that was added before.
+ *
+ * @param id The id of the word.
+ * @param count The number of occurrences the document contributed.
+ */
+void WordColumns::removeOccurrences(int id, int count)
+{
+    counts[id] -= count;
+    documentFrequencies[id]--;
+    if (counts[id] == 0) {
+        firstSeen[id] = -1;
+    }
+}
+
+/**
+ * @brief Gets the number of word ids, including words whose count has dropped to zero.
+ *
+ * @return The number of ids.
+ */
+int WordColumns::size() const
+{
+    return static_cast<int>(counts.size());
+}
+
+/**
+ * @brief Gets the spelling of a word.
+ *
+ * @param id The id of the word.
+ * @return A view into the string blob, valid until the next word is interned.
+ */
+std::string_view WordColumns::getWord(int id) const
+{
+    return std::string_view(blob.data() + offsets[id], offsets[id + 1] - offsets[id]);
+}
+
+/**
+ * @brief Gets the number of occurrences of a word.
+ *
+ * @param id The id of the word.
+ * @return The occurrence count.
+ */
+int WordColumns::getCount(int id) const
+{
+    return counts[id];
+}
+
+/**
+ * @brief Gets the number of documents (pages) a word occurs in.
+ *
+ * @param id The id of the word.
+ * @return The document frequency.
+ */
+int WordColumns::getDocumentFrequency(int id) const
+{
+    return documentFrequencies[id];
+}
+
+/**
+ * @brief Gets the corpus word position at which a word was first seen.
+ *
+ * @param id The id of the word.
+ * @return The position, or -1 if the word currently has no occurrences.
+ */
+long long WordColumns::getFirstSeen(int id) const
+{
+    return firstSeen[id];
+}
+
+/**
+ * @brief Counts the words that currently have at least one occurrence.
+ *
+ * @return The number of distinct words.
+ */
+int WordColumns::getLiveCount() const
+{
+    const int* data = counts.data();
+    int live = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        live += data[i] > 0;
+    }
+    return live;
+}
+
+/**
+ * @brief Sums the occurrence counts of all words.
+ *
+ * @return The total number of occurrences.
+ */
+long long WordColumns::getTotalCount() const
+{
+    const int* data = counts.data();
+    long long total = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        total += data[i];
+    }
+    return total;
+}
+
+/**
+ * @brief Gets the highest occurrence count of any word.
+ *
+ * @return The maximum count, or 0 if the store is empty.
+ */
+int WordColumns::getMaxCount() const
+{
+    const int* data = counts.data();
+    int maxCount = 0;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        maxCount = std::max(maxCount, data[i]);
+    }
+    return maxCount;
+}
+
+/**
+ * @brief Selects the words that occur at least a given number of times.
+ *
+ * @param minCount The minimum count (use 1 for all words that currently occur).
+ * @return The ids of the matching words in id order.
+ */
+std::vector<int> WordColumns::filterByCount(int minCount) const
+{
+    const int* data = counts.data();
+    std::vector<int> ids;
+    for (std::size_t i = 0; i < counts.size(); i++) {
+        if (data[i] >= minCount) {
+            ids.push_back(static_cast<int>(i));
+        }
+    }
+    return ids;
+}
+
+/**
+ * @brief Gets the most frequent words.
+ *
+ * Only words with at least one occurrence are returned. Words with the same count are ordered
+ * by id, i.e. by the order in which they were first stored.
+ *
+ * @param limit The maximum number of ids to return.
+ * @return The ids of the most frequent words, most frequent first.
+ */
+std::vector<int> WordColumns::sortByCount(std::size_t limit) const
+{
+    std::vector<int> ids = filterByCount(1);
+    const int* data = counts.data();
+    auto byCount = [data](int a, int b) {
+        return data[a] != data[b] ? data[a] > data[b] : a < b;
+    };
+
+    if (limit < ids.size()) {
+        std::partial_sort(ids.begin(), ids.begin() + limit, ids.end(), byCount);
+        ids.resize(limit);
+    } else {
+        std::sort(ids.begin(), ids.end(), byCount);
+    }
+    return ids;
+}
+
+/**
+ * @brief Rebuilds the hash table with a new number of slots.
+ *
+ * @param slotCount The new number of slots; must be a power of two.
+ */
+void WordColumns::rehash(std::size_t slotCount)
+{
+    slots.assign(slotCount, -1);
+    std::size_t mask = slotCount - 1;
+    for (int id = 0; id < size(); id++) {
+        std::size_t slot = std::hash<std::string_view>()(getWord(id)) & mask;
+        while (slots[slot] >= 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots[slot] = id;
+    }
+}
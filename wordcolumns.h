@@ -0,0 +1,42 @@
+#ifndef WORDCOLUMNS_H
+#define WORDCOLUMNS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class WordColumns {
+public:
+    WordColumns();
+
+    int intern(std::string_view word);
+    int find(std::string_view word) const;
+    void addOccurrences(int id, int count, long long position, int documents = 1);
+    void removeOccurrences(int id, int count);
+
+    int size() const;
+    std::string_view getWord(int id) const;
+    int getCount(int id) const;
+    int getDocumentFrequency(int id) const;
+    long long getFirstSeen(int id) const;
+
+    int getLiveCount() const;
+    long long getTotalCount() const;
+    int getMaxCount() const;
+    std::vector<int> filterByCount(int minCount) const;
+    std::vector<int> sortByCount(std::size_t limit) const;
+
+private:
+    void rehash(std::size_t slotCount);
+
+    std::string blob;                    // all word spellings, back to back
+    std::vector<std::uint32_t> offsets;  // word id i spans blob[offsets[i], offsets[i + 1])
+    std::vector<int> counts;
+    std::vector<int> documentFrequencies;
+    std::vector<long long> firstSeen;    // corpus word position of the first occurrence, or -1
+    std::vector<int> slots;              // open-addressing hash table of word ids, -1 if empty
+};
+
+#endif // WORDCOLUMNS_H